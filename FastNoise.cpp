@@ -27,31 +27,20 @@
 //
 
 #include "FastNoise.h"
+#include "FastNoiseKernel.h"
+#include "FastNoiseBatch_internal.h"
 
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 
 #include <algorithm>
 #include <random>
+#include <vector>
 
-const FN_DECIMAL GRAD_X[] =
-{
-	1, -1, 1, -1,
-	1, -1, 1, -1,
-	0, 0, 0, 0
-};
-const FN_DECIMAL GRAD_Y[] =
-{
-	1, 1, -1, -1,
-	0, 0, 0, 0,
-	1, -1, 1, -1
-};
-const FN_DECIMAL GRAD_Z[] =
-{
-	0, 0, 0, 0,
-	1, 1, -1, -1,
-	1, 1, -1, -1
-};
+using FastNoiseDetail::GRAD_X;
+using FastNoiseDetail::GRAD_Y;
+using FastNoiseDetail::GRAD_Z;
 
 const FN_DECIMAL GRAD_4D[] =
 {
@@ -212,6 +201,12 @@ void FastNoise::SetSeed(int seed)
 		m_perm[k] = l;
 		m_perm12[j] = m_perm12[j + 256] = m_perm[j] % 12;
 	}
+
+	for (int i = 0; i < 512; i++)
+	{
+		m_permInt[i] = m_perm[i];
+		m_perm12Int[i] = m_perm12[i];
+	}
 }
 
 void FastNoise::CalculateFractalBounding()
@@ -328,6 +323,71 @@ FN_DECIMAL FastNoise::GradCoord4D(unsigned char offset, int x, int y, int z, int
 	return xd*GRAD_4D[lutPos] + yd*GRAD_4D[lutPos + 1] + zd*GRAD_4D[lutPos + 2] + wd*GRAD_4D[lutPos + 3];
 }
 
+// Perlin goes through the NoiseKernel of the configuration (FastNoiseKernel.h), picked once per
+// call; the coordinates are already multiplied by the frequency
+template <FastNoise::NoiseType Noise, FastNoise::FractalType Fractal, class... Coords>
+static FN_DECIMAL SamplePerlin(const FastNoise& noise, Coords... coords)
+{
+	switch (noise.GetInterp())
+	{
+	case FastNoise::Linear:
+		return NoiseKernel<Noise, Fractal, FastNoise::Linear>::Sample(noise, coords...);
+	case FastNoise::Hermite:
+		return NoiseKernel<Noise, Fractal, FastNoise::Hermite>::Sample(noise, coords...);
+	default:
+		return NoiseKernel<Noise, Fractal, FastNoise::Quintic>::Sample(noise, coords...);
+	}
+}
+
+template <class... Coords>
+static FN_DECIMAL SamplePerlinFractal(const FastNoise& noise, Coords... coords)
+{
+	switch (noise.GetFractalType())
+	{
+	case FastNoise::FBM:
+		return SamplePerlin<FastNoise::PerlinFractal, FastNoise::FBM>(noise, coords...);
+	case FastNoise::Billow:
+		return SamplePerlin<FastNoise::PerlinFractal, FastNoise::Billow>(noise, coords...);
+	case FastNoise::RigidMulti:
+		return SamplePerlin<FastNoise::PerlinFractal, FastNoise::RigidMulti>(noise, coords...);
+	default:
+		return 0;
+	}
+}
+
+// Same for the WithGradient functions; these take the unscaled coordinates
+template <FastNoise::FractalType Fractal, class... Coords>
+static FN_DECIMAL PerlinFractalWithGradient(const FastNoise& noise, FN_DECIMAL* gradient, Coords... coords)
+{
+	switch (noise.GetInterp())
+	{
+	case FastNoise::Linear:
+		return NoiseKernel<FastNoise::PerlinFractal, Fractal, FastNoise::Linear>::GetWithGradient(noise, coords..., gradient);
+	case FastNoise::Hermite:
+		return NoiseKernel<FastNoise::PerlinFractal, Fractal, FastNoise::Hermite>::GetWithGradient(noise, coords..., gradient);
+	default:
+		return NoiseKernel<FastNoise::PerlinFractal, Fractal, FastNoise::Quintic>::GetWithGradient(noise, coords..., gradient);
+	}
+}
+
+template <class... Coords>
+static FN_DECIMAL PerlinFractalWithGradient(const FastNoise& noise, FN_DECIMAL* gradient, Coords... coords)
+{
+	switch (noise.GetFractalType())
+	{
+	case FastNoise::FBM:
+		return PerlinFractalWithGradient<FastNoise::FBM>(noise, gradient, coords...);
+	case FastNoise::Billow:
+		return PerlinFractalWithGradient<FastNoise::Billow>(noise, gradient, coords...);
+	case FastNoise::RigidMulti:
+		return PerlinFractalWithGradient<FastNoise::RigidMulti>(noise, gradient, coords...);
+	default:
+		for (unsigned i = 0; i < sizeof...(coords); i++)
+			gradient[i] = 0;
+		return 0;
+	}
+}
+
 FN_DECIMAL FastNoise::GetNoise(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
 {
 	x *= m_frequency;
@@ -351,19 +411,9 @@ FN_DECIMAL FastNoise::GetNoise(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
 			return 0;
 		}
 	case Perlin:
-		return SinglePerlin(0, x, y, z);
+		return SamplePerlin<Perlin, FBM>(*this, x, y, z);
 	case PerlinFractal:
-		switch (m_fractalType)
-		{
-		case FBM:
-			return SinglePerlinFractalFBM(x, y, z);
-		case Billow:
-			return SinglePerlinFractalBillow(x, y, z);
-		case RigidMulti:
-			return SinglePerlinFractalRigidMulti(x, y, z);
-		default:
-			return 0;
-		}
+		return SamplePerlinFractal(*this, x, y, z);
 	case Simplex:
 		return SingleSimplex(0, x, y, z);
 	case SimplexFractal:
@@ -427,17 +477,9 @@ FN_DECIMAL FastNoise::GetNoise(FN_DECIMAL x, FN_DECIMAL y) const
 			return SingleValueFractalRigidMulti(x, y);
 		}
 	case Perlin:
-		return SinglePerlin(0, x, y);
+		return SamplePerlin<Perlin, FBM>(*this, x, y);
 	case PerlinFractal:
-		switch (m_fractalType)
-		{
-		case FBM:
-			return SinglePerlinFractalFBM(x, y);
-		case Billow:
-			return SinglePerlinFractalBillow(x, y);
-		case RigidMulti:
-			return SinglePerlinFractalRigidMulti(x, y);
-		}
+		return SamplePerlinFractal(*this, x, y);
 	case Simplex:
 		return SingleSimplex(0, x, y);
 	case SimplexFractal:
@@ -749,242 +791,32 @@ FN_DECIMAL FastNoise::SingleValue(unsigned char offset, FN_DECIMAL x, FN_DECIMAL
 // Perlin Noise
 FN_DECIMAL FastNoise::GetPerlinFractal(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
 {
-	x *= m_frequency;
-	y *= m_frequency;
-	z *= m_frequency;
-
-	switch (m_fractalType)
-	{
-	case FBM:
-		return SinglePerlinFractalFBM(x, y, z);
-	case Billow:
-		return SinglePerlinFractalBillow(x, y, z);
-	case RigidMulti:
-		return SinglePerlinFractalRigidMulti(x, y, z);
-	default:
-		return 0;
-	}
-}
-
-FN_DECIMAL FastNoise::SinglePerlinFractalFBM(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
-{
-	FN_DECIMAL sum = SinglePerlin(m_perm[0], x, y, z);
-	FN_DECIMAL amp = 1;
-	int i = 0;
-
-	while (++i < m_octaves)
-	{
-		x *= m_lacunarity;
-		y *= m_lacunarity;
-		z *= m_lacunarity;
-
-		amp *= m_gain;
-		sum += SinglePerlin(m_perm[i], x, y, z) * amp;
-	}
-
-	return sum * m_fractalBounding;
-}
-
-FN_DECIMAL FastNoise::SinglePerlinFractalBillow(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
-{
-	FN_DECIMAL sum = FastAbs(SinglePerlin(m_perm[0], x, y, z)) * 2 - 1;
-	FN_DECIMAL amp = 1;
-	int i = 0;
-
-	while (++i < m_octaves)
-	{
-		x *= m_lacunarity;
-		y *= m_lacunarity;
-		z *= m_lacunarity;
-
-		amp *= m_gain;
-		sum += (FastAbs(SinglePerlin(m_perm[i], x, y, z)) * 2 - 1) * amp;
-	}
-
-	return sum * m_fractalBounding;
-}
-
-FN_DECIMAL FastNoise::SinglePerlinFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
-{
-	FN_DECIMAL sum = 1 - FastAbs(SinglePerlin(m_perm[0], x, y, z));
-	FN_DECIMAL amp = 1;
-	int i = 0;
-
-	while (++i < m_octaves)
-	{
-		x *= m_lacunarity;
-		y *= m_lacunarity;
-		z *= m_lacunarity;
-
-		amp *= m_gain;
-		sum -= (1 - FastAbs(SinglePerlin(m_perm[i], x, y, z))) * amp;
-	}
-
-	return sum;
+	return SamplePerlinFractal(*this, x * m_frequency, y * m_frequency, z * m_frequency);
 }
 
 FN_DECIMAL FastNoise::GetPerlin(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
 {
-	return SinglePerlin(0, x * m_frequency, y * m_frequency, z * m_frequency);
-}
-
-FN_DECIMAL FastNoise::SinglePerlin(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
-{
-	int x0 = FastFloor(x);
-	int y0 = FastFloor(y);
-	int z0 = FastFloor(z);
-	int x1 = x0 + 1;
-	int y1 = y0 + 1;
-	int z1 = z0 + 1;
-
-	FN_DECIMAL xs, ys, zs;
-	switch (m_interp)
-	{
-	case Linear:
-		xs = x - (FN_DECIMAL)x0;
-		ys = y - (FN_DECIMAL)y0;
-		zs = z - (FN_DECIMAL)z0;
-		break;
-	case Hermite:
-		xs = InterpHermiteFunc(x - (FN_DECIMAL)x0);
-		ys = InterpHermiteFunc(y - (FN_DECIMAL)y0);
-		zs = InterpHermiteFunc(z - (FN_DECIMAL)z0);
-		break;
-	case Quintic:
-		xs = InterpQuinticFunc(x - (FN_DECIMAL)x0);
-		ys = InterpQuinticFunc(y - (FN_DECIMAL)y0);
-		zs = InterpQuinticFunc(z - (FN_DECIMAL)z0);
-		break;
-	}
-
-	FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
-	FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
-	FN_DECIMAL zd0 = z - (FN_DECIMAL)z0;
-	FN_DECIMAL xd1 = xd0 - 1;
-	FN_DECIMAL yd1 = yd0 - 1;
-	FN_DECIMAL zd1 = zd0 - 1;
-
-	FN_DECIMAL xf00 = Lerp(GradCoord3D(offset, x0, y0, z0, xd0, yd0, zd0), GradCoord3D(offset, x1, y0, z0, xd1, yd0, zd0), xs);
-	FN_DECIMAL xf10 = Lerp(GradCoord3D(offset, x0, y1, z0, xd0, yd1, zd0), GradCoord3D(offset, x1, y1, z0, xd1, yd1, zd0), xs);
-	FN_DECIMAL xf01 = Lerp(GradCoord3D(offset, x0, y0, z1, xd0, yd0, zd1), GradCoord3D(offset, x1, y0, z1, xd1, yd0, zd1), xs);
-	FN_DECIMAL xf11 = Lerp(GradCoord3D(offset, x0, y1, z1, xd0, yd1, zd1), GradCoord3D(offset, x1, y1, z1, xd1, yd1, zd1), xs);
-
-	FN_DECIMAL yf0 = Lerp(xf00, xf10, ys);
-	FN_DECIMAL yf1 = Lerp(xf01, xf11, ys);
-
-	return Lerp(yf0, yf1, zs);
+	return SamplePerlin<Perlin, FBM>(*this, x * m_frequency, y * m_frequency, z * m_frequency);
 }
 
 FN_DECIMAL FastNoise::GetPerlinFractal(FN_DECIMAL x, FN_DECIMAL y) const
 {
-	x *= m_frequency;
-	y *= m_frequency;
-
-	switch (m_fractalType)
-	{
-	case FBM:
-		return SinglePerlinFractalFBM(x, y);
-	case Billow:
-		return SinglePerlinFractalBillow(x, y);
-	case RigidMulti:
-		return SinglePerlinFractalRigidMulti(x, y);
-	default:
-		return 0;
-	}
-}
-
-FN_DECIMAL FastNoise::SinglePerlinFractalFBM(FN_DECIMAL x, FN_DECIMAL y) const
-{
-	FN_DECIMAL sum = SinglePerlin(m_perm[0], x, y);
-	FN_DECIMAL amp = 1;
-	int i = 0;
-
-	while (++i < m_octaves)
-	{
-		x *= m_lacunarity;
-		y *= m_lacunarity;
-
-		amp *= m_gain;
-		sum += SinglePerlin(m_perm[i], x, y) * amp;
-	}
-
-	return sum * m_fractalBounding;
+	return SamplePerlinFractal(*this, x * m_frequency, y * m_frequency);
 }
 
-FN_DECIMAL FastNoise::SinglePerlinFractalBillow(FN_DECIMAL x, FN_DECIMAL y) const
-{
-	FN_DECIMAL sum = FastAbs(SinglePerlin(m_perm[0], x, y)) * 2 - 1;
-	FN_DECIMAL amp = 1;
-	int i = 0;
-
-	while (++i < m_octaves)
-	{
-		x *= m_lacunarity;
-		y *= m_lacunarity;
-
-		amp *= m_gain;
-		sum += (FastAbs(SinglePerlin(m_perm[i], x, y)) * 2 - 1) * amp;
-	}
-
-	return sum * m_fractalBounding;
-}
-
-FN_DECIMAL FastNoise::SinglePerlinFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y) const
+FN_DECIMAL FastNoise::GetPerlin(FN_DECIMAL x, FN_DECIMAL y) const
 {
-	FN_DECIMAL sum = 1 - FastAbs(SinglePerlin(m_perm[0], x, y));
-	FN_DECIMAL amp = 1;
-	int i = 0;
-
-	while (++i < m_octaves)
-	{
-		x *= m_lacunarity;
-		y *= m_lacunarity;
-
-		amp *= m_gain;
-		sum -= (1 - FastAbs(SinglePerlin(m_perm[i], x, y))) * amp;
-	}
-
-	return sum;
+	return SamplePerlin<Perlin, FBM>(*this, x * m_frequency, y * m_frequency);
 }
 
-FN_DECIMAL FastNoise::GetPerlin(FN_DECIMAL x, FN_DECIMAL y) const
+FN_DECIMAL FastNoise::GetPerlinFractalWithGradient(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL* gradient) const
 {
-	return SinglePerlin(0, x * m_frequency, y * m_frequency);
+	return PerlinFractalWithGradient(*this, gradient, x, y);
 }
 
-FN_DECIMAL FastNoise::SinglePerlin(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y) const
+FN_DECIMAL FastNoise::GetPerlinFractalWithGradient(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL* gradient) const
 {
-	int x0 = FastFloor(x);
-	int y0 = FastFloor(y);
-	int x1 = x0 + 1;
-	int y1 = y0 + 1;
-
-	FN_DECIMAL xs, ys;
-	switch (m_interp)
-	{
-	case Linear:
-		xs = x - (FN_DECIMAL)x0;
-		ys = y - (FN_DECIMAL)y0;
-		break;
-	case Hermite:
-		xs = InterpHermiteFunc(x - (FN_DECIMAL)x0);
-		ys = InterpHermiteFunc(y - (FN_DECIMAL)y0);
-		break;
-	case Quintic:
-		xs = InterpQuinticFunc(x - (FN_DECIMAL)x0);
-		ys = InterpQuinticFunc(y - (FN_DECIMAL)y0);
-		break;
-	}
-
-	FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
-	FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
-	FN_DECIMAL xd1 = xd0 - 1;
-	FN_DECIMAL yd1 = yd0 - 1;
-
-	FN_DECIMAL xf0 = Lerp(GradCoord2D(offset, x0, y0, xd0, yd0), GradCoord2D(offset, x1, y0, xd1, yd0), xs);
-	FN_DECIMAL xf1 = Lerp(GradCoord2D(offset, x0, y1, xd0, yd1), GradCoord2D(offset, x1, y1, xd1, yd1), xs);
-
-	return Lerp(xf0, xf1, ys);
+	return PerlinFractalWithGradient(*this, gradient, x, y, z);
 }
 
 // Simplex Noise
@@ -1433,6 +1265,92 @@ FN_DECIMAL FastNoise::SingleSimplex(unsigned char offset, FN_DECIMAL x, FN_DECIM
 	return 27 * (n0 + n1 + n2 + n3 + n4);
 }
 
+FN_DECIMAL FastNoise::GetSimplexWithGradient(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w, FN_DECIMAL* gradient) const
+{
+	FN_DECIMAL n = SingleSimplexWithGradient(0, x * m_frequency, y * m_frequency, z * m_frequency, w * m_frequency, gradient);
+	for (int i = 0; i < 4; i++)
+		gradient[i] *= m_frequency;
+	return n;
+}
+
+// A corner term t^4 * (g . d) of SingleSimplex 4D, with t = 0.6 - d . d; adds its derivative
+// t^4 * g - 8 * t^3 * (g . d) * d to gradient
+FN_DECIMAL FastNoise::SimplexCornerWithGradient(unsigned char offset, int i, int j, int k, int l,
+	FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w, FN_DECIMAL* gradient) const
+{
+	FN_DECIMAL t = FN_DECIMAL(0.6) - x*x - y*y - z*z - w*w;
+	if (t < 0) return 0;
+
+	unsigned char lutPos = Index4D_32(offset, i, j, k, l) << 2;
+	FN_DECIMAL dot = x*GRAD_4D[lutPos] + y*GRAD_4D[lutPos + 1] + z*GRAD_4D[lutPos + 2] + w*GRAD_4D[lutPos + 3];
+	FN_DECIMAL t2 = t * t;
+	FN_DECIMAL t4 = t2 * t2;
+	FN_DECIMAL slope = FN_DECIMAL(-8) * (t * t2) * dot;
+	gradient[0] += t4 * GRAD_4D[lutPos] + slope * x;
+	gradient[1] += t4 * GRAD_4D[lutPos + 1] + slope * y;
+	gradient[2] += t4 * GRAD_4D[lutPos + 2] + slope * z;
+	gradient[3] += t4 * GRAD_4D[lutPos + 3] + slope * w;
+	return t4 * dot;
+}
+
+// SingleSimplex 4D plus the derivatives; the corner offsets do not depend on the point within
+// the simplex, so the derivative of each corner term is taken with respect to its own distance
+FN_DECIMAL FastNoise::SingleSimplexWithGradient(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w, FN_DECIMAL* gradient) const
+{
+	FN_DECIMAL t = (x + y + z + w) * F4;
+	int i = FastFloor(x + t);
+	int j = FastFloor(y + t);
+	int k = FastFloor(z + t);
+	int l = FastFloor(w + t);
+	t = (i + j + k + l) * G4;
+	FN_DECIMAL x0 = x - (i - t);
+	FN_DECIMAL y0 = y - (j - t);
+	FN_DECIMAL z0 = z - (k - t);
+	FN_DECIMAL w0 = w - (l - t);
+
+	int rankx = 0;
+	int ranky = 0;
+	int rankz = 0;
+	int rankw = 0;
+
+	if (x0 > y0) rankx++; else ranky++;
+	if (x0 > z0) rankx++; else rankz++;
+	if (x0 > w0) rankx++; else rankw++;
+	if (y0 > z0) ranky++; else rankz++;
+	if (y0 > w0) ranky++; else rankw++;
+	if (z0 > w0) rankz++; else rankw++;
+
+	int i1 = rankx >= 3 ? 1 : 0;
+	int j1 = ranky >= 3 ? 1 : 0;
+	int k1 = rankz >= 3 ? 1 : 0;
+	int l1 = rankw >= 3 ? 1 : 0;
+
+	int i2 = rankx >= 2 ? 1 : 0;
+	int j2 = ranky >= 2 ? 1 : 0;
+	int k2 = rankz >= 2 ? 1 : 0;
+	int l2 = rankw >= 2 ? 1 : 0;
+
+	int i3 = rankx >= 1 ? 1 : 0;
+	int j3 = ranky >= 1 ? 1 : 0;
+	int k3 = rankz >= 1 ? 1 : 0;
+	int l3 = rankw >= 1 ? 1 : 0;
+
+	FN_DECIMAL g[4] = { 0, 0, 0, 0 };
+	FN_DECIMAL n0 = SimplexCornerWithGradient(offset, i, j, k, l, x0, y0, z0, w0, g);
+	FN_DECIMAL n1 = SimplexCornerWithGradient(offset, i + i1, j + j1, k + k1, l + l1,
+		x0 - i1 + G4, y0 - j1 + G4, z0 - k1 + G4, w0 - l1 + G4, g);
+	FN_DECIMAL n2 = SimplexCornerWithGradient(offset, i + i2, j + j2, k + k2, l + l2,
+		x0 - i2 + 2*G4, y0 - j2 + 2*G4, z0 - k2 + 2*G4, w0 - l2 + 2*G4, g);
+	FN_DECIMAL n3 = SimplexCornerWithGradient(offset, i + i3, j + j3, k + k3, l + l3,
+		x0 - i3 + 3*G4, y0 - j3 + 3*G4, z0 - k3 + 3*G4, w0 - l3 + 3*G4, g);
+	FN_DECIMAL n4 = SimplexCornerWithGradient(offset, i + 1, j + 1, k + 1, l + 1,
+		x0 - 1 + 4*G4, y0 - 1 + 4*G4, z0 - 1 + 4*G4, w0 - 1 + 4*G4, g);
+
+	for (int c = 0; c < 4; c++)
+		gradient[c] = g[c] * 27;
+	return 27 * (n0 + n1 + n2 + n3 + n4);
+}
+
 // Cubic Noise
 FN_DECIMAL FastNoise::GetCubicFractal(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const
 {
@@ -2248,3 +2166,377 @@ void FastNoise::SingleGradientPerturb(unsigned char offset, FN_DECIMAL warpAmp,
 	x += Lerp(lx0x, lx1x, ys) * warpAmp;
 	y += Lerp(ly0x, ly1x, ys) * warpAmp;
 }
+
+// Regular grids
+void FastNoise::GetNoiseGrid2D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL dx, FN_DECIMAL dy,
+	int countX, int countY, FN_DECIMAL* out, int rowStride) const
+{
+	switch (m_noiseType)
+	{
+	case Perlin:
+		PerlinGrid2D(false, x0, y0, dx, dy, countX, countY, out, rowStride);
+		return;
+	case PerlinFractal:
+		PerlinGrid2D(true, x0, y0, dx, dy, countX, countY, out, rowStride);
+		return;
+	case WhiteNoise:
+		WhiteNoiseGrid2D(x0, y0, dx, dy, countX, countY, out, rowStride);
+		return;
+	default:
+		for (int j = 0; j < countY; j++)
+			for (int i = 0; i < countX; i++)
+				out[j * rowStride + i] = GetNoise(x0 + i * dx, y0 + j * dy);
+	}
+}
+
+void FastNoise::GetNoiseGrid3D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL z0, FN_DECIMAL dx, FN_DECIMAL dy, FN_DECIMAL dz,
+	int countX, int countY, int countZ, FN_DECIMAL* out, int rowStride, int sliceStride) const
+{
+	switch (m_noiseType)
+	{
+	case Perlin:
+		PerlinGrid3D(false, x0, y0, z0, dx, dy, dz, countX, countY, countZ, out, rowStride, sliceStride);
+		return;
+	case PerlinFractal:
+		PerlinGrid3D(true, x0, y0, z0, dx, dy, dz, countX, countY, countZ, out, rowStride, sliceStride);
+		return;
+	case WhiteNoise:
+		WhiteNoiseGrid3D(x0, y0, z0, dx, dy, dz, countX, countY, countZ, out, rowStride, sliceStride);
+		return;
+	default:
+		for (int k = 0; k < countZ; k++)
+			for (int j = 0; j < countY; j++)
+				for (int i = 0; i < countX; i++)
+					out[k * sliceStride + j * rowStride + i] = GetNoise(x0 + i * dx, y0 + j * dy, z0 + k * dz);
+	}
+}
+
+// Lattice coordinate, interpolation weight and distance to the lattice coordinate, as SinglePerlin works them out
+static void GridAxis(FN_DECIMAL f, FastNoise::Interp interp, int& lattice, FN_DECIMAL& weight, FN_DECIMAL& dist)
+{
+	lattice = FastFloor(f);
+	dist = f - (FN_DECIMAL)lattice;
+	switch (interp)
+	{
+	case FastNoise::Linear:
+		weight = dist;
+		break;
+	case FastNoise::Hermite:
+		weight = InterpHermiteFunc(dist);
+		break;
+	case FastNoise::Quintic:
+		weight = InterpQuinticFunc(dist);
+		break;
+	}
+}
+
+// The first octave of a row, in place, as the Single*Fractal* functions start the sum
+static void GridFractalFirst(FastNoise::FractalType fractalType, FN_DECIMAL* sum, int count)
+{
+	switch (fractalType)
+	{
+	case FastNoise::Billow:
+		for (int i = 0; i < count; i++)
+			sum[i] = FastAbs(sum[i]) * 2 - 1;
+		break;
+	case FastNoise::RigidMulti:
+		for (int i = 0; i < count; i++)
+			sum[i] = 1 - FastAbs(sum[i]);
+		break;
+	default:
+		break;
+	}
+}
+
+// A later octave of a row added to the sum, as the Single*Fractal* functions add it
+static void GridFractalOctave(FastNoise::FractalType fractalType, FN_DECIMAL amp, const FN_DECIMAL* noise, FN_DECIMAL* sum, int count)
+{
+	switch (fractalType)
+	{
+	case FastNoise::Billow:
+		for (int i = 0; i < count; i++)
+			sum[i] += (FastAbs(noise[i]) * 2 - 1) * amp;
+		break;
+	case FastNoise::RigidMulti:
+		for (int i = 0; i < count; i++)
+			sum[i] -= (1 - FastAbs(noise[i])) * amp;
+		break;
+	default:
+		for (int i = 0; i < count; i++)
+			sum[i] += noise[i] * amp;
+		break;
+	}
+}
+
+static void GridFractalEnd(FastNoise::FractalType fractalType, FN_DECIMAL fractalBounding, FN_DECIMAL* sum, int count)
+{
+	if (fractalType == FastNoise::RigidMulti)
+		return;
+	for (int i = 0; i < count; i++)
+		sum[i] *= fractalBounding;
+}
+
+void FastNoise::PerlinGrid2D(bool fractal, FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL dx, FN_DECIMAL dy,
+	int countX, int countY, FN_DECIMAL* out, int rowStride) const
+{
+	const int octaves = fractal ? std::max(m_octaves, 1) : 1;
+
+	// x terms of every column and octave, shared by all rows
+	std::vector<int> columnLattice(octaves * countX);
+	std::vector<FN_DECIMAL> columnWeight(octaves * countX);
+	std::vector<FN_DECIMAL> columnDist(octaves * countX);
+	for (int i = 0; i < countX; i++)
+	{
+		FN_DECIMAL x = (x0 + i * dx) * m_frequency;
+		for (int octave = 0; octave < octaves; octave++)
+		{
+			if (octave > 0)
+				x *= m_lacunarity;
+			const int c = octave * countX + i;
+			GridAxis(x, m_interp, columnLattice[c], columnWeight[c], columnDist[c]);
+		}
+	}
+
+	std::vector<FN_DECIMAL> noise(countX);
+	FastNoiseGridRow row;
+	for (int j = 0; j < countY; j++)
+	{
+		FN_DECIMAL* sum = out + j * rowStride;
+		FN_DECIMAL y = (y0 + j * dy) * m_frequency;
+		FN_DECIMAL amp = 1;
+		for (int octave = 0; octave < octaves; octave++)
+		{
+			if (octave > 0)
+			{
+				y *= m_lacunarity;
+				amp *= m_gain;
+			}
+
+			int yLattice;
+			GridAxis(y, m_interp, yLattice, row.ys, row.yd0);
+			const unsigned char offset = fractal ? m_perm[octave] : 0;
+			row.hash[0] = m_perm[(yLattice & 0xff) + offset];
+			row.hash[1] = m_perm[((yLattice + 1) & 0xff) + offset];
+			row.x0 = &columnLattice[octave * countX];
+			row.xs = &columnWeight[octave * countX];
+			row.xd0 = &columnDist[octave * countX];
+
+			if (octave == 0)
+			{
+				PerlinGridRow2D(row, sum, countX);
+				if (fractal)
+					GridFractalFirst(m_fractalType, sum, countX);
+			}
+			else
+			{
+				PerlinGridRow2D(row, noise.data(), countX);
+				GridFractalOctave(m_fractalType, amp, noise.data(), sum, countX);
+			}
+		}
+		if (fractal)
+			GridFractalEnd(m_fractalType, m_fractalBounding, sum, countX);
+	}
+}
+
+void FastNoise::PerlinGrid3D(bool fractal, FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL z0, FN_DECIMAL dx, FN_DECIMAL dy, FN_DECIMAL dz,
+	int countX, int countY, int countZ, FN_DECIMAL* out, int rowStride, int sliceStride) const
+{
+	const int octaves = fractal ? std::max(m_octaves, 1) : 1;
+
+	std::vector<int> columnLattice(octaves * countX);
+	std::vector<FN_DECIMAL> columnWeight(octaves * countX);
+	std::vector<FN_DECIMAL> columnDist(octaves * countX);
+	for (int i = 0; i < countX; i++)
+	{
+		FN_DECIMAL x = (x0 + i * dx) * m_frequency;
+		for (int octave = 0; octave < octaves; octave++)
+		{
+			if (octave > 0)
+				x *= m_lacunarity;
+			const int c = octave * countX + i;
+			GridAxis(x, m_interp, columnLattice[c], columnWeight[c], columnDist[c]);
+		}
+	}
+
+	std::vector<FN_DECIMAL> noise(countX);
+	FastNoiseGridRow row;
+	for (int k = 0; k < countZ; k++)
+	{
+		for (int j = 0; j < countY; j++)
+		{
+			FN_DECIMAL* sum = out + k * sliceStride + j * rowStride;
+			FN_DECIMAL y = (y0 + j * dy) * m_frequency;
+			FN_DECIMAL z = (z0 + k * dz) * m_frequency;
+			FN_DECIMAL amp = 1;
+			for (int octave = 0; octave < octaves; octave++)
+			{
+				if (octave > 0)
+				{
+					y *= m_lacunarity;
+					z *= m_lacunarity;
+					amp *= m_gain;
+				}
+
+				int yLattice, zLattice;
+				GridAxis(y, m_interp, yLattice, row.ys, row.yd0);
+				GridAxis(z, m_interp, zLattice, row.zs, row.zd0);
+				const unsigned char offset = fractal ? m_perm[octave] : 0;
+				const int hashZ0 = m_perm[(zLattice & 0xff) + offset];
+				const int hashZ1 = m_perm[((zLattice + 1) & 0xff) + offset];
+				row.hash[0] = m_perm[(yLattice & 0xff) + hashZ0];
+				row.hash[1] = m_perm[((yLattice + 1) & 0xff) + hashZ0];
+				row.hash[2] = m_perm[(yLattice & 0xff) + hashZ1];
+				row.hash[3] = m_perm[((yLattice + 1) & 0xff) + hashZ1];
+				row.x0 = &columnLattice[octave * countX];
+				row.xs = &columnWeight[octave * countX];
+				row.xd0 = &columnDist[octave * countX];
+
+				if (octave == 0)
+				{
+					PerlinGridRow3D(row, sum, countX);
+					if (fractal)
+						GridFractalFirst(m_fractalType, sum, countX);
+				}
+				else
+				{
+					PerlinGridRow3D(row, noise.data(), countX);
+					GridFractalOctave(m_fractalType, amp, noise.data(), sum, countX);
+				}
+			}
+			if (fractal)
+				GridFractalEnd(m_fractalType, m_fractalBounding, sum, countX);
+		}
+	}
+}
+
+void FastNoise::PerlinGridRow2D(const FastNoiseGridRow& row, FN_DECIMAL* out, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+	{
+		FastNoiseBatchParams params = {};
+		params.perm12 = m_perm12Int;
+		return kernels->perlinGridRow2D(params, row, out, count);
+	}
+#endif
+	const FN_DECIMAL yd0 = row.yd0;
+	const FN_DECIMAL yd1 = yd0 - 1;
+
+	// neighbouring columns in the same lattice cell share its gradients
+	unsigned char lut00 = 0, lut10 = 0, lut01 = 0, lut11 = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const int x0 = row.x0[i];
+		if (i == 0 || x0 != row.x0[i - 1])
+		{
+			lut00 = m_perm12[(x0 & 0xff) + row.hash[0]];
+			lut10 = m_perm12[((x0 + 1) & 0xff) + row.hash[0]];
+			lut01 = m_perm12[(x0 & 0xff) + row.hash[1]];
+			lut11 = m_perm12[((x0 + 1) & 0xff) + row.hash[1]];
+		}
+
+		const FN_DECIMAL xd0 = row.xd0[i];
+		const FN_DECIMAL xd1 = xd0 - 1;
+		const FN_DECIMAL xs = row.xs[i];
+
+		FN_DECIMAL xf0 = Lerp(xd0*GRAD_X[lut00] + yd0*GRAD_Y[lut00], xd1*GRAD_X[lut10] + yd0*GRAD_Y[lut10], xs);
+		FN_DECIMAL xf1 = Lerp(xd0*GRAD_X[lut01] + yd1*GRAD_Y[lut01], xd1*GRAD_X[lut11] + yd1*GRAD_Y[lut11], xs);
+
+		out[i] = Lerp(xf0, xf1, row.ys);
+	}
+}
+
+void FastNoise::PerlinGridRow3D(const FastNoiseGridRow& row, FN_DECIMAL* out, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+	{
+		FastNoiseBatchParams params = {};
+		params.perm12 = m_perm12Int;
+		return kernels->perlinGridRow3D(params, row, out, count);
+	}
+#endif
+	const FN_DECIMAL yd0 = row.yd0;
+	const FN_DECIMAL yd1 = yd0 - 1;
+	const FN_DECIMAL zd0 = row.zd0;
+	const FN_DECIMAL zd1 = zd0 - 1;
+
+	// gradients of the cell corners, x0 or x1 for each of the four rows
+	unsigned char lut[8] = {};
+	for (int i = 0; i < count; i++)
+	{
+		const int x0 = row.x0[i];
+		if (i == 0 || x0 != row.x0[i - 1])
+		{
+			for (int h = 0; h < 4; h++)
+			{
+				lut[2 * h] = m_perm12[(x0 & 0xff) + row.hash[h]];
+				lut[2 * h + 1] = m_perm12[((x0 + 1) & 0xff) + row.hash[h]];
+			}
+		}
+
+		const FN_DECIMAL xd0 = row.xd0[i];
+		const FN_DECIMAL xd1 = xd0 - 1;
+		const FN_DECIMAL xs = row.xs[i];
+
+		FN_DECIMAL xf00 = Lerp(xd0*GRAD_X[lut[0]] + yd0*GRAD_Y[lut[0]] + zd0*GRAD_Z[lut[0]], xd1*GRAD_X[lut[1]] + yd0*GRAD_Y[lut[1]] + zd0*GRAD_Z[lut[1]], xs);
+		FN_DECIMAL xf10 = Lerp(xd0*GRAD_X[lut[2]] + yd1*GRAD_Y[lut[2]] + zd0*GRAD_Z[lut[2]], xd1*GRAD_X[lut[3]] + yd1*GRAD_Y[lut[3]] + zd0*GRAD_Z[lut[3]], xs);
+		FN_DECIMAL xf01 = Lerp(xd0*GRAD_X[lut[4]] + yd0*GRAD_Y[lut[4]] + zd1*GRAD_Z[lut[4]], xd1*GRAD_X[lut[5]] + yd0*GRAD_Y[lut[5]] + zd1*GRAD_Z[lut[5]], xs);
+		FN_DECIMAL xf11 = Lerp(xd0*GRAD_X[lut[6]] + yd1*GRAD_Y[lut[6]] + zd1*GRAD_Z[lut[6]], xd1*GRAD_X[lut[7]] + yd1*GRAD_Y[lut[7]] + zd1*GRAD_Z[lut[7]], xs);
+
+		FN_DECIMAL yf0 = Lerp(xf00, xf10, row.ys);
+		FN_DECIMAL yf1 = Lerp(xf01, xf11, row.ys);
+
+		out[i] = Lerp(yf0, yf1, row.zs);
+	}
+}
+
+// The coordinate bits GetWhiteNoise hashes
+static int WhiteNoiseBits(FN_DECIMAL f)
+{
+	int i;
+	memcpy(&i, &f, sizeof(i));
+	return i ^ (i >> 16);
+}
+
+void FastNoise::WhiteNoiseGrid2D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL dx, FN_DECIMAL dy,
+	int countX, int countY, FN_DECIMAL* out, int rowStride) const
+{
+	std::vector<int> columnHash(countX);
+	for (int i = 0; i < countX; i++)
+		columnHash[i] = X_PRIME * WhiteNoiseBits((x0 + i * dx) * m_frequency);
+
+	for (int j = 0; j < countY; j++)
+	{
+		const int rowHash = m_seed ^ (Y_PRIME * WhiteNoiseBits((y0 + j * dy) * m_frequency));
+		FN_DECIMAL* row = out + j * rowStride;
+		for (int i = 0; i < countX; i++)
+		{
+			const int n = rowHash ^ columnHash[i];
+			row[i] = (n * n * n * 60493) / FN_DECIMAL(2147483648);
+		}
+	}
+}
+
+void FastNoise::WhiteNoiseGrid3D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL z0, FN_DECIMAL dx, FN_DECIMAL dy, FN_DECIMAL dz,
+	int countX, int countY, int countZ, FN_DECIMAL* out, int rowStride, int sliceStride) const
+{
+	std::vector<int> columnHash(countX);
+	for (int i = 0; i < countX; i++)
+		columnHash[i] = X_PRIME * WhiteNoiseBits((x0 + i * dx) * m_frequency);
+
+	for (int k = 0; k < countZ; k++)
+	{
+		const int sliceHash = m_seed ^ (Z_PRIME * WhiteNoiseBits((z0 + k * dz) * m_frequency));
+		for (int j = 0; j < countY; j++)
+		{
+			const int rowHash = sliceHash ^ (Y_PRIME * WhiteNoiseBits((y0 + j * dy) * m_frequency));
+			FN_DECIMAL* row = out + k * sliceStride + j * rowStride;
+			for (int i = 0; i < countX; i++)
+			{
+				const int n = rowHash ^ columnHash[i];
+				row[i] = (n * n * n * 60493) / FN_DECIMAL(2147483648);
+			}
+		}
+	}
+}
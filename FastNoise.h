@@ -42,6 +42,8 @@ typedef double FN_DECIMAL;
 typedef float FN_DECIMAL;
 #endif
 
+struct FastNoiseGridRow;
+
 class FastNoise
 {
 public:
@@ -213,9 +215,59 @@ public:
 	FN_DECIMAL GetWhiteNoise(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w) const;
 	FN_DECIMAL GetWhiteNoiseInt(int x, int y, int z, int w) const;
 
+	//Gradient
+	// The value of the function without the suffix, plus its analytic partial derivatives with respect
+	// to each input coordinate in gradient[0] (x), gradient[1] (y), ... The value is the same as that
+	// of the function without the suffix; the derivatives follow the fractal type and interpolation.
+	FN_DECIMAL GetPerlinFractalWithGradient(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL* gradient) const;
+	FN_DECIMAL GetPerlinFractalWithGradient(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL* gradient) const;
+	FN_DECIMAL GetSimplexWithGradient(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w, FN_DECIMAL* gradient) const;
+
+	//Batch
+	// Evaluate count points given as separate coordinate arrays (x[i], y[i], ...) into out[i].
+	// The results are those of the per-point functions of the same name; the SIMD kernels repeat
+	// their float operations in the same order, so they match to the bit unless the per-point code
+	// is compiled with fused multiply-add, and then within a few ulp.
+	// Float builds only: with FN_USE_DOUBLES these loop over the per-point functions.
+	enum BatchLevel { BatchScalar, BatchSSE41, BatchAVX2 };
+
+	// Returns the instruction set the batch functions use: the best one the CPU supports
+	static BatchLevel GetBatchLevel();
+
+	// Limits the batch functions to a lower instruction set, e.g. to compare the kernels
+	// Not thread safe, only call while no batch is running
+	static void SetBatchLevel(BatchLevel level);
+
+	void GetPerlinFractalBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count) const;
+	void GetWhiteNoiseBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count) const;
+	void GetPerlinFractalBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, FN_DECIMAL* out, int count) const;
+	void GetSimplexBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, const FN_DECIMAL* w, FN_DECIMAL* out, int count) const;
+	// GetSimplexWithGradient(...) of every point: the value to out[i], the derivatives to gradX[i] ... gradW[i]
+	void GetSimplexWithGradientBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, const FN_DECIMAL* w, FN_DECIMAL* out,
+		FN_DECIMAL* gradX, FN_DECIMAL* gradY, FN_DECIMAL* gradZ, FN_DECIMAL* gradW, int count) const;
+
+	//Grid
+	// Fill a regular grid with GetNoise(...): out[j * rowStride + i] = GetNoise(x0 + i * dx, y0 + j * dy)
+	// for i < countX and j < countY, with the same results.
+	// Perlin and PerlinFractal work out the lattice terms of every column and octave once and
+	// the hashes of every row once, then evaluate the rows with the batch kernels;
+	// WhiteNoise hashes every column and row once. Other noise types call GetNoise per point.
+	void GetNoiseGrid2D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL dx, FN_DECIMAL dy,
+		int countX, int countY, FN_DECIMAL* out, int rowStride) const;
+
+	// out[k * sliceStride + j * rowStride + i] = GetNoise(x0 + i * dx, y0 + j * dy, z0 + k * dz)
+	void GetNoiseGrid3D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL z0, FN_DECIMAL dx, FN_DECIMAL dy, FN_DECIMAL dz,
+		int countX, int countY, int countZ, FN_DECIMAL* out, int rowStride, int sliceStride) const;
+
 private:
+	// Compile-time configured Perlin, FastNoiseKernel.h
+	template <NoiseType Noise, FractalType Fractal, Interp Interpolation, int Octaves> friend struct NoiseKernel;
+
 	unsigned char m_perm[512];
 	unsigned char m_perm12[512];
+	// m_perm and m_perm12 widened for the gathers of the batch kernels
+	int m_permInt[512];
+	int m_perm12Int[512];
 
 	int m_seed = 1337;
 	FN_DECIMAL m_frequency = FN_DECIMAL(0.01);
@@ -239,17 +291,29 @@ private:
 
 	void CalculateFractalBounding();
 
+	void PerlinGrid2D(bool fractal, FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL dx, FN_DECIMAL dy,
+		int countX, int countY, FN_DECIMAL* out, int rowStride) const;
+	void PerlinGrid3D(bool fractal, FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL z0, FN_DECIMAL dx, FN_DECIMAL dy, FN_DECIMAL dz,
+		int countX, int countY, int countZ, FN_DECIMAL* out, int rowStride, int sliceStride) const;
+	// The SIMD Perlin kernels of a configuration for NoiseKernel::GetBatch, false when there are none
+	bool PerlinBatch(bool fractal, FractalType fractalType, Interp interp,
+		const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count) const;
+	bool PerlinBatch(bool fractal, FractalType fractalType, Interp interp,
+		const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, FN_DECIMAL* out, int count) const;
+
+	void PerlinGridRow2D(const FastNoiseGridRow& row, FN_DECIMAL* out, int count) const;
+	void PerlinGridRow3D(const FastNoiseGridRow& row, FN_DECIMAL* out, int count) const;
+	void WhiteNoiseGrid2D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL dx, FN_DECIMAL dy,
+		int countX, int countY, FN_DECIMAL* out, int rowStride) const;
+	void WhiteNoiseGrid3D(FN_DECIMAL x0, FN_DECIMAL y0, FN_DECIMAL z0, FN_DECIMAL dx, FN_DECIMAL dy, FN_DECIMAL dz,
+		int countX, int countY, int countZ, FN_DECIMAL* out, int rowStride, int sliceStride) const;
+
 	//2D
 	FN_DECIMAL SingleValueFractalFBM(FN_DECIMAL x, FN_DECIMAL y) const;
 	FN_DECIMAL SingleValueFractalBillow(FN_DECIMAL x, FN_DECIMAL y) const;
 	FN_DECIMAL SingleValueFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y) const;
 	FN_DECIMAL SingleValue(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y) const;
 
-	FN_DECIMAL SinglePerlinFractalFBM(FN_DECIMAL x, FN_DECIMAL y) const;
-	FN_DECIMAL SinglePerlinFractalBillow(FN_DECIMAL x, FN_DECIMAL y) const;
-	FN_DECIMAL SinglePerlinFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y) const;
-	FN_DECIMAL SinglePerlin(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y) const;
-
 	FN_DECIMAL SingleSimplexFractalFBM(FN_DECIMAL x, FN_DECIMAL y) const;
 	FN_DECIMAL SingleSimplexFractalBillow(FN_DECIMAL x, FN_DECIMAL y) const;
 	FN_DECIMAL SingleSimplexFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y) const;
@@ -272,11 +336,6 @@ private:
 	FN_DECIMAL SingleValueFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
 	FN_DECIMAL SingleValue(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
 
-	FN_DECIMAL SinglePerlinFractalFBM(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
-	FN_DECIMAL SinglePerlinFractalBillow(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
-	FN_DECIMAL SinglePerlinFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
-	FN_DECIMAL SinglePerlin(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
-
 	FN_DECIMAL SingleSimplexFractalFBM(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
 	FN_DECIMAL SingleSimplexFractalBillow(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
 	FN_DECIMAL SingleSimplexFractalRigidMulti(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
@@ -294,6 +353,9 @@ private:
 
 	//4D
 	FN_DECIMAL SingleSimplex(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w) const;
+	FN_DECIMAL SingleSimplexWithGradient(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w, FN_DECIMAL* gradient) const;
+	inline FN_DECIMAL SimplexCornerWithGradient(unsigned char offset, int i, int j, int k, int l,
+		FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL w, FN_DECIMAL* gradient) const;
 
 	inline unsigned char Index2D_12(unsigned char offset, int x, int y) const;
 	inline unsigned char Index3D_12(unsigned char offset, int x, int y, int z) const;
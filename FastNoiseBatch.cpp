@@ -0,0 +1,226 @@
+// FastNoiseBatch.cpp
+//
+// Batch functions of FastNoise: pick the SIMD kernels the CPU supports once,
+// fall back to the per-point functions where there are none.
+//
+
+#include "FastNoise.h"
+#include "FastNoiseKernel.h"
+#include "FastNoiseBatch_internal.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static FastNoise::BatchLevel DetectBatchLevel()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+	if (maxLeaf < 1)
+		return FastNoise::BatchScalar;
+
+	__cpuid(info, 1);
+	const bool sse41 = (info[2] & (1 << 19)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+
+	// AVX2 also needs the OS to save the ymm registers
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2)
+		return FastNoise::BatchAVX2;
+	if (sse41)
+		return FastNoise::BatchSSE41;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return FastNoise::BatchAVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return FastNoise::BatchSSE41;
+#endif
+	return FastNoise::BatchScalar;
+}
+
+// Highest level both the CPU and the build support
+static FastNoise::BatchLevel SupportedBatchLevel()
+{
+	static const FastNoise::BatchLevel supported = []()
+	{
+		FastNoise::BatchLevel level = DetectBatchLevel();
+		if (level == FastNoise::BatchAVX2 && !FastNoiseBatchKernelsAVX2())
+			level = FastNoise::BatchSSE41;
+		if (level == FastNoise::BatchSSE41 && !FastNoiseBatchKernelsSSE41())
+			level = FastNoise::BatchScalar;
+		return level;
+	}();
+	return supported;
+}
+
+static FastNoise::BatchLevel s_batchLevel = SupportedBatchLevel();
+
+const FastNoiseBatchKernels* FastNoiseBatchKernelsActive()
+{
+	switch (s_batchLevel)
+	{
+	case FastNoise::BatchAVX2:
+		return FastNoiseBatchKernelsAVX2();
+	case FastNoise::BatchSSE41:
+		return FastNoiseBatchKernelsSSE41();
+	default:
+		return nullptr;
+	}
+}
+
+FastNoise::BatchLevel FastNoise::GetBatchLevel()
+{
+	return s_batchLevel;
+}
+
+void FastNoise::SetBatchLevel(BatchLevel level)
+{
+	const BatchLevel supported = SupportedBatchLevel();
+	s_batchLevel = level < supported ? level : supported;
+}
+
+#ifndef FN_USE_DOUBLES
+
+static FastNoiseBatchParams MakeBatchParams(const int* perm, const int* perm12, const int* offsets, int seed, float frequency,
+	int octaves, float lacunarity, float gain, float fractalBounding)
+{
+	FastNoiseBatchParams params;
+	params.perm = perm;
+	params.perm12 = perm12;
+	params.offsets = offsets;
+	params.seed = seed;
+	params.frequency = frequency;
+	params.octaves = octaves;
+	params.lacunarity = lacunarity;
+	params.gain = gain;
+	params.fractalBounding = fractalBounding;
+	return params;
+}
+
+#define FN_BATCH_PARAMS MakeBatchParams(m_permInt, m_perm12Int, m_permInt, m_seed, m_frequency, m_octaves, \
+	m_lacunarity, m_gain, m_fractalBounding)
+
+// Plain Perlin is a single octave at offset 0, summed like FBM with a bounding of 1
+static const int s_perlinOffsets[1] = { 0 };
+
+#define FN_BATCH_PERLIN_PARAMS(fractal) (fractal ? FN_BATCH_PARAMS : MakeBatchParams(m_permInt, m_perm12Int, s_perlinOffsets, \
+	m_seed, m_frequency, 1, m_lacunarity, m_gain, 1))
+
+#endif
+
+bool FastNoise::PerlinBatch(bool fractal, FractalType fractalType, Interp interp,
+	const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+	{
+		kernels->perlinFractal2D[fractalType][interp](FN_BATCH_PERLIN_PARAMS(fractal), x, y, out, count);
+		return true;
+	}
+#endif
+	return false;
+}
+
+bool FastNoise::PerlinBatch(bool fractal, FractalType fractalType, Interp interp,
+	const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, FN_DECIMAL* out, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+	{
+		kernels->perlinFractal3D[fractalType][interp](FN_BATCH_PERLIN_PARAMS(fractal), x, y, z, out, count);
+		return true;
+	}
+#endif
+	return false;
+}
+
+// The NoiseKernel of the object's fractal type and interpolation, picked once per batch
+template <FastNoise::FractalType Fractal, class... Args>
+static void PerlinFractalBatchFor(const FastNoise& noise, Args... args)
+{
+	switch (noise.GetInterp())
+	{
+	case FastNoise::Linear:
+		return NoiseKernel<FastNoise::PerlinFractal, Fractal, FastNoise::Linear>::GetBatch(noise, args...);
+	case FastNoise::Hermite:
+		return NoiseKernel<FastNoise::PerlinFractal, Fractal, FastNoise::Hermite>::GetBatch(noise, args...);
+	default:
+		return NoiseKernel<FastNoise::PerlinFractal, Fractal, FastNoise::Quintic>::GetBatch(noise, args...);
+	}
+}
+
+template <class... Args>
+static void PerlinFractalBatch(const FastNoise& noise, FN_DECIMAL* out, int count, Args... args)
+{
+	switch (noise.GetFractalType())
+	{
+	case FastNoise::FBM:
+		return PerlinFractalBatchFor<FastNoise::FBM>(noise, args..., out, count);
+	case FastNoise::Billow:
+		return PerlinFractalBatchFor<FastNoise::Billow>(noise, args..., out, count);
+	case FastNoise::RigidMulti:
+		return PerlinFractalBatchFor<FastNoise::RigidMulti>(noise, args..., out, count);
+	default:
+		for (int i = 0; i < count; i++)
+			out[i] = 0;
+	}
+}
+
+void FastNoise::GetPerlinFractalBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count) const
+{
+	PerlinFractalBatch(*this, out, count, x, y);
+}
+
+void FastNoise::GetWhiteNoiseBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+		return kernels->whiteNoise2D(FN_BATCH_PARAMS, x, y, out, count);
+#endif
+	for (int i = 0; i < count; i++)
+		out[i] = GetWhiteNoise(x[i], y[i]);
+}
+
+void FastNoise::GetPerlinFractalBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, FN_DECIMAL* out, int count) const
+{
+	PerlinFractalBatch(*this, out, count, x, y, z);
+}
+
+void FastNoise::GetSimplexBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, const FN_DECIMAL* w, FN_DECIMAL* out, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+		return kernels->simplex4D(FN_BATCH_PARAMS, x, y, z, w, out, count);
+#endif
+	for (int i = 0; i < count; i++)
+		out[i] = GetSimplex(x[i], y[i], z[i], w[i]);
+}
+
+void FastNoise::GetSimplexWithGradientBatch(const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, const FN_DECIMAL* w, FN_DECIMAL* out,
+	FN_DECIMAL* gradX, FN_DECIMAL* gradY, FN_DECIMAL* gradZ, FN_DECIMAL* gradW, int count) const
+{
+#ifndef FN_USE_DOUBLES
+	if (const FastNoiseBatchKernels* kernels = FastNoiseBatchKernelsActive())
+		return kernels->simplexWithGradient4D(FN_BATCH_PARAMS, x, y, z, w, out, gradX, gradY, gradZ, gradW, count);
+#endif
+	FN_DECIMAL gradient[4];
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = GetSimplexWithGradient(x[i], y[i], z[i], w[i], gradient);
+		gradX[i] = gradient[0];
+		gradY[i] = gradient[1];
+		gradZ[i] = gradient[2];
+		gradW[i] = gradient[3];
+	}
+}
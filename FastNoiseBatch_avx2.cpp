@@ -0,0 +1,22 @@
+// FastNoiseBatch_avx2.cpp
+//
+// AVX2 kernels of the FastNoise batch functions, 8 points per vector with gathered table lookups.
+// Built with -mavx2 (GCC, Clang) or /arch:AVX2 (MSVC), see CMakeLists.txt. FMA stays off
+// so the results match the per-point code.
+//
+
+#include "FastNoise.h"
+#include "FastNoiseBatch_internal.h"
+
+#if !defined(FN_USE_DOUBLES) && defined(__AVX2__)
+
+#define FN_BATCH_AVX2
+#include "FastNoiseBatch_kernels.inl"
+
+const FastNoiseBatchKernels* FastNoiseBatchKernelsAVX2() { return &KERNELS; }
+
+#else
+
+const FastNoiseBatchKernels* FastNoiseBatchKernelsAVX2() { return nullptr; }
+
+#endif
@@ -0,0 +1,66 @@
+// FastNoiseBatch_internal.h
+//
+// Interface between the FastNoise batch functions (FastNoiseBatch.cpp) and their SIMD
+// kernels, which are compiled once per instruction set from FastNoiseBatch_kernels.inl.
+//
+
+#ifndef FASTNOISEBATCH_INTERNAL_H
+#define FASTNOISEBATCH_INTERNAL_H
+
+#include "FastNoise.h"
+
+// Everything a kernel reads from the FastNoise object, copied once per batch
+struct FastNoiseBatchParams
+{
+	const int* perm;		// m_perm widened to int, 512 entries
+	const int* perm12;		// m_perm12 widened to int, 512 entries
+	const int* offsets;		// m_perm offset of each Perlin octave: perm for PerlinFractal, a single 0 for Perlin
+	int seed;
+	float frequency;
+	int octaves;
+	float lacunarity;
+	float gain;
+	float fractalBounding;
+};
+
+// One octave of Perlin noise along a row of a regular grid (FastNoise::GetNoiseGrid2D/3D):
+// the x lattice terms come per column, the y and z terms are the same for the whole row
+struct FastNoiseGridRow
+{
+	const int* x0;			// lower lattice coordinate of each column
+	const FN_DECIMAL* xs;	// interpolation weight of each column
+	const FN_DECIMAL* xd0;	// distance of each column to its lower lattice coordinate
+	// m_perm lookups of the y (and z) lattice coordinates, the x coordinate is added per column
+	// 2D: y0, y1; 3D: (y0, z0), (y1, z0), (y0, z1), (y1, z1)
+	int hash[4];
+	FN_DECIMAL ys, yd0;
+	FN_DECIMAL zs, zd0;
+};
+
+typedef void (*FastNoiseBatch2D)(const FastNoiseBatchParams& params, const float* x, const float* y, float* out, int count);
+typedef void (*FastNoiseBatch3D)(const FastNoiseBatchParams& params, const float* x, const float* y, const float* z, float* out, int count);
+typedef void (*FastNoiseBatch4D)(const FastNoiseBatchParams& params, const float* x, const float* y, const float* z, const float* w, float* out, int count);
+typedef void (*FastNoiseBatch4DGradient)(const FastNoiseBatchParams& params, const float* x, const float* y, const float* z, const float* w,
+	float* out, float* gradX, float* gradY, float* gradZ, float* gradW, int count);
+typedef void (*FastNoiseGridRowKernel)(const FastNoiseBatchParams& params, const FastNoiseGridRow& row, float* out, int count);
+
+// The Perlin kernels are compiled per [FastNoise::FractalType][FastNoise::Interp]
+struct FastNoiseBatchKernels
+{
+	FastNoiseBatch2D perlinFractal2D[3][3];
+	FastNoiseBatch2D whiteNoise2D;
+	FastNoiseBatch3D perlinFractal3D[3][3];
+	FastNoiseBatch4D simplex4D;
+	FastNoiseBatch4DGradient simplexWithGradient4D;
+	FastNoiseGridRowKernel perlinGridRow2D;
+	FastNoiseGridRowKernel perlinGridRow3D;
+};
+
+// nullptr when the file was compiled without the instruction set
+const FastNoiseBatchKernels* FastNoiseBatchKernelsSSE41();
+const FastNoiseBatchKernels* FastNoiseBatchKernelsAVX2();
+
+// Kernels of the level set with FastNoise::SetBatchLevel(), nullptr for the scalar level
+const FastNoiseBatchKernels* FastNoiseBatchKernelsActive();
+
+#endif
@@ -0,0 +1,672 @@
+// FastNoiseBatch_kernels.inl
+//
+// SIMD kernels of the FastNoise batch functions. Included by FastNoiseBatch_sse41.cpp and,
+// with FN_BATCH_AVX2 defined, by FastNoiseBatch_avx2.cpp, each compiled for its instruction set.
+//
+// Every lane repeats the float operations of the per-point code in FastNoise.cpp in the same
+// order, without fused multiply-add, so the batch results are the same as the per-point ones.
+//
+
+#include "FastNoiseBatch_internal.h"
+
+#include <math.h>
+#include <string.h>
+#include <immintrin.h>
+
+namespace
+{
+#ifdef FN_BATCH_AVX2
+	typedef __m256 VF;
+	typedef __m256i VI;
+	const int WIDTH = 8;
+
+	inline VF LoadF(const float* p) { return _mm256_loadu_ps(p); }
+	inline VI LoadI(const int* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	inline void StoreF(float* p, VF a) { _mm256_storeu_ps(p, a); }
+	inline VF SetF(float f) { return _mm256_set1_ps(f); }
+	inline VI SetI(int i) { return _mm256_set1_epi32(i); }
+
+	inline VF Add(VF a, VF b) { return _mm256_add_ps(a, b); }
+	inline VF Sub(VF a, VF b) { return _mm256_sub_ps(a, b); }
+	inline VF Mul(VF a, VF b) { return _mm256_mul_ps(a, b); }
+	inline VF AndNotF(VF a, VF b) { return _mm256_andnot_ps(a, b); }
+	inline VF CmpLt(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline VF CmpGt(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+	inline VI AddI(VI a, VI b) { return _mm256_add_epi32(a, b); }
+	inline VI SubI(VI a, VI b) { return _mm256_sub_epi32(a, b); }
+	inline VI MulI(VI a, VI b) { return _mm256_mullo_epi32(a, b); }
+	inline VI AndI(VI a, VI b) { return _mm256_and_si256(a, b); }
+	inline VI XorI(VI a, VI b) { return _mm256_xor_si256(a, b); }
+	inline VI CmpGtI(VI a, VI b) { return _mm256_cmpgt_epi32(a, b); }
+	template <int N> inline VI ShiftLeftI(VI a) { return _mm256_slli_epi32(a, N); }
+	template <int N> inline VI ShiftRightI(VI a) { return _mm256_srai_epi32(a, N); }
+
+	inline VF ConvertF(VI a) { return _mm256_cvtepi32_ps(a); }
+	inline VI TruncateI(VF a) { return _mm256_cvttps_epi32(a); }
+	inline VI CastI(VF a) { return _mm256_castps_si256(a); }
+
+	inline VI GatherI(const int* table, VI index) { return _mm256_i32gather_epi32(table, index, 4); }
+	inline VF GatherF(const float* table, VI index) { return _mm256_i32gather_ps(table, index, 4); }
+#else
+	typedef __m128 VF;
+	typedef __m128i VI;
+	const int WIDTH = 4;
+
+	inline VF LoadF(const float* p) { return _mm_loadu_ps(p); }
+	inline VI LoadI(const int* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	inline void StoreF(float* p, VF a) { _mm_storeu_ps(p, a); }
+	inline VF SetF(float f) { return _mm_set1_ps(f); }
+	inline VI SetI(int i) { return _mm_set1_epi32(i); }
+
+	inline VF Add(VF a, VF b) { return _mm_add_ps(a, b); }
+	inline VF Sub(VF a, VF b) { return _mm_sub_ps(a, b); }
+	inline VF Mul(VF a, VF b) { return _mm_mul_ps(a, b); }
+	inline VF AndNotF(VF a, VF b) { return _mm_andnot_ps(a, b); }
+	inline VF CmpLt(VF a, VF b) { return _mm_cmplt_ps(a, b); }
+	inline VF CmpGt(VF a, VF b) { return _mm_cmpgt_ps(a, b); }
+
+	inline VI AddI(VI a, VI b) { return _mm_add_epi32(a, b); }
+	inline VI SubI(VI a, VI b) { return _mm_sub_epi32(a, b); }
+	inline VI MulI(VI a, VI b) { return _mm_mullo_epi32(a, b); }
+	inline VI AndI(VI a, VI b) { return _mm_and_si128(a, b); }
+	inline VI XorI(VI a, VI b) { return _mm_xor_si128(a, b); }
+	inline VI CmpGtI(VI a, VI b) { return _mm_cmpgt_epi32(a, b); }
+	template <int N> inline VI ShiftLeftI(VI a) { return _mm_slli_epi32(a, N); }
+	template <int N> inline VI ShiftRightI(VI a) { return _mm_srai_epi32(a, N); }
+
+	inline VF ConvertF(VI a) { return _mm_cvtepi32_ps(a); }
+	inline VI TruncateI(VF a) { return _mm_cvttps_epi32(a); }
+	inline VI CastI(VF a) { return _mm_castps_si128(a); }
+
+	// SSE has no gather, the lanes are looked up one by one
+	inline VI GatherI(const int* table, VI index)
+	{
+		return _mm_setr_epi32(table[_mm_extract_epi32(index, 0)], table[_mm_extract_epi32(index, 1)],
+			table[_mm_extract_epi32(index, 2)], table[_mm_extract_epi32(index, 3)]);
+	}
+	inline VF GatherF(const float* table, VI index)
+	{
+		return _mm_setr_ps(table[_mm_extract_epi32(index, 0)], table[_mm_extract_epi32(index, 1)],
+			table[_mm_extract_epi32(index, 2)], table[_mm_extract_epi32(index, 3)]);
+	}
+#endif
+
+	// Same tables as FastNoise.cpp
+	const float GRAD_X[] =
+	{
+		1, -1, 1, -1,
+		1, -1, 1, -1,
+		0, 0, 0, 0
+	};
+	const float GRAD_Y[] =
+	{
+		1, 1, -1, -1,
+		0, 0, 0, 0,
+		1, -1, 1, -1
+	};
+	const float GRAD_Z[] =
+	{
+		0, 0, 0, 0,
+		1, 1, -1, -1,
+		1, 1, -1, -1
+	};
+
+	const float GRAD_4D[] =
+	{
+		0,1,1,1,0,1,1,-1,0,1,-1,1,0,1,-1,-1,
+		0,-1,1,1,0,-1,1,-1,0,-1,-1,1,0,-1,-1,-1,
+		1,0,1,1,1,0,1,-1,1,0,-1,1,1,0,-1,-1,
+		-1,0,1,1,-1,0,1,-1,-1,0,-1,1,-1,0,-1,-1,
+		1,1,0,1,1,1,0,-1,1,-1,0,1,1,-1,0,-1,
+		-1,1,0,1,-1,1,0,-1,-1,-1,0,1,-1,-1,0,-1,
+		1,1,1,0,1,1,-1,0,1,-1,1,0,1,-1,-1,0,
+		-1,1,1,0,-1,1,-1,0,-1,-1,1,0,-1,-1,-1,0
+	};
+
+	const int X_PRIME = 1619;
+	const int Y_PRIME = 31337;
+
+	const float F4 = (sqrt(float(5)) - 1) / 4;
+	const float G4 = (5 - sqrt(float(5))) / 20;
+
+	// (int)f - 1 for negative f, like FastFloor() in FastNoise.cpp
+	inline VI FastFloor(VF f)
+	{
+		return AddI(TruncateI(f), CastI(CmpLt(f, SetF(0))));
+	}
+
+	inline VF FastAbs(VF f) { return AndNotF(SetF(-0.0f), f); }
+
+	inline VF Lerp(VF a, VF b, VF t) { return Add(a, Mul(t, Sub(b, a))); }
+
+	// InterpT, FractalT: FastNoise::Interp, FastNoise::FractalType as template arguments, so
+	// every kernel instantiation has its switches folded away
+	template <int InterpT>
+	inline VF Interp(VF t)
+	{
+		switch (InterpT)
+		{
+		case 1:	// Hermite: t*t*(3 - 2 * t)
+			return Mul(Mul(t, t), Sub(SetF(3), Mul(SetF(2), t)));
+		case 2:	// Quintic: t*t*t*(t*(t * 6 - 15) + 10)
+			return Mul(Mul(Mul(t, t), t), Add(Mul(t, Sub(Mul(t, SetF(6)), SetF(15))), SetF(10)));
+		default:
+			return t;
+		}
+	}
+
+	inline VI Index(const int* table, VI coord, VI next)
+	{
+		return GatherI(table, AddI(AndI(coord, SetI(0xff)), next));
+	}
+
+	inline VF GradCoord2D(const FastNoiseBatchParams& params, VI hashY, VI x, VF xd, VF yd)
+	{
+		const VI lutPos = Index(params.perm12, x, hashY);
+
+		return Add(Mul(xd, GatherF(GRAD_X, lutPos)), Mul(yd, GatherF(GRAD_Y, lutPos)));
+	}
+
+	inline VF GradCoord3D(const FastNoiseBatchParams& params, VI hashYZ, VI x, VF xd, VF yd, VF zd)
+	{
+		const VI lutPos = Index(params.perm12, x, hashYZ);
+
+		return Add(Add(Mul(xd, GatherF(GRAD_X, lutPos)), Mul(yd, GatherF(GRAD_Y, lutPos))), Mul(zd, GatherF(GRAD_Z, lutPos)));
+	}
+
+	inline VI GradIndex4D(const FastNoiseBatchParams& params, VI x, VI y, VI z, VI w)
+	{
+		const int* perm = params.perm;
+		VI hash = Index(perm, w, SetI(0));
+		hash = Index(perm, z, hash);
+		hash = Index(perm, y, hash);
+		return ShiftLeftI<2>(AndI(Index(perm, x, hash), SetI(31)));
+	}
+
+	inline VF GradCoord4D(const FastNoiseBatchParams& params, VI x, VI y, VI z, VI w, VF xd, VF yd, VF zd, VF wd)
+	{
+		const VI lutPos = GradIndex4D(params, x, y, z, w);
+
+		return Add(Add(Add(Mul(xd, GatherF(GRAD_4D, lutPos)), Mul(yd, GatherF(GRAD_4D + 1, lutPos))),
+			Mul(zd, GatherF(GRAD_4D + 2, lutPos))), Mul(wd, GatherF(GRAD_4D + 3, lutPos)));
+	}
+
+	// Perlin noise inside the lattice cell at x0: h0 and h1 are the hashes of its lower and upper row,
+	// xs, ys the interpolation weights and xd0, yd0 the distances to the lower corner
+	inline VF PerlinCell(const FastNoiseBatchParams& params, VI h0, VI h1, VI x0, VF xs, VF xd0, VF ys, VF yd0)
+	{
+		const VI x1 = AddI(x0, SetI(1));
+		const VF xd1 = Sub(xd0, SetF(1));
+		const VF yd1 = Sub(yd0, SetF(1));
+
+		const VF xf0 = Lerp(GradCoord2D(params, h0, x0, xd0, yd0), GradCoord2D(params, h0, x1, xd1, yd0), xs);
+		const VF xf1 = Lerp(GradCoord2D(params, h1, x0, xd0, yd1), GradCoord2D(params, h1, x1, xd1, yd1), xs);
+
+		return Lerp(xf0, xf1, ys);
+	}
+
+	// 3D version, h[yz] are the hashes of the four rows of the cell, y0 or y1 and z0 or z1
+	inline VF PerlinCell(const FastNoiseBatchParams& params, VI h00, VI h10, VI h01, VI h11, VI x0, VF xs, VF xd0, VF ys, VF yd0, VF zs, VF zd0)
+	{
+		const VI x1 = AddI(x0, SetI(1));
+		const VF xd1 = Sub(xd0, SetF(1));
+		const VF yd1 = Sub(yd0, SetF(1));
+		const VF zd1 = Sub(zd0, SetF(1));
+
+		const VF xf00 = Lerp(GradCoord3D(params, h00, x0, xd0, yd0, zd0), GradCoord3D(params, h00, x1, xd1, yd0, zd0), xs);
+		const VF xf10 = Lerp(GradCoord3D(params, h10, x0, xd0, yd1, zd0), GradCoord3D(params, h10, x1, xd1, yd1, zd0), xs);
+		const VF xf01 = Lerp(GradCoord3D(params, h01, x0, xd0, yd0, zd1), GradCoord3D(params, h01, x1, xd1, yd0, zd1), xs);
+		const VF xf11 = Lerp(GradCoord3D(params, h11, x0, xd0, yd1, zd1), GradCoord3D(params, h11, x1, xd1, yd1, zd1), xs);
+
+		const VF yf0 = Lerp(xf00, xf10, ys);
+		const VF yf1 = Lerp(xf01, xf11, ys);
+
+		return Lerp(yf0, yf1, zs);
+	}
+
+	template <int InterpT>
+	VF SinglePerlin(const FastNoiseBatchParams& params, int offset, VF x, VF y)
+	{
+		const VI x0 = FastFloor(x);
+		const VI y0 = FastFloor(y);
+		const VF xd0 = Sub(x, ConvertF(x0));
+		const VF yd0 = Sub(y, ConvertF(y0));
+
+		// the hashes of the rows are shared by both corners of the row
+		const VI h0 = Index(params.perm, y0, SetI(offset));
+		const VI h1 = Index(params.perm, AddI(y0, SetI(1)), SetI(offset));
+
+		return PerlinCell(params, h0, h1, x0, Interp<InterpT>(xd0), xd0, Interp<InterpT>(yd0), yd0);
+	}
+
+	template <int InterpT>
+	VF SinglePerlin(const FastNoiseBatchParams& params, int offset, VF x, VF y, VF z)
+	{
+		const VI x0 = FastFloor(x);
+		const VI y0 = FastFloor(y);
+		const VI z0 = FastFloor(z);
+		const VI y1 = AddI(y0, SetI(1));
+		const VF xd0 = Sub(x, ConvertF(x0));
+		const VF yd0 = Sub(y, ConvertF(y0));
+		const VF zd0 = Sub(z, ConvertF(z0));
+
+		const VI hz0 = Index(params.perm, z0, SetI(offset));
+		const VI hz1 = Index(params.perm, AddI(z0, SetI(1)), SetI(offset));
+		const VI h00 = Index(params.perm, y0, hz0);
+		const VI h10 = Index(params.perm, y1, hz0);
+		const VI h01 = Index(params.perm, y0, hz1);
+		const VI h11 = Index(params.perm, y1, hz1);
+
+		return PerlinCell(params, h00, h10, h01, h11, x0,
+			Interp<InterpT>(xd0), xd0, Interp<InterpT>(yd0), yd0, Interp<InterpT>(zd0), zd0);
+	}
+
+	// one octave folded into the sum the way the fractal type does it, for octave i > 0
+	template <int FractalT>
+	inline VF FractalOctave(VF sum, VF noise, float amp)
+	{
+		switch (FractalT)
+		{
+		case 1:	// Billow
+			return Add(sum, Mul(Sub(Mul(FastAbs(noise), SetF(2)), SetF(1)), SetF(amp)));
+		case 2:	// RigidMulti
+			return Sub(sum, Mul(Sub(SetF(1), FastAbs(noise)), SetF(amp)));
+		default:
+			return Add(sum, Mul(noise, SetF(amp)));
+		}
+	}
+
+	template <int FractalT>
+	inline VF FractalFirst(VF noise)
+	{
+		switch (FractalT)
+		{
+		case 1:
+			return Sub(Mul(FastAbs(noise), SetF(2)), SetF(1));
+		case 2:
+			return Sub(SetF(1), FastAbs(noise));
+		default:
+			return noise;
+		}
+	}
+
+	template <int FractalT>
+	inline VF FractalEnd(const FastNoiseBatchParams& params, VF sum)
+	{
+		return FractalT == 2 ? sum : Mul(sum, SetF(params.fractalBounding));
+	}
+
+	template <int InterpT, int FractalT>
+	VF PerlinFractal(const FastNoiseBatchParams& params, VF x, VF y)
+	{
+		const VF lacunarity = SetF(params.lacunarity);
+		x = Mul(x, SetF(params.frequency));
+		y = Mul(y, SetF(params.frequency));
+
+		VF sum = FractalFirst<FractalT>(SinglePerlin<InterpT>(params, params.offsets[0], x, y));
+		float amp = 1;
+		for (int i = 1; i < params.octaves; i++)
+		{
+			x = Mul(x, lacunarity);
+			y = Mul(y, lacunarity);
+
+			amp *= params.gain;
+			sum = FractalOctave<FractalT>(sum, SinglePerlin<InterpT>(params, params.offsets[i], x, y), amp);
+		}
+
+		return FractalEnd<FractalT>(params, sum);
+	}
+
+	template <int InterpT, int FractalT>
+	VF PerlinFractal(const FastNoiseBatchParams& params, VF x, VF y, VF z)
+	{
+		const VF lacunarity = SetF(params.lacunarity);
+		x = Mul(x, SetF(params.frequency));
+		y = Mul(y, SetF(params.frequency));
+		z = Mul(z, SetF(params.frequency));
+
+		VF sum = FractalFirst<FractalT>(SinglePerlin<InterpT>(params, params.offsets[0], x, y, z));
+		float amp = 1;
+		for (int i = 1; i < params.octaves; i++)
+		{
+			x = Mul(x, lacunarity);
+			y = Mul(y, lacunarity);
+			z = Mul(z, lacunarity);
+
+			amp *= params.gain;
+			sum = FractalOctave<FractalT>(sum, SinglePerlin<InterpT>(params, params.offsets[i], x, y, z), amp);
+		}
+
+		return FractalEnd<FractalT>(params, sum);
+	}
+
+	// 0.6 - x*x - y*y - z*z - w*w of a corner, 0 outside its radius
+	inline VF SimplexCorner(const FastNoiseBatchParams& params, VI i, VI j, VI k, VI l, VF x, VF y, VF z, VF w)
+	{
+		VF t = Sub(Sub(Sub(Sub(SetF(0.6f), Mul(x, x)), Mul(y, y)), Mul(z, z)), Mul(w, w));
+		const VF outside = CmpLt(t, SetF(0));
+		t = Mul(t, t);
+		const VF n = Mul(Mul(t, t), GradCoord4D(params, i, j, k, l, x, y, z, w));
+
+		return AndNotF(outside, n);
+	}
+
+	// SimplexCorner() that also adds the derivative t^4 * g - 8 * t^3 * (g . d) * d of the corner term to grad,
+	// as FastNoise::SimplexCornerWithGradient does
+	inline VF SimplexCornerWithGradient(const FastNoiseBatchParams& params, VI i, VI j, VI k, VI l, VF x, VF y, VF z, VF w, VF* grad)
+	{
+		const VF t = Sub(Sub(Sub(Sub(SetF(0.6f), Mul(x, x)), Mul(y, y)), Mul(z, z)), Mul(w, w));
+		const VF outside = CmpLt(t, SetF(0));
+		const VI lutPos = GradIndex4D(params, i, j, k, l);
+		const VF gx = GatherF(GRAD_4D, lutPos);
+		const VF gy = GatherF(GRAD_4D + 1, lutPos);
+		const VF gz = GatherF(GRAD_4D + 2, lutPos);
+		const VF gw = GatherF(GRAD_4D + 3, lutPos);
+		const VF dot = Add(Add(Add(Mul(x, gx), Mul(y, gy)), Mul(z, gz)), Mul(w, gw));
+		const VF t2 = Mul(t, t);
+		const VF t4 = Mul(t2, t2);
+		const VF slope = Mul(Mul(SetF(-8), Mul(t, t2)), dot);
+		grad[0] = Add(grad[0], AndNotF(outside, Add(Mul(t4, gx), Mul(slope, x))));
+		grad[1] = Add(grad[1], AndNotF(outside, Add(Mul(t4, gy), Mul(slope, y))));
+		grad[2] = Add(grad[2], AndNotF(outside, Add(Mul(t4, gz), Mul(slope, z))));
+		grad[3] = Add(grad[3], AndNotF(outside, Add(Mul(t4, gw), Mul(slope, w))));
+
+		return AndNotF(outside, Mul(t4, dot));
+	}
+
+	template <bool WithGradient>
+	inline VF SimplexTerm(const FastNoiseBatchParams& params, VI i, VI j, VI k, VI l, VF x, VF y, VF z, VF w, VF* grad)
+	{
+		return WithGradient ? SimplexCornerWithGradient(params, i, j, k, l, x, y, z, w, grad) : SimplexCorner(params, i, j, k, l, x, y, z, w);
+	}
+
+	// 1 where rank >= min, else 0
+	inline VI RankStep(VI rank, int min)
+	{
+		return AndI(CmpGtI(rank, SetI(min - 1)), SetI(1));
+	}
+
+	// With WithGradient the derivatives of the sum with respect to the scaled coordinates, times 27, go to grad[0..3]
+	template <bool WithGradient>
+	VF Simplex(const FastNoiseBatchParams& params, VF x, VF y, VF z, VF w, VF* grad)
+	{
+		const VF frequency = SetF(params.frequency);
+		x = Mul(x, frequency);
+		y = Mul(y, frequency);
+		z = Mul(z, frequency);
+		w = Mul(w, frequency);
+
+		VF t = Mul(Add(Add(Add(x, y), z), w), SetF(F4));
+		const VI i = FastFloor(Add(x, t));
+		const VI j = FastFloor(Add(y, t));
+		const VI k = FastFloor(Add(z, t));
+		const VI l = FastFloor(Add(w, t));
+		t = Mul(ConvertF(AddI(AddI(AddI(i, j), k), l)), SetF(G4));
+		const VF x0 = Sub(x, Sub(ConvertF(i), t));
+		const VF y0 = Sub(y, Sub(ConvertF(j), t));
+		const VF z0 = Sub(z, Sub(ConvertF(k), t));
+		const VF w0 = Sub(w, Sub(ConvertF(l), t));
+
+		// a compare mask is -1 where true: the first rank gains 1 where it is set, the second where it is not
+		const VI one = SetI(1);
+		VI rankx = SetI(0), ranky = SetI(0), rankz = SetI(0), rankw = SetI(0);
+		VI m = CastI(CmpGt(x0, y0)); rankx = SubI(rankx, m); ranky = AddI(ranky, AddI(one, m));
+		m = CastI(CmpGt(x0, z0)); rankx = SubI(rankx, m); rankz = AddI(rankz, AddI(one, m));
+		m = CastI(CmpGt(x0, w0)); rankx = SubI(rankx, m); rankw = AddI(rankw, AddI(one, m));
+		m = CastI(CmpGt(y0, z0)); ranky = SubI(ranky, m); rankz = AddI(rankz, AddI(one, m));
+		m = CastI(CmpGt(y0, w0)); ranky = SubI(ranky, m); rankw = AddI(rankw, AddI(one, m));
+		m = CastI(CmpGt(z0, w0)); rankz = SubI(rankz, m); rankw = AddI(rankw, AddI(one, m));
+
+		const VI i1 = RankStep(rankx, 3), j1 = RankStep(ranky, 3), k1 = RankStep(rankz, 3), l1 = RankStep(rankw, 3);
+		const VI i2 = RankStep(rankx, 2), j2 = RankStep(ranky, 2), k2 = RankStep(rankz, 2), l2 = RankStep(rankw, 2);
+		const VI i3 = RankStep(rankx, 1), j3 = RankStep(ranky, 1), k3 = RankStep(rankz, 1), l3 = RankStep(rankw, 1);
+
+		const VF g1 = SetF(G4), g2 = SetF(2 * G4), g3 = SetF(3 * G4), g4 = SetF(4 * G4);
+		const VF x1 = Add(Sub(x0, ConvertF(i1)), g1), y1 = Add(Sub(y0, ConvertF(j1)), g1);
+		const VF z1 = Add(Sub(z0, ConvertF(k1)), g1), w1 = Add(Sub(w0, ConvertF(l1)), g1);
+		const VF x2 = Add(Sub(x0, ConvertF(i2)), g2), y2 = Add(Sub(y0, ConvertF(j2)), g2);
+		const VF z2 = Add(Sub(z0, ConvertF(k2)), g2), w2 = Add(Sub(w0, ConvertF(l2)), g2);
+		const VF x3 = Add(Sub(x0, ConvertF(i3)), g3), y3 = Add(Sub(y0, ConvertF(j3)), g3);
+		const VF z3 = Add(Sub(z0, ConvertF(k3)), g3), w3 = Add(Sub(w0, ConvertF(l3)), g3);
+		const VF x4 = Add(Sub(x0, SetF(1)), g4), y4 = Add(Sub(y0, SetF(1)), g4);
+		const VF z4 = Add(Sub(z0, SetF(1)), g4), w4 = Add(Sub(w0, SetF(1)), g4);
+
+		const VF n0 = SimplexTerm<WithGradient>(params, i, j, k, l, x0, y0, z0, w0, grad);
+		const VF n1 = SimplexTerm<WithGradient>(params, AddI(i, i1), AddI(j, j1), AddI(k, k1), AddI(l, l1), x1, y1, z1, w1, grad);
+		const VF n2 = SimplexTerm<WithGradient>(params, AddI(i, i2), AddI(j, j2), AddI(k, k2), AddI(l, l2), x2, y2, z2, w2, grad);
+		const VF n3 = SimplexTerm<WithGradient>(params, AddI(i, i3), AddI(j, j3), AddI(k, k3), AddI(l, l3), x3, y3, z3, w3, grad);
+		const VF n4 = SimplexTerm<WithGradient>(params, AddI(i, one), AddI(j, one), AddI(k, one), AddI(l, one), x4, y4, z4, w4, grad);
+
+		if (WithGradient)
+		{
+			for (int c = 0; c < 4; c++)
+				grad[c] = Mul(grad[c], SetF(27));
+		}
+		return Mul(SetF(27), Add(Add(Add(Add(n0, n1), n2), n3), n4));
+	}
+
+	VF WhiteNoise(const FastNoiseBatchParams& params, VF x, VF y)
+	{
+		VI xi = CastI(x);
+		VI yi = CastI(y);
+		xi = XorI(xi, ShiftRightI<16>(xi));
+		yi = XorI(yi, ShiftRightI<16>(yi));
+
+		VI n = SetI(params.seed);
+		n = XorI(n, MulI(SetI(X_PRIME), xi));
+		n = XorI(n, MulI(SetI(Y_PRIME), yi));
+		n = MulI(MulI(MulI(n, n), n), SetI(60493));
+
+		// dividing by 2^31 is exact, so is the multiply
+		return Mul(ConvertF(n), SetF(1 / float(2147483648.0)));
+	}
+
+	// Full vectors straight from the arrays, the tail through a padded copy
+	template <class Kernel>
+	void Run(const Kernel& kernel, const float* const* in, int dims, float* out, int count)
+	{
+		int i = 0;
+		for (; i + WIDTH <= count; i += WIDTH)
+		{
+			VF v[4];
+			for (int d = 0; d < dims; d++)
+				v[d] = LoadF(in[d] + i);
+			StoreF(out + i, kernel(v));
+		}
+
+		const int rest = count - i;
+		if (rest > 0)
+		{
+			float pad[4][WIDTH];
+			VF v[4];
+			for (int d = 0; d < dims; d++)
+			{
+				memset(pad[d], 0, sizeof(pad[d]));
+				memcpy(pad[d], in[d] + i, rest * sizeof(float));
+				v[d] = LoadF(pad[d]);
+			}
+			float result[WIDTH];
+			StoreF(result, kernel(v));
+			memcpy(out + i, result, rest * sizeof(float));
+		}
+	}
+
+	// Run() for kernels with several results: kernel(v, result) writes outs vectors, result r goes to out[r]
+	template <class Kernel>
+	void RunMulti(const Kernel& kernel, const float* const* in, int dims, float* const* out, int outs, int count)
+	{
+		int i = 0;
+		for (; i + WIDTH <= count; i += WIDTH)
+		{
+			VF v[4], result[5];
+			for (int d = 0; d < dims; d++)
+				v[d] = LoadF(in[d] + i);
+			kernel(v, result);
+			for (int r = 0; r < outs; r++)
+				StoreF(out[r] + i, result[r]);
+		}
+
+		const int rest = count - i;
+		if (rest > 0)
+		{
+			float pad[4][WIDTH];
+			VF v[4], result[5];
+			for (int d = 0; d < dims; d++)
+			{
+				memset(pad[d], 0, sizeof(pad[d]));
+				memcpy(pad[d], in[d] + i, rest * sizeof(float));
+				v[d] = LoadF(pad[d]);
+			}
+			kernel(v, result);
+			for (int r = 0; r < outs; r++)
+			{
+				float lanes[WIDTH];
+				StoreF(lanes, result[r]);
+				memcpy(out[r] + i, lanes, rest * sizeof(float));
+			}
+		}
+	}
+
+	template <int InterpT, int FractalT>
+	struct PerlinFractal2DKernel
+	{
+		const FastNoiseBatchParams& params;
+		VF operator()(const VF* v) const { return PerlinFractal<InterpT, FractalT>(params, v[0], v[1]); }
+	};
+
+	struct WhiteNoise2DKernel
+	{
+		const FastNoiseBatchParams& params;
+		VF operator()(const VF* v) const { return WhiteNoise(params, v[0], v[1]); }
+	};
+
+	template <int InterpT, int FractalT>
+	struct PerlinFractal3DKernel
+	{
+		const FastNoiseBatchParams& params;
+		VF operator()(const VF* v) const { return PerlinFractal<InterpT, FractalT>(params, v[0], v[1], v[2]); }
+	};
+
+	struct Simplex4DKernel
+	{
+		const FastNoiseBatchParams& params;
+		VF operator()(const VF* v) const { return Simplex<false>(params, v[0], v[1], v[2], v[3], nullptr); }
+	};
+
+	// result: the value, then the derivatives with respect to x, y, z and w
+	struct SimplexWithGradient4DKernel
+	{
+		const FastNoiseBatchParams& params;
+		void operator()(const VF* v, VF* result) const
+		{
+			VF* grad = result + 1;
+			for (int c = 0; c < 4; c++)
+				grad[c] = SetF(0);
+			result[0] = Simplex<true>(params, v[0], v[1], v[2], v[3], grad);
+			for (int c = 0; c < 4; c++)
+				grad[c] = Mul(grad[c], SetF(params.frequency));
+		}
+	};
+
+	template <int InterpT, int FractalT>
+	void BatchPerlinFractal2D(const FastNoiseBatchParams& params, const float* x, const float* y, float* out, int count)
+	{
+		const float* in[] = { x, y };
+		Run(PerlinFractal2DKernel<InterpT, FractalT>{ params }, in, 2, out, count);
+	}
+
+	void BatchWhiteNoise2D(const FastNoiseBatchParams& params, const float* x, const float* y, float* out, int count)
+	{
+		const float* in[] = { x, y };
+		Run(WhiteNoise2DKernel{ params }, in, 2, out, count);
+	}
+
+	template <int InterpT, int FractalT>
+	void BatchPerlinFractal3D(const FastNoiseBatchParams& params, const float* x, const float* y, const float* z, float* out, int count)
+	{
+		const float* in[] = { x, y, z };
+		Run(PerlinFractal3DKernel<InterpT, FractalT>{ params }, in, 3, out, count);
+	}
+
+	void BatchSimplex4D(const FastNoiseBatchParams& params, const float* x, const float* y, const float* z, const float* w, float* out, int count)
+	{
+		const float* in[] = { x, y, z, w };
+		Run(Simplex4DKernel{ params }, in, 4, out, count);
+	}
+
+	void BatchSimplexWithGradient4D(const FastNoiseBatchParams& params, const float* x, const float* y, const float* z, const float* w,
+		float* out, float* gradX, float* gradY, float* gradZ, float* gradW, int count)
+	{
+		const float* in[] = { x, y, z, w };
+		float* const results[] = { out, gradX, gradY, gradZ, gradW };
+		RunMulti(SimplexWithGradient4DKernel{ params }, in, 4, results, 5, count);
+	}
+
+	// Full vectors of columns straight from the row, the tail through a padded copy
+	template <class Kernel>
+	void RunGridRow(const Kernel& kernel, const FastNoiseGridRow& row, float* out, int count)
+	{
+		int i = 0;
+		for (; i + WIDTH <= count; i += WIDTH)
+			StoreF(out + i, kernel(LoadI(row.x0 + i), LoadF(row.xs + i), LoadF(row.xd0 + i)));
+
+		const int rest = count - i;
+		if (rest > 0)
+		{
+			int x0[WIDTH] = {};
+			float xs[WIDTH] = {}, xd0[WIDTH] = {};
+			memcpy(x0, row.x0 + i, rest * sizeof(int));
+			memcpy(xs, row.xs + i, rest * sizeof(float));
+			memcpy(xd0, row.xd0 + i, rest * sizeof(float));
+			float result[WIDTH];
+			StoreF(result, kernel(LoadI(x0), LoadF(xs), LoadF(xd0)));
+			memcpy(out + i, result, rest * sizeof(float));
+		}
+	}
+
+	struct PerlinGridRow2DKernel
+	{
+		const FastNoiseBatchParams& params;
+		VI h0, h1;
+		VF ys, yd0;
+		VF operator()(VI x0, VF xs, VF xd0) const { return PerlinCell(params, h0, h1, x0, xs, xd0, ys, yd0); }
+	};
+
+	struct PerlinGridRow3DKernel
+	{
+		const FastNoiseBatchParams& params;
+		VI h00, h10, h01, h11;
+		VF ys, yd0, zs, zd0;
+		VF operator()(VI x0, VF xs, VF xd0) const { return PerlinCell(params, h00, h10, h01, h11, x0, xs, xd0, ys, yd0, zs, zd0); }
+	};
+
+	void GridRowPerlin2D(const FastNoiseBatchParams& params, const FastNoiseGridRow& row, float* out, int count)
+	{
+		const PerlinGridRow2DKernel kernel = { params, SetI(row.hash[0]), SetI(row.hash[1]), SetF(row.ys), SetF(row.yd0) };
+		RunGridRow(kernel, row, out, count);
+	}
+
+	void GridRowPerlin3D(const FastNoiseBatchParams& params, const FastNoiseGridRow& row, float* out, int count)
+	{
+		const PerlinGridRow3DKernel kernel = { params, SetI(row.hash[0]), SetI(row.hash[1]), SetI(row.hash[2]), SetI(row.hash[3]),
+			SetF(row.ys), SetF(row.yd0), SetF(row.zs), SetF(row.zd0) };
+		RunGridRow(kernel, row, out, count);
+	}
+
+	// One Perlin kernel per [fractal type][interpolation]
+#define FN_BATCH_PERLIN_ROW(Batch, FractalT) { Batch<0, FractalT>, Batch<1, FractalT>, Batch<2, FractalT> }
+
+	const FastNoiseBatchKernels KERNELS =
+	{
+		{ FN_BATCH_PERLIN_ROW(BatchPerlinFractal2D, 0), FN_BATCH_PERLIN_ROW(BatchPerlinFractal2D, 1), FN_BATCH_PERLIN_ROW(BatchPerlinFractal2D, 2) },
+		BatchWhiteNoise2D,
+		{ FN_BATCH_PERLIN_ROW(BatchPerlinFractal3D, 0), FN_BATCH_PERLIN_ROW(BatchPerlinFractal3D, 1), FN_BATCH_PERLIN_ROW(BatchPerlinFractal3D, 2) },
+		BatchSimplex4D,
+		BatchSimplexWithGradient4D,
+		GridRowPerlin2D,
+		GridRowPerlin3D
+	};
+}
+
+#undef FN_BATCH_PERLIN_ROW
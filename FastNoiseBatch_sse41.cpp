@@ -0,0 +1,20 @@
+// FastNoiseBatch_sse41.cpp
+//
+// SSE4.1 kernels of the FastNoise batch functions, 4 points per vector.
+// GCC and Clang build this file with -msse4.1, see CMakeLists.txt.
+//
+
+#include "FastNoise.h"
+#include "FastNoiseBatch_internal.h"
+
+#if !defined(FN_USE_DOUBLES) && (defined(__SSE4_1__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))))
+
+#include "FastNoiseBatch_kernels.inl"
+
+const FastNoiseBatchKernels* FastNoiseBatchKernelsSSE41() { return &KERNELS; }
+
+#else
+
+const FastNoiseBatchKernels* FastNoiseBatchKernelsSSE41() { return nullptr; }
+
+#endif
@@ -0,0 +1,463 @@
+// FastNoiseKernel.h
+//
+// Compile-time configured Perlin noise on top of FastNoise.
+//
+// NoiseKernel<Noise, Fractal, Interpolation, Octaves> has the noise type, fractal type,
+// interpolation and octave count built in, so the per-sample branches on them fold away and a
+// fixed octave loop can be unrolled. The FastNoise Perlin functions dispatch to these kernels
+// once per call; code that knows its configuration can instantiate one directly:
+//
+//   typedef NoiseKernel<FastNoise::PerlinFractal, FastNoise::FBM, FastNoise::Quintic, 3> ShapeNoise;
+//   FN_DECIMAL n = ShapeNoise::Get(noise, x, y, z);
+//
+// The seed, frequency, lacunarity and gain still come from the FastNoise object. Octaves = 0
+// takes the octave count from it too; otherwise it has to match the object's octave count,
+// because the fractal bounding is computed from that.
+// Results are the same as those of the FastNoise functions.
+//
+// GetWithGradient() also returns the analytic partial derivatives of the noise with respect to
+// each input coordinate, so slopes and normals need no extra samples around the point.
+//
+
+#ifndef FASTNOISEKERNEL_H
+#define FASTNOISEKERNEL_H
+
+#include "FastNoise.h"
+#include <assert.h>
+#include <math.h>
+
+namespace FastNoiseDetail
+{
+	const FN_DECIMAL GRAD_X[] =
+	{
+		1, -1, 1, -1,
+		1, -1, 1, -1,
+		0, 0, 0, 0
+	};
+	const FN_DECIMAL GRAD_Y[] =
+	{
+		1, 1, -1, -1,
+		0, 0, 0, 0,
+		1, -1, 1, -1
+	};
+	const FN_DECIMAL GRAD_Z[] =
+	{
+		0, 0, 0, 0,
+		1, 1, -1, -1,
+		1, 1, -1, -1
+	};
+
+	inline int Floor(FN_DECIMAL f) { return (f >= 0 ? (int)f : (int)f - 1); }
+	inline FN_DECIMAL Lerp(FN_DECIMAL a, FN_DECIMAL b, FN_DECIMAL t) { return a + t * (b - a); }
+	inline FN_DECIMAL Abs(FN_DECIMAL f) { return fabs(f); }
+
+	// Get() is the weight of the upper lattice point, Slope() its derivative
+	template <FastNoise::Interp Interpolation> struct InterpWeight;
+	template <> struct InterpWeight<FastNoise::Linear>
+	{
+		static FN_DECIMAL Get(FN_DECIMAL t) { return t; }
+		static FN_DECIMAL Slope(FN_DECIMAL) { return 1; }
+	};
+	template <> struct InterpWeight<FastNoise::Hermite>
+	{
+		static FN_DECIMAL Get(FN_DECIMAL t) { return t*t*(3 - 2 * t); }
+		static FN_DECIMAL Slope(FN_DECIMAL t) { return t*(1 - t) * 6; }
+	};
+	template <> struct InterpWeight<FastNoise::Quintic>
+	{
+		static FN_DECIMAL Get(FN_DECIMAL t) { return t*t*t*(t*(t * 6 - 15) + 10); }
+		static FN_DECIMAL Slope(FN_DECIMAL t) { return t*t*(t - 1)*(t - 1) * 30; }
+	};
+
+	// How the octaves of a fractal are summed: First() starts the sum, Octave() adds octave i > 0,
+	// End() scales the sum into range.
+	// FirstSlope() and OctaveSlope() are the derivatives of what First() and Octave() add with respect
+	// to the octave's noise n; End() is linear, so it scales the summed derivatives as well
+	template <FastNoise::FractalType Fractal> struct FractalSum;
+	template <> struct FractalSum<FastNoise::FBM>
+	{
+		static FN_DECIMAL First(FN_DECIMAL n) { return n; }
+		static FN_DECIMAL Octave(FN_DECIMAL sum, FN_DECIMAL n, FN_DECIMAL amp) { return sum + n * amp; }
+		static FN_DECIMAL End(FN_DECIMAL sum, FN_DECIMAL bounding) { return sum * bounding; }
+		static FN_DECIMAL FirstSlope(FN_DECIMAL) { return 1; }
+		static FN_DECIMAL OctaveSlope(FN_DECIMAL, FN_DECIMAL amp) { return amp; }
+	};
+	template <> struct FractalSum<FastNoise::Billow>
+	{
+		static FN_DECIMAL First(FN_DECIMAL n) { return Abs(n) * 2 - 1; }
+		static FN_DECIMAL Octave(FN_DECIMAL sum, FN_DECIMAL n, FN_DECIMAL amp) { return sum + (Abs(n) * 2 - 1) * amp; }
+		static FN_DECIMAL End(FN_DECIMAL sum, FN_DECIMAL bounding) { return sum * bounding; }
+		static FN_DECIMAL FirstSlope(FN_DECIMAL n) { return n < 0 ? -2 : 2; }
+		static FN_DECIMAL OctaveSlope(FN_DECIMAL n, FN_DECIMAL amp) { return FirstSlope(n) * amp; }
+	};
+	template <> struct FractalSum<FastNoise::RigidMulti>
+	{
+		static FN_DECIMAL First(FN_DECIMAL n) { return 1 - Abs(n); }
+		static FN_DECIMAL Octave(FN_DECIMAL sum, FN_DECIMAL n, FN_DECIMAL amp) { return sum - (1 - Abs(n)) * amp; }
+		static FN_DECIMAL End(FN_DECIMAL sum, FN_DECIMAL) { return sum; }
+		static FN_DECIMAL FirstSlope(FN_DECIMAL n) { return n < 0 ? 1 : -1; }
+		static FN_DECIMAL OctaveSlope(FN_DECIMAL n, FN_DECIMAL amp) { return -FirstSlope(n) * amp; }
+	};
+}
+
+template <FastNoise::NoiseType Noise, FastNoise::FractalType Fractal, FastNoise::Interp Interpolation, int Octaves = 0>
+struct NoiseKernel
+{
+	static_assert(Noise == FastNoise::Perlin || Noise == FastNoise::PerlinFractal, "NoiseKernel implements Perlin and PerlinFractal");
+	static_assert(Octaves >= 0, "Octaves is a count, 0 for the count of the FastNoise object");
+
+	// GetNoise(x, y) of a FastNoise object configured like the kernel
+	static FN_DECIMAL Get(const FastNoise& noise, FN_DECIMAL x, FN_DECIMAL y)
+	{
+		return Sample(noise, x * noise.m_frequency, y * noise.m_frequency);
+	}
+
+	static FN_DECIMAL Get(const FastNoise& noise, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z)
+	{
+		return Sample(noise, x * noise.m_frequency, y * noise.m_frequency, z * noise.m_frequency);
+	}
+
+	// Same with coordinates already multiplied by the frequency
+	static FN_DECIMAL Sample(const FastNoise& noise, FN_DECIMAL x, FN_DECIMAL y)
+	{
+		typedef FastNoiseDetail::FractalSum<Fractal> Sum;
+		if (Noise == FastNoise::Perlin)
+			return Single(noise, 0, x, y);
+
+		const int octaves = GetOctaves(noise);
+		FN_DECIMAL sum = Sum::First(Single(noise, noise.m_perm[0], x, y));
+		FN_DECIMAL amp = 1;
+		for (int i = 1; i < octaves; i++)
+		{
+			x *= noise.m_lacunarity;
+			y *= noise.m_lacunarity;
+
+			amp *= noise.m_gain;
+			sum = Sum::Octave(sum, Single(noise, noise.m_perm[i], x, y), amp);
+		}
+
+		return Sum::End(sum, noise.m_fractalBounding);
+	}
+
+	static FN_DECIMAL Sample(const FastNoise& noise, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z)
+	{
+		typedef FastNoiseDetail::FractalSum<Fractal> Sum;
+		if (Noise == FastNoise::Perlin)
+			return Single(noise, 0, x, y, z);
+
+		const int octaves = GetOctaves(noise);
+		FN_DECIMAL sum = Sum::First(Single(noise, noise.m_perm[0], x, y, z));
+		FN_DECIMAL amp = 1;
+		for (int i = 1; i < octaves; i++)
+		{
+			x *= noise.m_lacunarity;
+			y *= noise.m_lacunarity;
+			z *= noise.m_lacunarity;
+
+			amp *= noise.m_gain;
+			sum = Sum::Octave(sum, Single(noise, noise.m_perm[i], x, y, z), amp);
+		}
+
+		return Sum::End(sum, noise.m_fractalBounding);
+	}
+
+	// out[i] = Get(noise, x[i], y[i]), with the SIMD kernels of this configuration when the CPU has them.
+	// Those are compiled per fractal type and interpolation, the octave count stays a loop bound there
+	static void GetBatch(const FastNoise& noise, const FN_DECIMAL* x, const FN_DECIMAL* y, FN_DECIMAL* out, int count)
+	{
+		CheckOctaves(noise);
+		if (noise.PerlinBatch(Noise == FastNoise::PerlinFractal, Fractal, Interpolation, x, y, out, count))
+			return;
+		for (int i = 0; i < count; i++)
+			out[i] = Get(noise, x[i], y[i]);
+	}
+
+	static void GetBatch(const FastNoise& noise, const FN_DECIMAL* x, const FN_DECIMAL* y, const FN_DECIMAL* z, FN_DECIMAL* out, int count)
+	{
+		CheckOctaves(noise);
+		if (noise.PerlinBatch(Noise == FastNoise::PerlinFractal, Fractal, Interpolation, x, y, z, out, count))
+			return;
+		for (int i = 0; i < count; i++)
+			out[i] = Get(noise, x[i], y[i], z[i]);
+	}
+
+	// Get() that also writes the partial derivatives of the result with respect to x and y
+	// to gradient[0] and gradient[1]. The value is the same as that of Get()
+	static FN_DECIMAL GetWithGradient(const FastNoise& noise, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL* gradient)
+	{
+		typedef FastNoiseDetail::FractalSum<Fractal> Sum;
+		FN_DECIMAL scale = noise.m_frequency;
+		x *= scale;
+		y *= scale;
+		FN_DECIMAL g[2];
+		if (Noise == FastNoise::Perlin)
+		{
+			const FN_DECIMAL n = SingleWithGradient(noise, 0, x, y, g);
+			gradient[0] = g[0] * scale;
+			gradient[1] = g[1] * scale;
+			return n;
+		}
+
+		const int octaves = GetOctaves(noise);
+		FN_DECIMAL n = SingleWithGradient(noise, noise.m_perm[0], x, y, g);
+		FN_DECIMAL slope = Sum::FirstSlope(n) * scale;
+		FN_DECIMAL sum = Sum::First(n);
+		FN_DECIMAL dx = g[0] * slope;
+		FN_DECIMAL dy = g[1] * slope;
+		FN_DECIMAL amp = 1;
+		for (int i = 1; i < octaves; i++)
+		{
+			x *= noise.m_lacunarity;
+			y *= noise.m_lacunarity;
+			scale *= noise.m_lacunarity;
+
+			amp *= noise.m_gain;
+			n = SingleWithGradient(noise, noise.m_perm[i], x, y, g);
+			sum = Sum::Octave(sum, n, amp);
+			slope = Sum::OctaveSlope(n, amp) * scale;
+			dx += g[0] * slope;
+			dy += g[1] * slope;
+		}
+
+		gradient[0] = Sum::End(dx, noise.m_fractalBounding);
+		gradient[1] = Sum::End(dy, noise.m_fractalBounding);
+		return Sum::End(sum, noise.m_fractalBounding);
+	}
+
+	// gradient[0..2] of x, y and z
+	static FN_DECIMAL GetWithGradient(const FastNoise& noise, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL* gradient)
+	{
+		typedef FastNoiseDetail::FractalSum<Fractal> Sum;
+		FN_DECIMAL scale = noise.m_frequency;
+		x *= scale;
+		y *= scale;
+		z *= scale;
+		FN_DECIMAL g[3];
+		if (Noise == FastNoise::Perlin)
+		{
+			const FN_DECIMAL n = SingleWithGradient(noise, 0, x, y, z, g);
+			gradient[0] = g[0] * scale;
+			gradient[1] = g[1] * scale;
+			gradient[2] = g[2] * scale;
+			return n;
+		}
+
+		const int octaves = GetOctaves(noise);
+		FN_DECIMAL n = SingleWithGradient(noise, noise.m_perm[0], x, y, z, g);
+		FN_DECIMAL slope = Sum::FirstSlope(n) * scale;
+		FN_DECIMAL sum = Sum::First(n);
+		FN_DECIMAL dx = g[0] * slope;
+		FN_DECIMAL dy = g[1] * slope;
+		FN_DECIMAL dz = g[2] * slope;
+		FN_DECIMAL amp = 1;
+		for (int i = 1; i < octaves; i++)
+		{
+			x *= noise.m_lacunarity;
+			y *= noise.m_lacunarity;
+			z *= noise.m_lacunarity;
+			scale *= noise.m_lacunarity;
+
+			amp *= noise.m_gain;
+			n = SingleWithGradient(noise, noise.m_perm[i], x, y, z, g);
+			sum = Sum::Octave(sum, n, amp);
+			slope = Sum::OctaveSlope(n, amp) * scale;
+			dx += g[0] * slope;
+			dy += g[1] * slope;
+			dz += g[2] * slope;
+		}
+
+		gradient[0] = Sum::End(dx, noise.m_fractalBounding);
+		gradient[1] = Sum::End(dy, noise.m_fractalBounding);
+		gradient[2] = Sum::End(dz, noise.m_fractalBounding);
+		return Sum::End(sum, noise.m_fractalBounding);
+	}
+
+private:
+	static void CheckOctaves(const FastNoise& noise)
+	{
+		assert(Octaves == 0 || Noise == FastNoise::Perlin || Octaves == noise.m_octaves);
+		(void)noise;
+	}
+
+	static int GetOctaves(const FastNoise& noise)
+	{
+		CheckOctaves(noise);
+		return Octaves > 0 ? Octaves : noise.m_octaves;
+	}
+
+	static FN_DECIMAL Single(const FastNoise& noise, unsigned char offset, FN_DECIMAL x, FN_DECIMAL y)
+	{
+		using namespace FastNoiseDetail;
+		const int x0 = Floor(x);
+		const int y0 = Floor(y);
+		const int x1 = x0 + 1;
+		const int y1 = y0 + 1;
+
+		const FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
+		const FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
+		const FN_DECIMAL xs = InterpWeight<Interpolation>::Get(xd0);
+		const FN_DECIMAL ys = InterpWeight<Interpolation>::Get(yd0);
+		const FN_DECIMAL xd1 = xd0 - 1;
+		const FN_DECIMAL yd1 = yd0 - 1;
+
+		const FN_DECIMAL xf0 = Lerp(Grad(noise, offset, x0, y0, xd0, yd0), Grad(noise, offset, x1, y0, xd1, yd0), xs);
+		const FN_DECIMAL xf1 = Lerp(Grad(noise, offset, x0, y1, xd0, yd1), Grad(noise, offset, x1, y1, xd1, yd1), xs);
+
+		return Lerp(xf0, xf1, ys);
+	}
+
+	static FN_DECIMAL Single(const FastNoise& noise, unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z)
+	{
+		using namespace FastNoiseDetail;
+		const int x0 = Floor(x);
+		const int y0 = Floor(y);
+		const int z0 = Floor(z);
+		const int x1 = x0 + 1;
+		const int y1 = y0 + 1;
+		const int z1 = z0 + 1;
+
+		const FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
+		const FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
+		const FN_DECIMAL zd0 = z - (FN_DECIMAL)z0;
+		const FN_DECIMAL xs = InterpWeight<Interpolation>::Get(xd0);
+		const FN_DECIMAL ys = InterpWeight<Interpolation>::Get(yd0);
+		const FN_DECIMAL zs = InterpWeight<Interpolation>::Get(zd0);
+		const FN_DECIMAL xd1 = xd0 - 1;
+		const FN_DECIMAL yd1 = yd0 - 1;
+		const FN_DECIMAL zd1 = zd0 - 1;
+
+		const FN_DECIMAL xf00 = Lerp(Grad(noise, offset, x0, y0, z0, xd0, yd0, zd0), Grad(noise, offset, x1, y0, z0, xd1, yd0, zd0), xs);
+		const FN_DECIMAL xf10 = Lerp(Grad(noise, offset, x0, y1, z0, xd0, yd1, zd0), Grad(noise, offset, x1, y1, z0, xd1, yd1, zd0), xs);
+		const FN_DECIMAL xf01 = Lerp(Grad(noise, offset, x0, y0, z1, xd0, yd0, zd1), Grad(noise, offset, x1, y0, z1, xd1, yd0, zd1), xs);
+		const FN_DECIMAL xf11 = Lerp(Grad(noise, offset, x0, y1, z1, xd0, yd1, zd1), Grad(noise, offset, x1, y1, z1, xd1, yd1, zd1), xs);
+
+		const FN_DECIMAL yf0 = Lerp(xf00, xf10, ys);
+		const FN_DECIMAL yf1 = Lerp(xf01, xf11, ys);
+
+		return Lerp(yf0, yf1, zs);
+	}
+
+	// Single() that also writes its derivatives to g: the interpolated gradients of the corners plus
+	// the interpolation slope times the difference across the cell
+	static FN_DECIMAL SingleWithGradient(const FastNoise& noise, unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL* g)
+	{
+		using namespace FastNoiseDetail;
+		const int x0 = Floor(x);
+		const int y0 = Floor(y);
+		const int x1 = x0 + 1;
+		const int y1 = y0 + 1;
+
+		const FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
+		const FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
+		const FN_DECIMAL xs = InterpWeight<Interpolation>::Get(xd0);
+		const FN_DECIMAL ys = InterpWeight<Interpolation>::Get(yd0);
+		const FN_DECIMAL xd1 = xd0 - 1;
+		const FN_DECIMAL yd1 = yd0 - 1;
+
+		const unsigned char l00 = GradIndex(noise, offset, x0, y0);
+		const unsigned char l10 = GradIndex(noise, offset, x1, y0);
+		const unsigned char l01 = GradIndex(noise, offset, x0, y1);
+		const unsigned char l11 = GradIndex(noise, offset, x1, y1);
+		const FN_DECIMAL v00 = Grad(l00, xd0, yd0);
+		const FN_DECIMAL v10 = Grad(l10, xd1, yd0);
+		const FN_DECIMAL v01 = Grad(l01, xd0, yd1);
+		const FN_DECIMAL v11 = Grad(l11, xd1, yd1);
+
+		const FN_DECIMAL xf0 = Lerp(v00, v10, xs);
+		const FN_DECIMAL xf1 = Lerp(v01, v11, xs);
+
+		const FN_DECIMAL xSlope = InterpWeight<Interpolation>::Slope(xd0);
+		const FN_DECIMAL ySlope = InterpWeight<Interpolation>::Slope(yd0);
+		g[0] = Lerp(Lerp(GRAD_X[l00], GRAD_X[l10], xs), Lerp(GRAD_X[l01], GRAD_X[l11], xs), ys) + xSlope * Lerp(v10 - v00, v11 - v01, ys);
+		g[1] = Lerp(Lerp(GRAD_Y[l00], GRAD_Y[l10], xs), Lerp(GRAD_Y[l01], GRAD_Y[l11], xs), ys) + ySlope * (xf1 - xf0);
+
+		return Lerp(xf0, xf1, ys);
+	}
+
+	static FN_DECIMAL SingleWithGradient(const FastNoise& noise, unsigned char offset, FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z, FN_DECIMAL* g)
+	{
+		using namespace FastNoiseDetail;
+		const int x0 = Floor(x);
+		const int y0 = Floor(y);
+		const int z0 = Floor(z);
+		const int x1 = x0 + 1;
+		const int y1 = y0 + 1;
+		const int z1 = z0 + 1;
+
+		const FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
+		const FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
+		const FN_DECIMAL zd0 = z - (FN_DECIMAL)z0;
+		const FN_DECIMAL xs = InterpWeight<Interpolation>::Get(xd0);
+		const FN_DECIMAL ys = InterpWeight<Interpolation>::Get(yd0);
+		const FN_DECIMAL zs = InterpWeight<Interpolation>::Get(zd0);
+		const FN_DECIMAL xd1 = xd0 - 1;
+		const FN_DECIMAL yd1 = yd0 - 1;
+		const FN_DECIMAL zd1 = zd0 - 1;
+
+		// corner index bits: x, y, z
+		unsigned char l[8];
+		FN_DECIMAL v[8];
+		for (int c = 0; c < 8; c++)
+		{
+			l[c] = GradIndex(noise, offset, c & 1 ? x1 : x0, c & 2 ? y1 : y0, c & 4 ? z1 : z0);
+			v[c] = Grad(l[c], c & 1 ? xd1 : xd0, c & 2 ? yd1 : yd0, c & 4 ? zd1 : zd0);
+		}
+
+		const FN_DECIMAL xf00 = Lerp(v[0], v[1], xs);
+		const FN_DECIMAL xf10 = Lerp(v[2], v[3], xs);
+		const FN_DECIMAL xf01 = Lerp(v[4], v[5], xs);
+		const FN_DECIMAL xf11 = Lerp(v[6], v[7], xs);
+
+		const FN_DECIMAL yf0 = Lerp(xf00, xf10, ys);
+		const FN_DECIMAL yf1 = Lerp(xf01, xf11, ys);
+
+		const FN_DECIMAL xSlope = InterpWeight<Interpolation>::Slope(xd0);
+		const FN_DECIMAL ySlope = InterpWeight<Interpolation>::Slope(yd0);
+		const FN_DECIMAL zSlope = InterpWeight<Interpolation>::Slope(zd0);
+		g[0] = Trilerp(GRAD_X, l, xs, ys, zs) + xSlope * Lerp(Lerp(v[1] - v[0], v[3] - v[2], ys), Lerp(v[5] - v[4], v[7] - v[6], ys), zs);
+		g[1] = Trilerp(GRAD_Y, l, xs, ys, zs) + ySlope * Lerp(xf10 - xf00, xf11 - xf01, zs);
+		g[2] = Trilerp(GRAD_Z, l, xs, ys, zs) + zSlope * (yf1 - yf0);
+
+		return Lerp(yf0, yf1, zs);
+	}
+
+	// grad[l[c]] of the 8 corners interpolated to the point
+	static FN_DECIMAL Trilerp(const FN_DECIMAL* grad, const unsigned char* l, FN_DECIMAL xs, FN_DECIMAL ys, FN_DECIMAL zs)
+	{
+		using FastNoiseDetail::Lerp;
+		return Lerp(Lerp(Lerp(grad[l[0]], grad[l[1]], xs), Lerp(grad[l[2]], grad[l[3]], xs), ys),
+			Lerp(Lerp(grad[l[4]], grad[l[5]], xs), Lerp(grad[l[6]], grad[l[7]], xs), ys), zs);
+	}
+
+	static unsigned char GradIndex(const FastNoise& noise, unsigned char offset, int x, int y)
+	{
+		return noise.m_perm12[(x & 0xff) + noise.m_perm[(y & 0xff) + offset]];
+	}
+
+	static unsigned char GradIndex(const FastNoise& noise, unsigned char offset, int x, int y, int z)
+	{
+		return noise.m_perm12[(x & 0xff) + noise.m_perm[(y & 0xff) + noise.m_perm[(z & 0xff) + offset]]];
+	}
+
+	static FN_DECIMAL Grad(unsigned char lutPos, FN_DECIMAL xd, FN_DECIMAL yd)
+	{
+		return xd*FastNoiseDetail::GRAD_X[lutPos] + yd*FastNoiseDetail::GRAD_Y[lutPos];
+	}
+
+	static FN_DECIMAL Grad(unsigned char lutPos, FN_DECIMAL xd, FN_DECIMAL yd, FN_DECIMAL zd)
+	{
+		return xd*FastNoiseDetail::GRAD_X[lutPos] + yd*FastNoiseDetail::GRAD_Y[lutPos] + zd*FastNoiseDetail::GRAD_Z[lutPos];
+	}
+
+	static FN_DECIMAL Grad(const FastNoise& noise, unsigned char offset, int x, int y, FN_DECIMAL xd, FN_DECIMAL yd)
+	{
+		return Grad(GradIndex(noise, offset, x, y), xd, yd);
+	}
+
+	static FN_DECIMAL Grad(const FastNoise& noise, unsigned char offset, int x, int y, int z, FN_DECIMAL xd, FN_DECIMAL yd, FN_DECIMAL zd)
+	{
+		return Grad(GradIndex(noise, offset, x, y, z), xd, yd, zd);
+	}
+};
+
+#endif
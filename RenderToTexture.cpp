@@ -24,19 +24,32 @@
 #include "nebula_blob.h"
 #include "asteroid.h"
 #include "asteroid_triplanar.h"
+#include "asteroid_random.h"
 #include <Urho3D/Urho3DAll.h>
 #include "RenderToTexture.h"
 
 
-static unsigned int generate_random_seed()
+static unsigned long long generate_random_seed()
 {
 	static std::random_device rd;
-	static std::default_random_engine gen = std::default_random_engine(rd());
-	static std::uniform_int_distribution<unsigned int> dis(0, UINT_MAX);
+	static std::mt19937_64 gen = std::mt19937_64(rd());
+	static std::uniform_int_distribution<unsigned long long> dis(0, ULLONG_MAX);
 
 	return dis(gen);
 }
 
+/*"-seed <n>" reproduces a previous scene, otherwise every launch is different*/
+static unsigned long long scene_seed()
+{
+	const Vector<String> &args = GetArguments();
+	for (unsigned ii = 0; ii + 1 < args.Size(); ++ii)
+	{
+		if (args[ii] == "-seed")
+			return strtoull(args[ii + 1].CString(), nullptr, 0);
+	}
+	return generate_random_seed();
+}
+
 static void addDebugArrow(Urho3D::DebugRenderer * r, const Urho3D::Vector3 &from, const Urho3D::Vector3 &to, const Urho3D::Color &color, const Urho3D::Vector3 &cameraPos)
 {
 	const float max_arrow_len = 3.0f;
@@ -63,9 +76,9 @@ static const Color default_light_color(0.2f, 0.2f, 0.2f);
 URHO3D_DEFINE_APPLICATION_MAIN(RenderToTexture)
 
 RenderToTexture::RenderToTexture(Context* context) :
-    Sample(context)
+    Sample(context),
+	sceneSeed_(scene_seed())
 {
-	SetRandomSeed(generate_random_seed());
 }
 
 void RenderToTexture::Setup()
@@ -126,12 +139,17 @@ void RenderToTexture::CreateScene()
         light->SetSpecularIntensity(1.0f);
 		light->SetCastShadows(true);
 
+		char seedLog[64];
+		snprintf(seedLog, sizeof(seedLog), "scene seed %llu", sceneSeed_);
+		URHO3D_LOGINFO(seedLog);
+		AsteroidRandom sceneRandom(sceneSeed_);
+
 		const int TexSize = 256;
 		Node * nebulas = scene_->CreateChild("nebulaes");
 		PODVector<Color> colors;
 		for (unsigned ii = 0; ii < 2; ii++)
-			colors.Push(Color(Random(1.0f), Random(1.0f), Random(1.0f)));
-		CreateNebulaBlob(context_, nebulas, colors, TexSize);
+			colors.Push(Color(sceneRandom.Random(1.0f), sceneRandom.Random(1.0f), sceneRandom.Random(1.0f)));
+		CreateNebulaBlob(context_, nebulas, colors, TexSize, sceneRandom.Next64());
 		StaticModelGroup * s = nebulas->GetComponent<StaticModelGroup>();
 		Node * nebula = scene_->CreateChild("nebula");
 		nebula->SetPosition(Vector3(-20.5f, 40.0f, -20.5f));
@@ -144,7 +162,7 @@ void RenderToTexture::CreateScene()
 		diffuses.Push("Textures/TexturesCom_SoilRough0071_1_seamless_S.jpg");
 
 		Node * ast = scene_->CreateChild("asteroids");
-		CreateAsteroidBlob(context_, ast, 256, 20, diffuses);
+		CreateAsteroidBlobAsync(context_, ast, sceneRandom.Next64(), 256, ABM_ICOSPHERE, 2000, diffuses);
 		StaticModelGroup * smg = ast->GetComponent<StaticModelGroup>();
 		Node * ast1 = scene_->CreateChild("asteroid");
 		ast1->SetPosition(Vector3(-20.5f, 40.0f, 20.5f));
@@ -152,7 +170,7 @@ void RenderToTexture::CreateScene()
 		smg->AddInstanceNode(ast1);
 
 		Node * ast_triplanar = scene_->CreateChild("asteroids_triplanar");
-		CreateAsteroidBlob_triplanar(context_, ast_triplanar, 512, 20, diffuses);
+		CreateAsteroidBlobAsync_triplanar(context_, ast_triplanar, sceneRandom.Next64(), 512, ABM_SPHERIFIED_CUBE, 2000, diffuses);
 		StaticModelGroup * smg_triplanar = ast_triplanar->GetComponent<StaticModelGroup>();
 		Node * ast_triplanar1 = scene_->CreateChild("asteroid triplanar");
 		ast_triplanar1->SetPosition(Vector3(-50.5f, 40.0f, 20.5f));
@@ -64,5 +64,7 @@ private:
 	void HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData);
 
 	bool mouseFree{ false };
+	/// Seed of everything generated in the scene.
+	const unsigned long long sceneSeed_;
 	SharedPtr<Node> lightNode;
 };
@@ -1,11 +1,14 @@
 #include <vector>
+#include <stdio.h>
 #include "uv_mapper.hpp"
-#include "FastNoise.h"
+#include "asteroid_mesh.h"
+#include "asteroid_shape.h"
+#include "asteroid_random.h"
+#include "asteroid_cache.h"
+#include "asteroid_heightmap.h"
 #include "asteroid.h"
 #include <Urho3D/Urho3DAll.h>
 
-//uncomment this if u want to subdivide more
-//#define DETAIL_ASTEROID_MODEL		1
 namespace Urho3D
 {
 	struct asteroid_vertex_data_
@@ -16,344 +19,24 @@ namespace Urho3D
 		Vector2 uv;
 	};
 
-	#ifdef DETAIL_ASTEROID_MODEL
-	typedef unsigned IBtype;
-	#else
-	typedef unsigned short IBtype;
-	#endif
-
-
-	static BoundingBox calculateBB(const PODVector<asteroid_vertex_data_> &vd)
+	/*one LOD level; every level has the same number of parts*/
+	struct asteroid_mesh_lod_
 	{
-		BoundingBox ret;
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
-			ret.Merge(vd[ii].position);
-
-		return ret;
-	}
-
-	class XZplaneIterator{
-	public:
-		virtual IBtype iter(unsigned i) const = 0;
-		virtual ~XZplaneIterator() = default;
+		Vector< PODVector<asteroid_vertex_data_> > parts_vd;
+		Vector<AsteroidIndices> parts_id;
 	};
 
-	class TopBottomPlane : public XZplaneIterator
+	/*CPU side result of the mesh stage, turned into Urho buffers on the main thread; lods[0] is the finest*/
+	struct asteroid_mesh_data_
 	{
-	public:
-		TopBottomPlane(IBtype start_offset, const IntVector3 &Segment)
-			: XZplaneIterator(), off(start_offset), seg(Segment)
-		{}
-		IBtype iter(unsigned i) const override
-		{
-			if(i < seg.z_)
-			{
-				return off + i;
-			}
-			else if(i < seg.z_ + seg.x_)
-			{
-				unsigned xx = i - seg.z_;
-				return off + seg.z_ + xx * (seg.z_ + 1);
-			}
-			else if(i < seg.z_ + seg.x_ + seg.z_)
-			{
-				unsigned zz = seg.z_ + seg.x_ + seg.z_ - i;
-				return off + seg.x_ * (seg.z_ + 1) + zz;
-			}
-			else if(i < 2*seg.x_ + 2*seg.z_)
-			{
-				unsigned xx = 2*seg.x_ + 2*seg.z_ - i;
-				return off + xx * (seg.z_ + 1);
-			}
-			else if(i == 2*seg.x_ + 2*seg.z_)
-			{
-				return off;
-			}
-			else
-			{
-				URHO3D_LOGERROR("TopBottomPlane: exceed boundary");
-				return off;
-			}
-		}
-	private:
-		const IBtype off;
-		const IntVector3 seg;
+		Vector<asteroid_mesh_lod_> lods;
+		BoundingBox BB;
 	};
 
-	class MiddlePlane : public XZplaneIterator
-	{
-	public:
-		MiddlePlane(IBtype start_offset, const IntVector3 &Segment)
-			: XZplaneIterator(), off(start_offset), seg(Segment)
-		{}
-		IBtype iter(unsigned i) const override
-		{
-			if(i < 2*seg.x_ + 2*seg.z_)
-			{
-				return off + i;
-			}
-			else if(i == 2*seg.x_ + 2*seg.z_)
-			{
-				return off;
-			}
-			else
-			{
-				URHO3D_LOGERROR("MiddlePlane: exceed boundary");
-				return off;
-			}
-		}
-	private:
-		const IBtype off;
-		const IntVector3 seg;
-	};
-
-	/*
-	quad:
-	i0			i1
-
-	i2			i3
-	*/
-	static void buildQuadIndex(PODVector<IBtype> &id, IBtype i0, IBtype i1, IBtype i2, IBtype i3, const bool bottom)
-	{
-		if (!bottom)
-		{		//CW
-			id.Push(i0); id.Push(i1); id.Push(i3);
-			id.Push(i0); id.Push(i3); id.Push(i2);
-		}
-		else
-		{		//CCW
-			id.Push(i0); id.Push(i3); id.Push(i1);
-			id.Push(i0); id.Push(i2); id.Push(i3);
-		}
-	}
-
-	static IBtype CreateCubeTopBottomPlane(PODVector<asteroid_vertex_data_> &vd, PODVector<IBtype> &id, const Vector3 &Size, const IntVector3 &Segment, 
-		const bool bottom)
-	{
-		const unsigned vdStart = vd.Size();
-		const Vector3 half(Size / 2.0f);
-
-		for (unsigned xx = 0; xx < Segment.x_ + 1; ++xx)
-		{
-			for (unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
-			{
-				asteroid_vertex_data_ data;
-				data.position = Vector3(-half.x_ + xx * Size.x_ / Segment.x_, bottom ? -half.y_ : half.y_, -half.z_ + zz * Size.z_ / Segment.z_);
-				vd.Push(data);
-			}
-		}
-
-		for (unsigned xx = 0; xx < Segment.x_; ++xx)
-		{
-			for (unsigned zz = 0; zz < Segment.z_; ++zz)
-			{
-				IBtype i0 = vdStart + xx * (Segment.z_ + 1) + 1 + zz;
-				IBtype i1 = vdStart + (xx + 1) * (Segment.z_ + 1) + 1 + zz;
-				IBtype i2 = vdStart + xx * (Segment.z_ + 1) + zz;
-				IBtype i3 = vdStart + (xx + 1) * (Segment.z_ + 1) + zz;
-				buildQuadIndex(id, i0, i1, i2, i3, bottom);
-			}
-		}
-
-		return vdStart;
-	}
-	
-	static IBtype CreateMiddleXZVertices(PODVector<asteroid_vertex_data_> &vd, const Vector3 &Size, const IntVector3 &Segment, float y)
-	{
-		const unsigned vdStart = vd.Size();
-		const Vector3 half(Size / 2.0f);
-		for(unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
-		{
-			asteroid_vertex_data_ data;
-			data.position = Vector3(-half.x_, y, -half.z_ + zz * (Size.z_ / Segment.z_));
-			vd.Push(data);
-		}
-		for(unsigned xx = 1; xx < Segment.x_; ++xx)
-		{
-			asteroid_vertex_data_ data;
-			data.position = Vector3(-half.x_ + xx * (Size.x_ / Segment.x_), y, half.z_);
-			vd.Push(data);
-		}
-		for(unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
-		{
-			asteroid_vertex_data_ data;
-			data.position = Vector3(half.x_, y, half.z_ - zz * (Size.z_ / Segment.z_));
-			vd.Push(data);
-		}
-		for(unsigned xx = 1; xx < Segment.x_; ++xx)
-		{
-			asteroid_vertex_data_ data;
-			data.position = Vector3(half.x_ - xx * (Size.x_ / Segment.x_), y, -half.z_);
-			vd.Push(data);
-		}
-		return vdStart;
-	}
-
-	/*create cube without duplicated vertices*/
-	static void CreateCube(PODVector<asteroid_vertex_data_> &vd, PODVector<IBtype> &id, const Vector3 &Size, const IntVector3 &Segment)
-	{
-		if (Segment.x_ <= 0 || Segment.y_ <= 0 || Segment.z_ <= 0 || Size.x_ <= 0.0f || Size.y_ <= 0.0f || Size.z_ <= 0.0f)
-		{
-			URHO3D_LOGERROR("CreateCube: size or segment cannot <= 0");
-			return;
-		}
-
-		const unsigned numVertices = (Segment.x_ + 1) * (Segment.y_ + 1) * 2 + (Segment.y_ + 1)*(Segment.z_ + 1) * 2 + (Segment.x_ + 1)*(Segment.z_ + 1) * 2
-			- 4 * (Segment.x_ - 1) - 4 * (Segment.y_ - 1) - 4 * (Segment.z_ - 1) - 8 * 2;
-		const unsigned numIndices = Segment.x_*Segment.y_ * 2 * 3 * 2 + Segment.y_*Segment.z_ * 2 * 3 * 2 + Segment.x_*Segment.z_ * 2 * 3 * 2;
-
-		#ifndef DETAIL_ASTEROID_MODEL
-		if (numVertices > 65535)
-		{
-			URHO3D_LOGERROR("CreateCube: index buffer need larger type; plz define DETAIL_ASTEROID_MODEL");
-			return;
-		}
-		#endif
-
-		vd.Clear();
-		vd.Reserve(numVertices);
-		id.Clear();
-		id.Reserve(numIndices);
-
-		/*bottom xz plane*/
-		IBtype bottomOff = CreateCubeTopBottomPlane(vd, id, Size, Segment, true);
-		XZplaneIterator * lastPlane = new TopBottomPlane(bottomOff, Segment);
-		XZplaneIterator * newPlane = nullptr;
-		for(unsigned ii=0; ii<Segment.y_-1; ++ii)
-		{
-			IBtype middleOff = CreateMiddleXZVertices(vd,Size, Segment, -Size.y_/2.0f + (ii+1)*(Size.y_/Segment.y_));
-			newPlane = new MiddlePlane(middleOff, Segment);
-			
-			for(unsigned jj=0; jj<Segment.x_*2 + Segment.z_*2; ++jj)
-			{
-				buildQuadIndex(id, newPlane->iter(jj+1), newPlane->iter(jj), lastPlane->iter(jj+1), lastPlane->iter(jj), false);
-			}
-			delete lastPlane;
-			lastPlane = newPlane;
-			newPlane = nullptr;
-		}
-		IBtype topOff = CreateCubeTopBottomPlane(vd, id, Size, Segment, false);
-		newPlane = new TopBottomPlane(topOff, Segment);
-		for(unsigned jj=0; jj<Segment.x_*2 + Segment.z_*2; ++jj)
-		{
-			buildQuadIndex(id, newPlane->iter(jj+1), newPlane->iter(jj), lastPlane->iter(jj+1), lastPlane->iter(jj), false);
-		}
-		delete newPlane;
-		delete lastPlane;
-
-		if(vd.Size() != numVertices)
-		{
-			URHO3D_LOGERROR("numVertices calculation error");
-		}
-
-		if(id.Size() != numIndices)
-		{
-			URHO3D_LOGERROR("numIndices calculation error");
-		}
-	}
-
-	/*Create sphere without duplicated vertices, github.com/caosdoar/spheres*/
-	static void CreateSphere(PODVector<asteroid_vertex_data_> &vd, PODVector<IBtype> &id, const float radius, const unsigned parallels_count, const unsigned meridians_count)
-	{
-		if (radius <= 0.0f || parallels_count < 3 || meridians_count < 3)
-		{
-			URHO3D_LOGERROR("CreateSphere: parameter error");
-			return;
-		}
-
-		const unsigned numVertices = 2 + (parallels_count-1) * meridians_count;
-		const unsigned numIndices = 2 * meridians_count * 3 + (parallels_count - 2) * meridians_count * 6;
-
-		#ifndef DETAIL_ASTEROID_MODEL
-		if (numVertices > 65535)
-		{
-			URHO3D_LOGERROR("CreateSphere: index buffer need larger type; plz define DETAIL_ASTEROID_MODEL");
-			return;
-		}
-		#endif
-
-		vd.Clear();
-		vd.Reserve(numVertices);
-		id.Clear();
-		id.Reserve(numIndices);
-		{
-			asteroid_vertex_data_ north;
-			north.position = Vector3(0.0f, radius, 0.0f);
-			vd.Push(north);
-		}
-		for(unsigned j=0; j<parallels_count-1; ++j)
-		{
-			float const polar = 180.0f * float(j+1) / float(parallels_count);
-			float const sp = Sin(polar);
-			float const cp = Cos(polar);
-			for(unsigned i=0; i<meridians_count; ++i)
-			{
-				float const azimuth = 360.0f * float(i) / float(meridians_count);
-				float const sa = Sin(azimuth);
-				float const ca = Cos(azimuth);
-				float const x = sp * ca * radius;
-				float const y = cp * radius;
-				float const z = sp * sa * radius;
-				asteroid_vertex_data_ point;
-				point.position = Vector3(x, y, z);
-				vd.Push(point);
-			}
-		}
-		{
-			asteroid_vertex_data_ south;
-			south.position = Vector3(0.0f, -radius, 0.0f);
-			vd.Push(south);
-		}
-
-		for(unsigned i=0; i<meridians_count; ++i)
-		{
-			IBtype const a = i + 1;
-			IBtype const b = (i + 1) % meridians_count + 1;
-			id.Push(0);
-			id.Push(b);
-			id.Push(a);
-		}
-		for (unsigned  j = 0; j < parallels_count - 2; ++j)
-		{
-			IBtype aStart = j * meridians_count + 1;
-			IBtype bStart = (j + 1) * meridians_count + 1;
-			for (unsigned i = 0; i < meridians_count; ++i)
-			{
-				const IBtype a = aStart + i;
-				const IBtype a1 = aStart + (i + 1) % meridians_count;
-				const IBtype b = bStart + i;
-				const IBtype b1 = bStart + (i + 1) % meridians_count;
-				id.Push(a);
-				id.Push(a1);
-				id.Push(b1);
-				id.Push(a);
-				id.Push(b1);
-				id.Push(b);
-			}
-		}
-		for (unsigned i = 0; i < meridians_count; ++i)
-		{
-			IBtype const a = i + meridians_count * (parallels_count - 2) + 1;
-			IBtype const b = (i + 1) % meridians_count + meridians_count * (parallels_count - 2) + 1;
-			id.Push(vd.Size()-1);
-			id.Push(a);
-			id.Push(b);
-		}	
-
-		if(vd.Size() != numVertices)
-		{
-			URHO3D_LOGERROR("numVertices calculation error");
-		}
-
-		if(id.Size() != numIndices)
-		{
-			URHO3D_LOGERROR("numIndices calculation error");
-		}	
-	}
-
-	/*split mesh to 2 parts by a plane; output 2 index buffers, they use the same vertex buffer*/
-	static void SplitMesh(const PODVector<asteroid_vertex_data_> &vd, const PODVector<IBtype> &id, const Plane &p, 
-		Vector< PODVector<IBtype> > &parts)
+	/*split mesh to 2 parts by a plane through positions; output 2 index buffers, they use the same vertex buffer*/
+	template <class I>
+	void SplitMesh(const PODVector<Vector3> &positions, const PODVector<I> &id, const Plane &p, 
+		Vector< PODVector<I> > &parts)
 	{
 		if(id.Size() % 3)
 		{
@@ -370,7 +53,7 @@ namespace Urho3D
 			unsigned behindPlane = 0;
 			for(unsigned jj=0; jj<3; ++jj)
 			{
-				if(p.Distance(vd[ id[ii*3 + jj] ].position) < 0.0f)
+				if(p.Distance(positions[ id[ii*3 + jj] ]) < 0.0f)
 				{
 					behindPlane += 1;
 				}
@@ -393,604 +76,643 @@ namespace Urho3D
 		}
 	}
 
-	static void cutByPlane(PODVector<asteroid_vertex_data_> &vd, const Plane &p)
-	{
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
-		{
-			if (p.Distance(vd[ii].position) < 0.0f)
-			{
-				vd[ii].position = p.Project(vd[ii].position);
-			}
-		}
-	}
+	/*parts with more triangles are uv mapped with the multigrid solver; about where it overtakes LDLT*/
+	static const unsigned UV_MULTIGRID_MIN_TRIANGLES = 12000;
 
-	static Vector3 calculateCenter(const PODVector<asteroid_vertex_data_> &vd)
+	/*
+	outSource is the index in vd of every output vertex.
+	uvMap reads vd and id in place and reports the vd index of every vertex it keeps, so normals are carried across directly
+	*/
+	void autoUV(const PODVector<asteroid_vertex_data_> &vd, const PODVector<unsigned> &id,
+		PODVector<asteroid_vertex_data_> &outVd, PODVector<unsigned> &outId, PODVector<unsigned> &outSource)
 	{
-		Vector3 ret(Vector3::ZERO);
-		const unsigned sz = vd.Size();
-
-		for(unsigned ii=0; ii<sz; ++ii)
-		{
-			ret += vd[ii].position;
-		}
-
-		ret /= sz;
-		return ret;
-	}
+		std::vector<int> remap;
+		std::vector<float> outUv;
 
-	static void calculateNormal(PODVector<asteroid_vertex_data_> &vd, const PODVector<IBtype> &id)
-	{
-		if(id.Size() % 3)
+		/*
+		the LDLT fill grows faster than the mesh, multigrid stays close to linear.
+		The square boundary makes every part cover the whole texture once, a disk would leave its corners unused
+		*/
+		const UvSolver solver = id.Size() / 3 > UV_MULTIGRID_MIN_TRIANGLES ? UV_SOLVER_MULTIGRID : UV_SOLVER_LDLT;
+		outId.Resize(id.Size());
+		if (vd.Empty() || id.Empty() ||
+			!uvMap(&vd[0].position.x_, sizeof(asteroid_vertex_data_), vd.Size(), &id[0], id.Size(), remap, &outId[0], outUv, solver, UV_BOUNDARY_SQUARE))
 		{
-			URHO3D_LOGERROR("calculateNormal: size of index buffer mod 3 != 0");
+			outId.Clear();
 			return;
 		}
-		const unsigned numTriangles = id.Size() / 3;
-		const unsigned numVertices = vd.Size();
 
-		for (unsigned ii = 0; ii < numVertices; ++ii)
+		outVd.Resize(remap.size());
+		outSource.Resize(remap.size());
+		for (unsigned ii = 0; ii < remap.size(); ++ii)
 		{
-			Vector3 n(Vector3::ZERO);
-			for (unsigned jj = 0; jj < numTriangles; ++jj)
-			{
-				bool found = false;
-				for(unsigned kk=0; kk<3; ++kk)
-				{
-					if(id[jj*3 + kk] == ii)
-					{
-						found = true;
-						break;
-					}
-				}
-
-				if(found)
-				{
-					Vector3 triNormal((vd[ id[jj*3+1] ].position - vd[ id[jj*3] ].position).CrossProduct(vd[ id[jj*3+2] ].position - vd[ id[jj*3] ].position));
-					n += triNormal;
-				}
-			}
-			
-			vd[ii].normal = n.Normalized();
+			const asteroid_vertex_data_ &src = vd[remap[ii]];
+			outVd[ii].position = src.position;
+			outVd[ii].normal = src.normal;
+			outVd[ii].tangent = Vector4::ZERO;
+			outVd[ii].uv = Vector2(outUv[ii * 2], outUv[ii * 2 + 1]);
+			outSource[ii] = remap[ii];
 		}
 	}
 
-	static unsigned numVerticesBehindPlane(const PODVector<asteroid_vertex_data_> &vd, const Plane &p)
+	/*vertices referenced by a part of a shared vertex buffer, with their base mesh positions*/
+	template <class I>
+	void CompactPart(const PODVector<asteroid_vertex_data_> &vd, const PODVector<Vector3> &basePositions, const PODVector<I> &id,
+		PODVector<asteroid_vertex_data_> &outVd, PODVector<unsigned> &outId, PODVector<Vector3> &outBase)
 	{
-		unsigned ret = 0;
+		PODVector<unsigned> remap(vd.Size());
+		for (unsigned ii = 0; ii < remap.Size(); ++ii)
+			remap[ii] = M_MAX_UNSIGNED;
 
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+		outVd.Clear();
+		outBase.Clear();
+		outId.Resize(id.Size());
+		for (unsigned ii = 0; ii < id.Size(); ++ii)
 		{
-			if (p.Distance(vd[ii].position) < 0.0f)
-				ret += 1;
+			const unsigned src = id[ii];
+			if (remap[src] == M_MAX_UNSIGNED)
+			{
+				remap[src] = outVd.Size();
+				outVd.Push(vd[src]);
+				outBase.Push(basePositions[src]);
+			}
+			outId[ii] = remap[src];
 		}
-
-		return ret;
 	}
 
-	static unsigned numCornersBehindPlane(const BoundingBox &bb, const Plane &p)
+	static int gridCell(float p, float min, float size, int res)
 	{
-		Vector3 bbCorners[8] = {
-			bb.min_,
-			bb.max_,
-			Vector3(bb.min_.x_, bb.min_.y_, bb.max_.z_),
-			Vector3(bb.min_.x_, bb.max_.y_,bb.min_.z_),
-			Vector3(bb.max_.x_, bb.min_.y_, bb.min_.z_),
-			Vector3(bb.max_.x_, bb.max_.y_, bb.min_.z_),
-			Vector3(bb.max_.x_, bb.min_.y_, bb.max_.z_),
-			Vector3(bb.min_.x_, bb.max_.y_, bb.max_.z_)
-		};
-		unsigned cnt = 0;
-
-		for (unsigned ii = 0; ii < 8; ++ii)
-		{
-			if (p.Distance(bbCorners[ii]) < 0.0f)
-			{
-				cnt += 1;
-			}
-		}
-		return cnt;
+		return Clamp((int)((p - min) / size), 0, res - 1);
 	}
 
-	static void autoUV(const PODVector<asteroid_vertex_data_> &vd, const PODVector<IBtype> &id,
-		PODVector<asteroid_vertex_data_> &outVd, PODVector<IBtype> &outId)
+	/*
+	uv of every coarse vertex from the nearest fine vertex of the same part.
+	Distances are measured on the base mesh, where every level lies on the same sphere or cube
+	and coarse vertices mostly coincide with fine ones, so no second parameterization is solved.
+	*/
+	static void TransferUVs(const PODVector<Vector3> &fineBase, const PODVector<asteroid_vertex_data_> &fineVd,
+		const PODVector<Vector3> &coarseBase, PODVector<asteroid_vertex_data_> &coarseVd)
 	{
-		std::vector<float> vertices, outVertices;
-		std::vector<int> indices, outIndices;
-		std::vector<float> outUv;
+		if (fineBase.Empty())
+			return;
 
-		vertices.reserve(vd.Size() * 3);
-		indices.reserve(id.Size());
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+		Vector3 bbMin = fineBase[0];
+		Vector3 bbMax = fineBase[0];
+		for (unsigned ii = 1; ii < fineBase.Size(); ++ii)
 		{
-			vertices.push_back(vd[ii].position.x_);
-			vertices.push_back(vd[ii].position.y_);
-			vertices.push_back(vd[ii].position.z_);
-		}
-		for (unsigned ii = 0; ii < id.Size(); ++ii)
-		{
-			indices.push_back(id[ii]);
+			bbMin = Vector3(Min(bbMin.x_, fineBase[ii].x_), Min(bbMin.y_, fineBase[ii].y_), Min(bbMin.z_, fineBase[ii].z_));
+			bbMax = Vector3(Max(bbMax.x_, fineBase[ii].x_), Max(bbMax.y_, fineBase[ii].y_), Max(bbMax.z_, fineBase[ii].z_));
 		}
 
-		uvMap(vertices, indices, outVertices, outIndices, outUv, nullptr);
+		/*uniform grid with a few fine vertices per cell*/
+		const int res = Clamp((int)Pow(fineBase.Size() * 0.5f, 1.0f / 3.0f), 1, 64);
+		const Vector3 cellSize(Max((bbMax.x_ - bbMin.x_) / res, M_EPSILON), Max((bbMax.y_ - bbMin.y_) / res, M_EPSILON), Max((bbMax.z_ - bbMin.z_) / res, M_EPSILON));
+		const float minCellSize = Min(cellSize.x_, Min(cellSize.y_, cellSize.z_));
 
-		for (unsigned ii = 0; ii < outVertices.size(); ii += 3)
+		PODVector<unsigned> cellStart(res * res * res + 1);
+		PODVector<unsigned> cellItems(fineBase.Size());
+		PODVector<unsigned> itemCell(fineBase.Size());
+		for (unsigned ii = 0; ii < cellStart.Size(); ++ii)
+			cellStart[ii] = 0;
+		for (unsigned ii = 0; ii < fineBase.Size(); ++ii)
 		{
-			asteroid_vertex_data_ v;
-			v.position = Vector3(outVertices[ii], outVertices[ii + 1], outVertices[ii + 2]);
-			outVd.Push(v);
+			const int x = gridCell(fineBase[ii].x_, bbMin.x_, cellSize.x_, res);
+			const int y = gridCell(fineBase[ii].y_, bbMin.y_, cellSize.y_, res);
+			const int z = gridCell(fineBase[ii].z_, bbMin.z_, cellSize.z_, res);
+			itemCell[ii] = (z * res + y) * res + x;
+			++cellStart[itemCell[ii] + 1];
 		}
-
-		for (unsigned ii = 0; ii < outVd.Size(); ++ii)
+		for (unsigned ii = 1; ii < cellStart.Size(); ++ii)
+			cellStart[ii] += cellStart[ii - 1];
 		{
-			outVd[ii].uv = Vector2(outUv[ii * 2], outUv[ii * 2 + 1]);
+			PODVector<unsigned> fill(cellStart);
+			for (unsigned ii = 0; ii < fineBase.Size(); ++ii)
+				cellItems[fill[itemCell[ii]]++] = ii;
 		}
 
-		/*recover normal*/
-		for (unsigned ii = 0; ii < outVd.Size(); ++ii)
+		for (unsigned ii = 0; ii < coarseVd.Size(); ++ii)
 		{
-			for (unsigned jj = 0; jj < vd.Size(); ++jj)
+			const Vector3 &p = coarseBase[ii];
+			const int cx = gridCell(p.x_, bbMin.x_, cellSize.x_, res);
+			const int cy = gridCell(p.y_, bbMin.y_, cellSize.y_, res);
+			const int cz = gridCell(p.z_, bbMin.z_, cellSize.z_, res);
+			unsigned best = M_MAX_UNSIGNED;
+			float bestDistance = M_INFINITY;
+			/*grow a shell of cells until nothing outside it can be closer*/
+			for (int r = 0; r <= res; ++r)
 			{
-				if (outVd[ii].position == vd[jj].position)
+				for (int z = Max(cz - r, 0); z <= Min(cz + r, res - 1); ++z)
 				{
-					outVd[ii].normal = vd[jj].normal;
-					break;
+					for (int y = Max(cy - r, 0); y <= Min(cy + r, res - 1); ++y)
+					{
+						for (int x = Max(cx - r, 0); x <= Min(cx + r, res - 1); ++x)
+						{
+							if (Abs(x - cx) != r && Abs(y - cy) != r && Abs(z - cz) != r)
+								continue;
+							const unsigned cell = (z * res + y) * res + x;
+							for (unsigned jj = cellStart[cell]; jj < cellStart[cell + 1]; ++jj)
+							{
+								const float distance = (fineBase[cellItems[jj]] - p).LengthSquared();
+								if (distance < bestDistance)
+								{
+									bestDistance = distance;
+									best = cellItems[jj];
+								}
+							}
+						}
+					}
 				}
+				if (best != M_MAX_UNSIGNED && bestDistance <= (r * minCellSize) * (r * minCellSize))
+					break;
 			}
+			coarseVd[ii].uv = fineVd[best].uv;
 		}
+	}
 
-		for (unsigned ii = 0; ii < outIndices.size(); ++ii)
-		{
-			outId.Push(outIndices[ii]);
-		}
+	/*
+	uv of a base mesh position on cube face `face` (+X, -X, +Y, -Y, +Z, -Z): projected from the center onto the face, which covers the
+	whole texture. u x v points out of the face, so the charts keep the winding of the mesh
+	*/
+	static Vector2 cubeFaceUV(const Vector3 &p, unsigned face)
+	{
+		/*outward normal, u and v axis of every face*/
+		static const Vector3 axes[6][3] =
+		{
+			{ Vector3::RIGHT, Vector3::BACK, Vector3::UP },
+			{ Vector3::LEFT, Vector3::FORWARD, Vector3::UP },
+			{ Vector3::UP, Vector3::RIGHT, Vector3::BACK },
+			{ Vector3::DOWN, Vector3::RIGHT, Vector3::FORWARD },
+			{ Vector3::FORWARD, Vector3::RIGHT, Vector3::UP },
+			{ Vector3::BACK, Vector3::LEFT, Vector3::UP }
+		};
+		const float d = Max(p.DotProduct(axes[face][0]), M_EPSILON);
+		return Vector2((p.DotProduct(axes[face][1]) / d + 1.0f) * 0.5f, (p.DotProduct(axes[face][2]) / d + 1.0f) * 0.5f);
 	}
 
-	static Model * CreateMesh(Context* ctx, unsigned edge_division)
+	/*cube face the direction points at most*/
+	static unsigned cubeFace(const Vector3 &p)
 	{
-		bool sphereBase = false;
-		if (Random(1.0f) < 0.5f)
-			sphereBase = true;
-		PODVector<asteroid_vertex_data_> vd;
-		PODVector<IBtype> id;
-		BoundingBox BB;
-		const IntVector3 segment(edge_division, edge_division, edge_division);
-		
-		if(sphereBase)
-			CreateSphere(vd, id, 0.5f, edge_division/2, edge_division);
-		else
-			CreateCube(vd, id, Vector3::ONE, segment);
+		const Vector3 a = p.Abs();
+		if (a.x_ >= a.y_ && a.x_ >= a.z_)
+			return p.x_ >= 0.0f ? 0 : 1;
+		if (a.y_ >= a.z_)
+			return p.y_ >= 0.0f ? 2 : 3;
+		return p.z_ >= 0.0f ? 4 : 5;
+	}
 
-		/*random scale*/
-		Vector3 scale(Random(0.5f, 1.5f), Random(0.5f, 1.5f), Random(0.5f, 1.5f));
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
-		{
-			vd[ii].position *= scale;
-		}
+	/*
+	uv without a solve: every triangle is mapped onto the cube face its base mesh center points at.
+	A vertex is duplicated for every face its triangles use; the copies keep the position and normal of the welded source vertex,
+	so only the uv is discontinuous at the seams
+	*/
+	static void cubeFaceUVs(const PODVector<asteroid_vertex_data_> &vd, const PODVector<Vector3> &basePositions, const PODVector<unsigned> &id,
+		PODVector<asteroid_vertex_data_> &outVd, PODVector<unsigned> &outId)
+	{
+		/*output vertex of every (source vertex, face)*/
+		PODVector<unsigned> weld(vd.Size() * 6);
+		for (unsigned ii = 0; ii < weld.Size(); ++ii)
+			weld[ii] = M_MAX_UNSIGNED;
 
-		/*random cut with plane*/
-		const unsigned numCutPlane = 8;
-		BB = calculateBB(vd);
-		const float plane_points_x_start[numCutPlane] = { 0, BB.min_.x_ , 0, BB.min_.x_, 0, BB.min_.x_ ,0, BB.min_.x_ };
-		const float plane_points_x_end[numCutPlane] = { BB.max_.x_, 0, BB.max_.x_ , 0, BB.max_.x_, 0, BB.max_.x_ , 0 };
-		const float plane_points_y_start[numCutPlane] = { 0, 0, 0, 0, BB.min_.y_ ,BB.min_.y_ ,BB.min_.y_ ,BB.min_.y_ };
-		const float plane_points_y_end[numCutPlane] = { BB.max_.y_, BB.max_.y_, BB.max_.y_, BB.max_.y_, 0, 0, 0, 0 };
-		const float plane_points_z_start[numCutPlane] = { 0, 0, BB.min_.z_, BB.min_.z_, 0, 0, BB.min_.z_, BB.min_.z_ };
-		const float plane_points_z_end[numCutPlane] = { BB.max_.z_, BB.max_.z_, 0, 0, BB.max_.z_, BB.max_.z_, 0, 0 };
-		for (unsigned ii = 0; ii < numCutPlane; ++ii)
+		outVd.Clear();
+		outId.Resize(id.Size());
+		for (unsigned ii = 0; ii + 2 < id.Size(); ii += 3)
 		{
-			while (true)
+			const unsigned face = cubeFace(basePositions[id[ii]] + basePositions[id[ii + 1]] + basePositions[id[ii + 2]]);
+			for (unsigned jj = 0; jj < 3; ++jj)
 			{
-				Quaternion q(Random(-30.0f, 30.0f), Random(-30.0f, 30.0f), Random(-30.0f, 30.0f));
-				Vector3 plane_point(Random(plane_points_x_start[ii], plane_points_x_end[ii]), Random(plane_points_y_start[ii], plane_points_y_end[ii]),
-					Random(plane_points_z_start[ii], plane_points_z_end[ii]));
-				Plane plane(-(q * plane_point), plane_point);
-				if (numCornersBehindPlane(BB, plane) == 1 && numVerticesBehindPlane(vd, plane) > 0)
+				const unsigned source = id[ii + jj];
+				unsigned &out = weld[source * 6 + face];
+				if (out == M_MAX_UNSIGNED)
 				{
-					cutByPlane(vd, plane);
-					break;
+					out = outVd.Size();
+					asteroid_vertex_data_ v = vd[source];
+					v.tangent = Vector4::ZERO;
+					v.uv = cubeFaceUV(basePositions[source], face);
+					outVd.Push(v);
 				}
+				outId[ii + jj] = out;
 			}
 		}
-		calculateNormal(vd, id);
+	}
 
-		/*displace with noise*/
-		{
-			PODVector<float> displacements;
-			displacements.Reserve(vd.Size());
-			FastNoise *perlin = new FastNoise(Random(0, M_MAX_UNSIGNED));
-			perlin->SetFrequency(Random(0.01f, 0.03f));
-			const float noiseScale = Random(100.0f, 200.0f);
-			const float noiseFactor = Random(0.05f, 0.2f);
-			float noiseMax = FLT_MIN, noiseMin = FLT_MAX;
-			for (unsigned ii = 0; ii < vd.Size(); ++ii)
-			{
-				Vector3 p(vd[ii].position * noiseScale);
-				float noise = perlin->GetPerlinFractal(p.x_, p.y_, p.z_);
-				if (noise > noiseMax)
-					noiseMax = noise;
-				if (noise < noiseMin)
-					noiseMin = noise;
-				displacements.Push(noise);
-			}
-			delete perlin;
-			//normalize to [-0.5, 0.5]
-			for (unsigned ii = 0; ii < displacements.Size(); ++ii)
-			{
-				displacements[ii] = (displacements[ii] - noiseMin) / (noiseMax - noiseMin) - 0.5f;
-			}
-			for (unsigned ii = 0; ii < vd.Size(); ++ii)
-			{
-				//vd[ii].position = vd[ii].position + displacements[ii] * noiseFactor * (center - vd[ii].position).Normalized();
-				vd[ii].position = vd[ii].position + displacements[ii] * noiseFactor * vd[ii].normal;
-			}
-		}
+	static void GeneratePartTangents(PODVector<asteroid_vertex_data_> &vd, const AsteroidIndices &id)
+	{
+		GenerateTangents(vd.Buffer(), sizeof(asteroid_vertex_data_), id.Data(), id.IndexSize(), 0, id.Size(),
+			offsetof(asteroid_vertex_data_, normal), offsetof(asteroid_vertex_data_, uv), offsetof(asteroid_vertex_data_, tangent));
+	}
 
-		BB = calculateBB(vd);
-		calculateNormal(vd, id);
-		Vector3 center = calculateCenter(vd);
+	/*
+	shape of every level, split into parts; shared read-only by the part tasks.
+	lods_*[0] is the finest level. With AUV_HARMONIC its parts are uv mapped and the coarser ones take their uv from it;
+	with AUV_CUBE_FACES there is one part and every level is mapped on its own
+	*/
+	struct asteroid_mesh_shape_
+	{
+		AsteroidUvMode uvMode;
+		Vector< PODVector<asteroid_vertex_data_> > lods_vd;
+		/*base mesh position of every vertex, the common parameterization of all levels*/
+		Vector< PODVector<Vector3> > lods_base;
+		Vector< Vector< PODVector<unsigned> > > lods_parts;
 
-		Vector< PODVector<IBtype> > parts;
+		void Clear()
 		{
-			Plane split(Vector3::UP, center);
-			SplitMesh(vd, id, split, parts);
+			lods_vd.Clear();
+			lods_base.Clear();
+			lods_parts.Clear();
 		}
-		
-		Vector< PODVector<asteroid_vertex_data_> > new_parts_vd(parts.Size());
-		Vector< PODVector<IBtype> > new_parts_id(parts.Size());
-		for (unsigned ii = 0; ii < parts.Size(); ++ii)
-		{
-			autoUV(vd, parts[ii], new_parts_vd[ii], new_parts_id[ii]);
-			GenerateTangents(new_parts_vd[ii].Buffer(), sizeof(asteroid_vertex_data_), new_parts_id[ii].Buffer(), sizeof(IBtype), 0, new_parts_id[ii].Size(),
-				offsetof(asteroid_vertex_data_, normal), offsetof(asteroid_vertex_data_, uv), offsetof(asteroid_vertex_data_, tangent));
+	};
+
+	/*
+	pure CPU, safe to run on a worker thread.
+	Generates and splits every level, and sizes mesh so that CreateMeshPart() can fill the parts concurrently
+	*/
+	static void CreateMeshShape(AsteroidBaseMesh base, unsigned detail, AsteroidUvMode uvMode, AsteroidRandom &rng, asteroid_mesh_shape_ &shape,
+		asteroid_mesh_data_ &mesh)
+	{
+		shape.Clear();
+		shape.uvMode = uvMode;
+		shape.lods_vd.Resize(1);
+		shape.lods_base.Resize(1);
+		shape.lods_parts.Resize(1);
+
+		VertexStreams vs;
+		PODVector<unsigned> id;
+		AsteroidShapeParams params;
+		GenerateAsteroidShape(base, detail, rng, vs, id, params, &shape.lods_base[0]);
+		mesh.BB = calculateBB(vs);
+		/*
+		every level is split by the same plane, so each part keeps its uv island across levels.
+		The split is done on the base mesh, which the random scale, cuts and noise never change, so every asteroid of a base mesh
+		and detail has parts of the same connectivity and uvMap reuses their matrix pattern
+		*/
+		const Plane split(Vector3::UP, Vector3::ZERO);
+
+		streamsToVertices(vs, shape.lods_vd[0]);
+		if (uvMode == AUV_CUBE_FACES)
+			shape.lods_parts[0].Push(id);
+		else
+			SplitMesh(shape.lods_base[0], id, split, shape.lods_parts[0]);
+		const unsigned numParts = shape.lods_parts[0].Size();
+
+		/*coarser levels: same shape parameters on a coarser base mesh*/
+		for (unsigned level = 1; level < ASTEROID_MAX_LODS; ++level)
+		{
+			const unsigned lodDetail = AsteroidLodDetail(base, detail, level);
+			if (lodDetail == 0)
+				break;
+
+			VertexStreams lodVs;
+			PODVector<unsigned> lodId;
+			PODVector<Vector3> lodBase;
+			GenerateAsteroidShapeLod(base, lodDetail, params, lodVs, lodId, &lodBase);
+			if (lodVs.Size() == 0)
+				break;
+
+			PODVector<asteroid_vertex_data_> lodVd;
+			streamsToVertices(lodVs, lodVd);
+			Vector< PODVector<unsigned> > lodParts;
+			if (uvMode == AUV_CUBE_FACES)
+				lodParts.Push(lodId);
+			else
+				SplitMesh(lodBase, lodId, split, lodParts);
+			if (lodParts.Size() != numParts)
+				break;
+
+			shape.lods_vd.Push(lodVd);
+			shape.lods_base.Push(lodBase);
+			shape.lods_parts.Push(lodParts);
 		}
 
-		PODVector<Geometry*> geometries;
-		for (unsigned ii = 0; ii < parts.Size(); ++ii)
+		mesh.lods.Clear();
+		mesh.lods.Resize(shape.lods_vd.Size());
+		for (unsigned lod = 0; lod < mesh.lods.Size(); ++lod)
 		{
-			VertexBuffer * vb(new VertexBuffer(ctx));
-			IndexBuffer * ib(new IndexBuffer(ctx));
-			Geometry * geom(new Geometry(ctx));
-			vb->SetShadowed(true);
-			PODVector<VertexElement> elements;
-			elements.Push(VertexElement(TYPE_VECTOR3, SEM_POSITION));
-			elements.Push(VertexElement(TYPE_VECTOR3, SEM_NORMAL));
-			elements.Push(VertexElement(TYPE_VECTOR4, SEM_TANGENT));
-			elements.Push(VertexElement(TYPE_VECTOR2, SEM_TEXCOORD));
-			vb->SetSize(new_parts_vd[ii].Size(), elements);
-			vb->SetData(new_parts_vd[ii].Buffer());
-
-			ib->SetShadowed(true);
-			#ifdef DETAIL_ASTEROID_MODEL
-			bool largeIndices = true;
-			#else
-			bool largeIndices = false;
-			#endif
-			ib->SetSize(new_parts_id[ii].Size(), largeIndices);
-			ib->SetData(new_parts_id[ii].Buffer());
-
-			geom->SetVertexBuffer(0, vb);
-			geom->SetIndexBuffer(ib);
-			geom->SetDrawRange(TRIANGLE_LIST, 0, new_parts_id[ii].Size());
-			geometries.Push(geom);
+			mesh.lods[lod].parts_vd.Resize(numParts);
+			mesh.lods[lod].parts_id.Resize(numParts);
 		}
-		
-		Model * fromScratchModel(new Model(ctx));
-		fromScratchModel->SetNumGeometries(geometries.Size());
-		for (unsigned ii = 0; ii < geometries.Size(); ++ii)
+	}
+
+	/*
+	pure CPU, safe to run on a worker thread.
+	uv and tangents of one part on every level; writes only that part of mesh, so the parts can run concurrently
+	*/
+	static void CreateMeshPart(const asteroid_mesh_shape_ &shape, unsigned part, asteroid_mesh_data_ &mesh)
+	{
+		if (shape.uvMode == AUV_CUBE_FACES)
 		{
-			fromScratchModel->SetGeometry(ii, 0, geometries[ii]);
+			for (unsigned lod = 0; lod < shape.lods_vd.Size(); ++lod)
+			{
+				PODVector<unsigned> partId;
+				cubeFaceUVs(shape.lods_vd[lod], shape.lods_base[lod], shape.lods_parts[lod][part], mesh.lods[lod].parts_vd[part], partId);
+				mesh.lods[lod].parts_id[part].Assign(partId, mesh.lods[lod].parts_vd[part].Size());
+				GeneratePartTangents(mesh.lods[lod].parts_vd[part], mesh.lods[lod].parts_id[part]);
+			}
+			return;
 		}
-		fromScratchModel->SetBoundingBox(BB);
-		
 
-		return fromScratchModel;
+		PODVector<asteroid_vertex_data_> &vd = mesh.lods[0].parts_vd[part];
+		AsteroidIndices &id = mesh.lods[0].parts_id[part];
+		PODVector<unsigned> partId;
+		PODVector<unsigned> source;
+		autoUV(shape.lods_vd[0], shape.lods_parts[0][part], vd, partId, source);
+		id.Assign(partId, vd.Size());
+		PODVector<Vector3> base(source.Size());
+		for (unsigned ii = 0; ii < source.Size(); ++ii)
+			base[ii] = shape.lods_base[0][source[ii]];
+		GeneratePartTangents(vd, id);
+
+		for (unsigned lod = 1; lod < shape.lods_vd.Size(); ++lod)
+		{
+			PODVector<asteroid_vertex_data_> &lodVd = mesh.lods[lod].parts_vd[part];
+			AsteroidIndices &lodId = mesh.lods[lod].parts_id[part];
+			PODVector<unsigned> lodPartId;
+			PODVector<Vector3> lodBase;
+			CompactPart(shape.lods_vd[lod], shape.lods_base[lod], shape.lods_parts[lod][part], lodVd, lodPartId, lodBase);
+			lodId.Assign(lodPartId, lodVd.Size());
+			TransferUVs(base, vd, lodBase, lodVd);
+			GeneratePartTangents(lodVd, lodId);
+		}
 	}
 
-	// github.com/cpetry/NormalMap-Online
-	static Image * CalculateNormalMapFromHeight(Context* ctx, const Image * heightMap)
+	static Geometry * CreateGeometry(Context* ctx, const PODVector<asteroid_vertex_data_> &vd, const AsteroidIndices &id)
 	{
-		const int w = heightMap->GetWidth();
-		const int h = heightMap->GetHeight();
-
-		Image * ret = new Image(ctx);
-		if (ret->SetSize(w, h, 4) == false)
-		{
-			URHO3D_LOGERROR("CalculateNormalMapFromHeight: Image::SetSize fail");
-			delete ret;
-			return nullptr;
-		}
+		VertexBuffer * vb(new VertexBuffer(ctx));
+		IndexBuffer * ib(new IndexBuffer(ctx));
+		Geometry * geom(new Geometry(ctx));
+		vb->SetShadowed(true);
+		PODVector<VertexElement> elements;
+		elements.Push(VertexElement(TYPE_VECTOR3, SEM_POSITION));
+		elements.Push(VertexElement(TYPE_VECTOR3, SEM_NORMAL));
+		elements.Push(VertexElement(TYPE_VECTOR4, SEM_TANGENT));
+		elements.Push(VertexElement(TYPE_VECTOR2, SEM_TEXCOORD));
+		vb->SetSize(vd.Size(), elements);
+		vb->SetData(vd.Buffer());
+
+		ib->SetShadowed(true);
+		ib->SetSize(id.Size(), id.IsLarge());
+		ib->SetData(id.Data());
+
+		geom->SetVertexBuffer(0, vb);
+		geom->SetIndexBuffer(ib);
+		geom->SetDrawRange(TRIANGLE_LIST, 0, id.Size());
+		return geom;
+	}
 
-		const float Strength = 2.5f;
-		const float Level = 7.0f;
-
-		const int type = 0;
-		//webgl setting default is [1,1,-1]
-		const float invertR = 1.0f;		//-1 or 1
-		const float invertG = 1.0f;		//-1 or 1
-		const float invertH = -1.0f;		//-1 or 1
-		Vector2 step(-1.0f / w, -1.0f / h);
-		float dz = (1.0f / Strength) * (1.0f + Pow(2.0f, Level));
-		for (int x = 0; x < w; ++x)
+	/*creates Urho objects, main thread only*/
+	static Model * CreateModel(Context* ctx, const asteroid_mesh_data_ &mesh)
+	{
+		const unsigned numParts = mesh.lods.Empty() ? 0 : mesh.lods[0].parts_vd.Size();
+		Model * fromScratchModel(new Model(ctx));
+		fromScratchModel->SetNumGeometries(numParts);
+		for (unsigned ii = 0; ii < numParts; ++ii)
 		{
-			for (int y = 0; y < h; ++y)
+			fromScratchModel->SetNumGeometryLodLevels(ii, mesh.lods.Size());
+			for (unsigned lod = 0; lod < mesh.lods.Size(); ++lod)
 			{
-				Vector2 vUv((float)x/w, (float)y/h);
-				Vector2 tlv = Vector2(vUv.x_ - step.x_, vUv.y_ + step.y_);
-				Vector2 lv = Vector2(vUv.x_ - step.x_, vUv.y_);
-				Vector2 blv = Vector2(vUv.x_ - step.x_, vUv.y_ - step.y_);
-				Vector2 tv = Vector2(vUv.x_, vUv.y_ + step.y_);
-				Vector2 bv = Vector2(vUv.x_, vUv.y_ - step.y_);
-				Vector2 trv = Vector2(vUv.x_ + step.x_, vUv.y_ + step.y_);
-				Vector2 rv = Vector2(vUv.x_ + step.x_, vUv.y_);
-				Vector2 brv = Vector2(vUv.x_ + step.x_, vUv.y_ - step.y_);
-				tlv = Vector2(tlv.x_ >= 0.0 ? tlv.x_ : (1.0f + tlv.x_), tlv.y_ >= 0.0f ? tlv.y_ : (1.0f + tlv.y_));
-				tlv = Vector2(tlv.x_ < 1.0f ? tlv.x_ : (tlv.x_ - 1.0f), tlv.y_ < 1.0f ? tlv.y_ : (tlv.y_ - 1.0f));
-				lv = Vector2(lv.x_ >= 0.0f ? lv.x_ : (1.0f + lv.x_), lv.y_ >= 0.0f ? lv.y_ : (1.0f + lv.y_));
-				lv = Vector2(lv.x_ < 1.0f ? lv.x_ : (lv.x_ - 1.0f), lv.y_ < 1.0f ? lv.y_ : (lv.y_ - 1.0f));
-				blv = Vector2(blv.x_ >= 0.0f ? blv.x_ : (1.0f + blv.x_), blv.y_ >= 0.0f ? blv.y_ : (1.0f + blv.y_));
-				blv = Vector2(blv.x_ < 1.0f ? blv.x_ : (blv.x_ - 1.0f), blv.y_ < 1.0f ? blv.y_ : (blv.y_ - 1.0f));
-				tv = Vector2(tv.x_ >= 0.0f ? tv.x_ : (1.0f + tv.x_), tv.y_ >= 0.0f ? tv.y_ : (1.0f + tv.y_));
-				tv = Vector2(tv.x_ < 1.0f ? tv.x_ : (tv.x_ - 1.0f), tv.y_ < 1.0f ? tv.y_ : (tv.y_ - 1.0f));
-				bv = Vector2(bv.x_ >= 0.0f ? bv.x_ : (1.0f + bv.x_), bv.y_ >= 0.0f ? bv.y_ : (1.0f + bv.y_));
-				bv = Vector2(bv.x_ < 1.0f ? bv.x_ : (bv.x_ - 1.0f), bv.y_ < 1.0f ? bv.y_ : (bv.y_ - 1.0f));
-				trv = Vector2(trv.x_ >= 0.0f ? trv.x_ : (1.0f + trv.x_), trv.y_ >= 0.0f ? trv.y_ : (1.0f + trv.y_));
-				trv = Vector2(trv.x_ < 1.0f ? trv.x_ : (trv.x_ - 1.0f), trv.y_ < 1.0f ? trv.y_ : (trv.y_ - 1.0f));
-				rv = Vector2(rv.x_ >= 0.0f ? rv.x_ : (1.0f + rv.x_), rv.y_ >= 0.0f ? rv.y_ : (1.0f + rv.y_));
-				rv = Vector2(rv.x_ < 1.0f ? rv.x_ : (rv.x_ - 1.0f), rv.y_ < 1.0f ? rv.y_ : (rv.y_ - 1.0f));
-				brv = Vector2(brv.x_ >= 0.0f ? brv.x_ : (1.0f + brv.x_), brv.y_ >= 0.0f ? brv.y_ : (1.0f + brv.y_));
-				brv = Vector2(brv.x_ < 1.0f ? brv.x_ : (brv.x_ - 1.0f), brv.y_ < 1.0f ? brv.y_ : (brv.y_ - 1.0f));
-
-				float tl = Abs(heightMap->GetPixelBilinear(tlv.x_, tlv.y_).r_);
-				float l = Abs(heightMap->GetPixelBilinear(lv.x_, lv.y_).r_);
-				float bl = Abs(heightMap->GetPixelBilinear(blv.x_, blv.y_).r_);
-				float t = Abs(heightMap->GetPixelBilinear(tv.x_, tv.y_).r_);
-				float b = Abs(heightMap->GetPixelBilinear(bv.x_, bv.y_).r_);
-				float tr = Abs(heightMap->GetPixelBilinear(trv.x_, trv.y_).r_);
-				float r = Abs(heightMap->GetPixelBilinear(rv.x_, rv.y_).r_);
-				float br = Abs(heightMap->GetPixelBilinear(brv.x_, brv.y_).r_);
-				
-				float dx = 0.0f, dy = 0.0f;
-				if (type == 0) {	// Sobel
-					dx = tl + l * 2.0 + bl - tr - r * 2.0 - br;
-					dy = tl + t * 2.0 + tr - bl - b * 2.0 - br;
-				}
-				else {				// Scharr
-					dx = tl * 3.0 + l * 10.0 + bl * 3.0 - tr * 3.0 - r * 10.0 - br * 3.0;
-					dy = tl * 3.0 + t * 10.0 + tr * 3.0 - bl * 3.0 - b * 10.0 - br * 3.0;
-				}
-				Vector4 normal(Vector3(dx * invertR * invertH * 255.0f, dy * invertG * invertH * 255.0f, dz).Normalized(), heightMap->GetPixelBilinear(vUv.x_, vUv.y_).a_);
-				Color gl_FragColor(normal.x_ * 0.5f + 0.5f, normal.y_ * 0.5f + 0.5f, normal.z_, normal.w_);
-				ret->SetPixel(x, y, gl_FragColor);
+				Geometry * geom = CreateGeometry(ctx, mesh.lods[lod].parts_vd[ii], mesh.lods[lod].parts_id[ii]);
+				geom->SetLodDistance(AsteroidLodDistance(lod));
+				fromScratchModel->SetGeometry(ii, lod, geom);
 			}
 		}
+		fromScratchModel->SetBoundingBox(mesh.BB);
 
-		return ret;
+		return fromScratchModel;
 	}
 
-	static Image * CreateCraterHeightMap(Context* ctx, int size)
+	/*crater count and radius of this asteroid kind*/
+	static const AsteroidCraterParams ASTEROID_CRATERS = { 1, 10, 5.0f, 30.0f };
+
+	class AsteroidBlobJob : public AsteroidJob
 	{
-		Image * ret = new Image(ctx);
-		if (ret->SetSize(size, size, 1) == false)
+	public:
+		AsteroidBlobJob(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths,
+			AsteroidUvMode uvMode)
+			: AsteroidJob(ctx), group_(node->CreateComponent<StaticModelGroup>()), seed_(seed), textureSize_(textureSize), base_(base), detail_(detail),
+			uvMode_(uvMode), diffusePaths_(diffusePaths), height_(MakeShared<Image>(ctx)), normal_(MakeShared<Image>(ctx)), texturesValid_(false), cached_(false),
+			cacheFile_(GetAsteroidCacheFile(ctx, uvMode == AUV_CUBE_FACES ? "uv_cube" : "uv", seed, base, detail, textureSize))
 		{
-			URHO3D_LOGERROR("CreateCraterHeightMap: Image::SetSize fail");
-			return nullptr;
 		}
 
-		for (unsigned x = 0; x < size; ++x)
+	protected:
+		enum
+		{
+			STAGE_LOAD = 0,
+			STAGE_GENERATE,
+			STAGE_PARTS,
+			STAGE_STORE
+		};
+
+		unsigned GetNumTasks(unsigned stage) override
 		{
-			for (unsigned y = 0; y < size; ++y)
+			switch (stage)
 			{
-				ret->SetPixel(x, y, Color(0.5f, 0.5f, 0.5f, 0.5f));
+			case STAGE_LOAD:
+				return 1;
+			case STAGE_GENERATE:
+				/*mesh and textures do not depend on each other; the mesh shape and the noise of every height map band;
+				a cached asteroid has no tasks here, which ends the job*/
+				return cached_ ? 0 : 1 + GetNumHeightBands();
+			case STAGE_PARTS:
+				/*the uv solves of the parts do not depend on each other; after them the height map bands are composed*/
+				return cached_ ? 0 : GetNumParts() + GetNumHeightBands();
+			case STAGE_STORE:
+				return (!cached_ && texturesValid_) ? 1 : 0;
+			default:
+				return 0;
 			}
 		}
 
-		/*topography height; need to be tile-able
-		www.gamedev.net/blogs/entry/2138456-seamless-noise/
-		*/
-		FastNoise *simplex = new FastNoise(Random(0, M_MAX_UNSIGNED));
-		simplex->SetFrequency(0.02f);
-		float **topography = new float *[size];
-		for (unsigned ii = 0; ii < size; ++ii)
-			topography[ii] = new float[size];
-
-		float max = FLT_MIN, min = FLT_MAX;
-		const float x1 = Random(500.0f);
-		const float y1 = Random(500.0f);
-		const float x2 = x1 + Random(500.0f);
-		const float y2 = y1 + Random(500.0f);
-		for (unsigned x = 0; x < size; ++x)
+		void RunTask(unsigned stage, unsigned task) override
 		{
-			for (unsigned y = 0; y < size; ++y)
+			if (stage == STAGE_LOAD)
 			{
-				const float dx = x2 - x1;
-				const float dy = y2 - y1;
-				float s = (float)x / size;
-				float t = (float)y / size;
-				float nx = x1 + Cos(s * 360.0f)*dx / (2 * M_PI);
-				float ny = y1 + Cos(t * 360.0f)*dy / (2 * M_PI);
-				float nz = x1 + Sin(s * 360.0f)*dx / (2 * M_PI);
-				float nw = y1 + Sin(t * 360.0f)*dy / (2 * M_PI);
-#if 1
-				const unsigned octaves = 5;
-				const float lacunarity = 2.0f;
-				const float gain = 0.5f;
-				float amp = 1.0f;
-				float fbmSum = simplex->GetSimplex(nx, ny, nz, nw);
-				for (unsigned ii = 0; ii < octaves; ++ii)
+				cached_ = LoadCache();
+				CountAsteroidCacheLookup(cached_);
+				if (!cached_)
 				{
-					nx *= lacunarity;
-					ny *= lacunarity;
-					nz *= lacunarity;
-					nw *= lacunarity;
-					amp *= gain;
-					fbmSum += simplex->GetSimplex(nx, ny, nz, nw) * amp;
+					AsteroidRandom rng(seed_, ARS_SURFACE);
+					texturesValid_ = heightMap_.Begin(height_, normal_, textureSize_, rng, ASTEROID_CRATERS);
 				}
-				topography[x][y] = fbmSum;
-#else
-				topography[x][y] = simplex->GetSimplex(nx, ny, nz, nw);
-#endif
-				if (topography[x][y] > max)
-					max = topography[x][y];
-				if (topography[x][y] < min)
-					min = topography[x][y];
 			}
-		}
-		delete simplex;
-		/*normalize to [-0.5, 0.5]*/
-		for (unsigned x = 0; x < size; ++x)
-		{
-			for (unsigned y = 0; y < size; ++y)
+			else if (stage == STAGE_STORE)
 			{
-				topography[x][y] = (topography[x][y] - min) / (max - min) - 0.5f;
+				heightMap_.Clear();
+				StoreCache();
 			}
-		}
-
-		const float topographyFactor = 0.3f;
-		for (int x = 0; x < size; ++x)
-		{
-			for (int y = 0; y < size; ++y)
+			else if (stage == STAGE_PARTS)
 			{
-				Color c = ret->GetPixel(x, y);
-				float h = (topography[x][y] - 0.5f) * topographyFactor;
-				Color r(h, h, h, h);
-				c += r;
-				ret->SetPixel(x, y, c);
+				if (task < GetNumParts())
+					CreateMeshPart(shape_, task, mesh_);
+				else
+					heightMap_.RunComposeBand(task - GetNumParts());
 			}
-		}
-
-		for (unsigned ii = 0; ii < size; ++ii)
-			delete[] topography[ii];
-		delete[] topography;
-
-		const unsigned numCraters = Random(1, 10);
-		for (unsigned ii = 0; ii < numCraters; ++ii)
-		{
-			int centerX = Random(0, size - 1);
-			int centerY = Random(0, size - 1);
-			float radius = Random(5.0f, 30.0f);
-
-			while (centerX < radius || centerX + radius > size || centerY < radius || centerY + radius > size)
+			else if (task == 0)
 			{
-				centerX = Random(0, size - 1);
-				centerY = Random(0, size - 1);
-				radius = Random(5.0f, 30.0f);
+				AsteroidRandom rng(seed_, ARS_SHAPE);
+				CreateMeshShape(base_, detail_, uvMode_, rng, shape_, mesh_);
 			}
-
-			for (int x = 0; x < size; ++x)
+			else
 			{
-				for (int y = 0; y < size; ++y)
-				{
-					int sqrX = (x - centerX) * (x - centerX);
-					int sqrY = (y - centerY) * (y - centerY);
-					const float ring = 4;
-					if (sqrX + sqrY <= radius * radius)
-					{
-						float cosTheta = Sqrt((float)sqrX + sqrY) / radius;
-						float sinTheta = Sqrt(1.0f - cosTheta * cosTheta);
-						float deepness = sinTheta * 0.5f;		//radius * sinTheta * 0.5f / radius 
-						ret->SetPixel(x, y, Color(0.5f - deepness, 0.5f - deepness, 0.5f - deepness, 0.5f - deepness));
-					}
-				}
+				heightMap_.RunNoiseBand(task - 1);
 			}
 		}
-		/*add shallow roughness*/
-		FastNoise *cell = new FastNoise(Random(0, M_MAX_UNSIGNED));
-		float **Layer = new float *[size];
-		for (unsigned ii = 0; ii < size; ++ii)
-			Layer[ii] = new float[size];
-
-		max = FLT_MIN, min = FLT_MAX;
-		for (unsigned x = 0; x < size; ++x)
+
+		void Finalize() override
 		{
-			for (unsigned y = 0; y < size; ++y)
+			shape_.Clear();
+			if (group_ == nullptr)
+				return;
+			group_->SetModel(CreateModel(context_, mesh_));
+
+			char log[128];
+			snprintf(log, sizeof(log), "asteroid %016llx %s (cache hits %u, misses %u)", seed_, cached_ ? "loaded from cache" : "generated",
+				GetAsteroidCacheHits(), GetAsteroidCacheMisses());
+			URHO3D_LOGINFO(log);
+			if (!texturesValid_)
+				return;
+
+			if (!cached_)
 			{
-				Layer[x][y] = cell->GetWhiteNoise(x, y);
-				if (Layer[x][y] > max)
-					max = Layer[x][y];
-				if (Layer[x][y] < min)
-					min = Layer[x][y];
+				height_->SaveBMP("height.bmp");
+				normal_->SavePNG("normal.png");
 			}
-		}
-		delete cell;
-		/*normalize to [-0.5, 0.5]*/
-		for (unsigned x = 0; x < size; ++x)
-		{
-			for (unsigned y = 0; y < size; ++y)
+
+			ResourceCache * cache = context_->GetSubsystem<ResourceCache>();
+			AsteroidRandom rng(seed_, ARS_MATERIAL);
+			SharedPtr <Texture2D> diffTex(cache->GetResource<Texture2D>(diffusePaths_[rng.Random(0, diffusePaths_.Size())]));
+			if (diffTex == nullptr)
 			{
-				Layer[x][y] = (Layer[x][y] - min) / (max - min) - 0.5f;
+				URHO3D_LOGERROR(String("diffTex->LoadFile fail"));
+				return;
 			}
-		}
 
-		const float roughnessFactor = 0.1f;
-		for (int x = 0; x < size; ++x)
-		{
-			for (int y = 0; y < size; ++y)
+#if 1
+			SharedPtr <Texture2D> normalMap(MakeShared<Texture2D>(context_));
+			normalMap->SetNumLevels(1);
+			if (normalMap->SetSize(textureSize_, textureSize_, Graphics::GetRGBAFormat(), TEXTURE_DYNAMIC) == false)
 			{
-				Color c = ret->GetPixel(x, y);
-				float rough = (Layer[x][y] - 0.5f) * roughnessFactor;
-				Color r(rough, rough, rough, rough);
-				c += r;
-				ret->SetPixel(x, y, c);
+				URHO3D_LOGERROR(String("normalMap->SetSize fail"));
+				return;
 			}
-		}
-
-		for (unsigned ii = 0; ii < size; ++ii)
-			delete[] Layer[ii];
-		delete[] Layer;
-		return  ret;
-	}
-
-	void CreateAsteroidBlob(Context* ctx, Node * node, unsigned textureSize, unsigned subdivision, const Vector<String> &diffusePaths)
-	{
-		StaticModelGroup * s = node->CreateComponent<StaticModelGroup>();
-		Model * model = CreateMesh(ctx, subdivision);
-		if (model != nullptr)
-			s->SetModel(model);
+			normalMap->SetData(normal_, true);
+#else
+			SharedPtr <Texture2D> normalMap(cache->GetResource<Texture2D>("Textures/NormalMap.png"));
+			if (diffTex == nullptr)
+			{
+				URHO3D_LOGERROR(String("normalMap->LoadFile fail"));
+				return;
+			}
+#endif
 
-		SharedPtr<Image> height(CreateCraterHeightMap(ctx, textureSize));
-		if (height == nullptr)
-			return;
+			Material * m = new Material(context_);
+			m->SetNumTechniques(2); 
+			m->SetTechnique(0, cache->GetResource<Technique>("Techniques/DiffNormal.xml"), QUALITY_MEDIUM);
+			m->SetTechnique(1, cache->GetResource<Technique>("Techniques/Diff.xml"), QUALITY_LOW);
+			m->SetTexture(TU_DIFFUSE, diffTex);
+			m->SetTexture(TU_NORMAL, normalMap);
+			m->SetShaderParameter("MatSpecColor", Vector4(0.3f, 0.3f, 0.3f, 16.0f));
 
-		SharedPtr<Image> normal(CalculateNormalMapFromHeight(ctx, height));
-		if (normal == nullptr)
-			return;
+			group_->SetMaterial(m);
+		}
 
-		height->SaveBMP("height.bmp");
-		normal->SavePNG("normal.png");
+	private:
+		static const unsigned MAX_CACHED_PARTS = 16;
 
-		ResourceCache * cache = ctx->GetSubsystem<ResourceCache>();
-		SharedPtr <Texture2D> diffTex(cache->GetResource<Texture2D>(diffusePaths[Random(0, diffusePaths.Size())]));
-		if (diffTex == nullptr)
+		unsigned GetNumParts() const
 		{
-			URHO3D_LOGERROR(String("diffTex->LoadFile fail"));
-			return;
+			return shape_.lods_parts.Empty() ? 0 : shape_.lods_parts[0].Size();
 		}
 
-#if 1
-		SharedPtr <Texture2D> normalMap(MakeShared<Texture2D>(ctx));
-		normalMap->SetNumLevels(1);
-		if (normalMap->SetSize(textureSize, textureSize, Graphics::GetRGBAFormat(), TEXTURE_DYNAMIC) == false)
+		/*0 once Begin() failed, nothing is left to compose then*/
+		unsigned GetNumHeightBands() const
 		{
-			URHO3D_LOGERROR(String("normalMap->SetSize fail"));
-			return;
+			return texturesValid_ ? heightMap_.GetNumBands() : 0;
 		}
-		normalMap->SetData(normal, true);
-#else
-		SharedPtr <Texture2D> normalMap(cache->GetResource<Texture2D>("Textures/NormalMap.png"));
-		if (diffTex == nullptr)
+
+		bool LoadCache()
 		{
-			URHO3D_LOGERROR(String("normalMap->LoadFile fail"));
-			return;
+			SharedPtr<File> file(OpenAsteroidCache(context_, cacheFile_));
+			if (file == nullptr)
+				return false;
+
+			asteroid_mesh_data_ cached;
+			cached.BB = file->ReadBoundingBox();
+			const unsigned numLods = file->ReadUInt();
+			const unsigned numParts = file->ReadUInt();
+			if (numLods == 0 || numLods > ASTEROID_MAX_LODS || numParts > MAX_CACHED_PARTS)
+				return false;
+			cached.lods.Resize(numLods);
+			for (unsigned lod = 0; lod < numLods; ++lod)
+			{
+				cached.lods[lod].parts_vd.Resize(numParts);
+				cached.lods[lod].parts_id.Resize(numParts);
+				for (unsigned ii = 0; ii < numParts; ++ii)
+				{
+					asteroid_mesh_lod_ &dst = cached.lods[lod];
+					if (!ReadCachedArray(*file, dst.parts_vd[ii]) || !ReadCachedIndices(*file, dst.parts_id[ii], dst.parts_vd[ii].Size()))
+						return false;
+				}
+			}
+			/*the normal map of CreateCraterHeightMap, uploaded as textureSize_ RGBA*/
+			if (!ReadCachedImage(*file, normal_, textureSize_, textureSize_, 4))
+				return false;
+			mesh_ = cached;
+			texturesValid_ = true;
+			return true;
 		}
-#endif
 
-		Material * m = new Material(ctx);
-		m->SetNumTechniques(2); 
-		m->SetTechnique(0, cache->GetResource<Technique>("Techniques/DiffNormal.xml"), QUALITY_MEDIUM);
-		m->SetTechnique(1, cache->GetResource<Technique>("Techniques/Diff.xml"), QUALITY_LOW);
-		m->SetTexture(TU_DIFFUSE, diffTex);
-		m->SetTexture(TU_NORMAL, normalMap);
-		m->SetShaderParameter("MatSpecColor", Vector4(0.3f, 0.3f, 0.3f, 16.0f));
+		void StoreCache()
+		{
+			SharedPtr<File> file(CreateAsteroidCache(context_, cacheFile_));
+			if (file == nullptr)
+				return;
 
-		s->SetMaterial(m);
+			file->WriteBoundingBox(mesh_.BB);
+			file->WriteUInt(mesh_.lods.Size());
+			file->WriteUInt(mesh_.lods.Empty() ? 0 : mesh_.lods[0].parts_vd.Size());
+			for (unsigned lod = 0; lod < mesh_.lods.Size(); ++lod)
+			{
+				for (unsigned ii = 0; ii < mesh_.lods[lod].parts_vd.Size(); ++ii)
+				{
+					WriteCachedArray(*file, mesh_.lods[lod].parts_vd[ii]);
+					WriteCachedIndices(*file, mesh_.lods[lod].parts_id[ii]);
+				}
+			}
+			if (WriteCachedImage(*file, normal_))
+				CommitAsteroidCache(context_, file, cacheFile_);
+			else
+				DiscardAsteroidCache(context_, file);
+		}
+
+		WeakPtr<StaticModelGroup> group_;
+		const unsigned long long seed_;
+		const unsigned textureSize_;
+		const AsteroidBaseMesh base_;
+		const unsigned detail_;
+		const AsteroidUvMode uvMode_;
+		const Vector<String> diffusePaths_;
+		asteroid_mesh_shape_ shape_;
+		asteroid_mesh_data_ mesh_;
+		AsteroidHeightMap heightMap_;
+		SharedPtr<Image> height_;
+		SharedPtr<Image> normal_;
+		bool texturesValid_;
+		bool cached_;
+		const String cacheFile_;
+	};
+
+	void CreateAsteroidBlob(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths,
+		AsteroidUvMode uvMode)
+	{
+		SharedPtr<AsteroidJob> job(new AsteroidBlobJob(ctx, node, seed, textureSize, base, detail, diffusePaths, uvMode));
+		job->Run();
+	}
+
+	SharedPtr<AsteroidJob> CreateAsteroidBlobAsync(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths,
+		AsteroidUvMode uvMode)
+	{
+		SharedPtr<AsteroidJob> job(new AsteroidBlobJob(ctx, node, seed, textureSize, base, detail, diffusePaths, uvMode));
+		job->StartAsync();
+		return job;
 	}
 }
@@ -1,8 +1,25 @@
 #pragma once
 #include <Urho3D/Scene/Node.h>
+#include "asteroid_job.h"
+#include "asteroid_shape.h"
 
 namespace Urho3D
 {
-	void CreateAsteroidBlob(Context* ctx, Node * node, unsigned textureSize, unsigned subdivision, const Vector<String> &diffusePaths);
+	/*how the UV asteroid gets its texture coordinates*/
+	enum AsteroidUvMode
+	{
+		/*two halves, each harmonic mapped onto the whole texture; little stretch, but a sparse solve per half*/
+		AUV_HARMONIC = 0,
+		/*the base mesh projected onto the 6 faces of a cube, each face covering the whole texture; no solve, but more seams and stretch*/
+		AUV_CUBE_FACES
+	};
+
+	/*the same seed always gives the same asteroid; detail is the edge division for ABM_UV_SPHERE_OR_CUBE and the vertex budget otherwise*/
+	void CreateAsteroidBlob(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths,
+		AsteroidUvMode uvMode = AUV_HARMONIC);
+	/*same as CreateAsteroidBlob but the mesh and textures are generated on worker threads;
+	the StaticModelGroup is created immediately and gets its model/material when the job completes*/
+	SharedPtr<AsteroidJob> CreateAsteroidBlobAsync(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths,
+		AsteroidUvMode uvMode = AUV_HARMONIC);
 }		/*namespace Urho3D*/
 
@@ -0,0 +1,805 @@
+#include "asteroid_mesh.h"
+#include "asteroid_shape.h"
+#include "asteroid_heightmap.h"
+#include "asteroid_cache.h"
+#include "asteroid_triplanar.h"
+#include "FastNoise.h"
+#include "FastNoiseKernel.h"
+#include "uv_mapper.hpp"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Urho3D/Urho3DAll.h>
+
+/*
+asteroid_bench tool: CPU timings of the asteroid generation stages, written to the log.
+Where a stage has a faster path that must give the same result as a plainer one, the results are checked;
+a failed check is logged as an error and the tool exits with EXIT_FAILURE.
+*/
+namespace Urho3D
+{
+	struct bench_vertex
+	{
+		Vector3 position;
+		Vector3 normal;
+	};
+
+	/*printf formatting; URHO3D_LOGINFOF does not understand precision or width*/
+	static void benchWrite(int level, const char * format, va_list args)
+	{
+		char line[512];
+		vsnprintf(line, sizeof(line), format, args);
+		Log::Write(level, line);
+	}
+
+	static void benchLog(const char * format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		benchWrite(LOG_INFO, format, args);
+		va_end(args);
+	}
+
+	static unsigned benchFailures = 0;
+
+	/*log the message as an error and fail the run unless condition holds; returns condition*/
+	static bool benchCheck(bool condition, const char * format, ...)
+	{
+		if (condition)
+			return true;
+		va_list args;
+		va_start(args, format);
+		benchWrite(LOG_ERROR, format, args);
+		va_end(args);
+		++benchFailures;
+		return false;
+	}
+
+	/*dims streams of numPoints coordinates in [-500, 500]*/
+	static void randomCoordinates(unsigned long long seed, unsigned dims, unsigned numPoints, PODVector<float> *c)
+	{
+		AsteroidRandom rng(seed, ARS_SURFACE);
+		for (unsigned dd = 0; dd < dims; ++dd)
+		{
+			c[dd].Resize(numPoints);
+			for (unsigned ii = 0; ii < numPoints; ++ii)
+				c[dd][ii] = rng.Random(-500.0f, 500.0f);
+		}
+	}
+
+	static float maxNormalDifference(const PODVector<bench_vertex> &a, const PODVector<bench_vertex> &b)
+	{
+		float ret = 0.0f;
+		for (unsigned ii = 0; ii < a.Size(); ++ii)
+			ret = Max(ret, (a[ii].normal - b[ii].normal).Length());
+		return ret;
+	}
+
+	static void BenchmarkNormals()
+	{
+		URHO3D_LOGINFO("calculateNormal: subdivision, base, vertices, index buffer(ms), CSR build(ms), CSR(ms), CSR angle(ms)");
+		const unsigned subdivisions[] = { 20, 40, 60, 80, 100, 150, 200 };
+		for (unsigned ii = 0; ii < sizeof(subdivisions) / sizeof(subdivisions[0]); ++ii)
+		{
+			const unsigned edge_division = subdivisions[ii];
+			for (unsigned base = 0; base < 2; ++base)
+			{
+				PODVector<bench_vertex> vd;
+				PODVector<unsigned> id;
+				if (base == 0)
+					CreateSphere(vd, id, 0.5f, edge_division / 2, edge_division);
+				else
+					CreateCube(vd, id, Vector3::ONE, IntVector3(edge_division, edge_division, edge_division));
+				if (vd.Empty())
+				{
+					benchLog("%u, %s, skipped: index buffer too small", edge_division, base == 0 ? "sphere" : "cube");
+					continue;
+				}
+
+				HiresTimer timer;
+				calculateNormal(vd, id);
+				const float scatterMs = timer.GetUSec(false) / 1000.0f;
+
+				VertexTriangleMap adjacency;
+				timer.Reset();
+				buildVertexTriangleMap(adjacency, id, vd.Size());
+				const float buildMs = timer.GetUSec(false) / 1000.0f;
+
+				PODVector<bench_vertex> gathered(vd);
+				timer.Reset();
+				calculateNormal(gathered, id, adjacency);
+				const float gatherMs = timer.GetUSec(false) / 1000.0f;
+
+				PODVector<bench_vertex> angle(vd);
+				timer.Reset();
+				calculateNormal(angle, id, adjacency, NW_ANGLE);
+				const float angleMs = timer.GetUSec(false) / 1000.0f;
+
+				/*both sum the triangles of a vertex in ascending order*/
+				benchCheck(maxNormalDifference(vd, gathered) == 0.0f, "calculateNormal: %s %u, CSR normals differ from the index buffer pass",
+					base == 0 ? "sphere" : "cube", edge_division);
+				benchLog("%u, %s, %u, %.3f, %.3f, %.3f, %.3f", edge_division, base == 0 ? "sphere" : "cube", vd.Size(),
+					scatterMs, buildMs, gatherMs, angleMs);
+			}
+		}
+	}
+
+	static void shapeStagesStreams(VertexStreams &vs, const Vector3 &scale, const PODVector<Plane> &cuts,
+		const PODVector<float> &noise, float noiseFactor, BoundingBox &BB, Vector3 &center)
+	{
+		scaleStreams(vs, scale);
+		BB = calculateBB(vs);
+		bool behind[NUM_CORNER_CUTS] = { false };
+		markVerticesBehindPlanes(vs, cuts.Buffer(), cuts.Size(), behind);
+		cutByPlanes(vs, cuts);
+		float noiseMin, noiseMax;
+		calculateRange(noise, noiseMin, noiseMax);
+		displaceAlongNormals(vs, noise, noiseMin, noiseMax, noiseFactor);
+		BB = calculateBB(vs);
+		center = calculateCenter(vs);
+	}
+
+	static void BenchmarkShapeStages()
+	{
+		URHO3D_LOGINFO("shape stages on vertex streams (scale, bounds, plane test, cut, displace, bounds, center): subdivision, vertices, time(ms)");
+		const unsigned subdivisions[] = { 20, 40, 60, 80, 100, 150, 200 };
+		const unsigned repeats = 10;
+		for (unsigned ii = 0; ii < sizeof(subdivisions) / sizeof(subdivisions[0]); ++ii)
+		{
+			const unsigned edge_division = subdivisions[ii];
+			PODVector<bench_vertex> base;
+			PODVector<unsigned> id;
+			CreateCube(base, id, Vector3::ONE, IntVector3(edge_division, edge_division, edge_division));
+			if (base.Empty())
+			{
+				benchLog("%u, skipped: index buffer too small", edge_division);
+				continue;
+			}
+			calculateNormal(base, id);
+
+			AsteroidRandom rng(edge_division);
+			const Vector3 scale(1.3f, 0.7f, 1.1f);
+			PODVector<Plane> cuts;
+			randomCornerCuts(base, calculateBB(base), rng, cuts);
+			PODVector<float> noise(base.Size());
+			for (unsigned kk = 0; kk < noise.Size(); ++kk)
+				noise[kk] = rng.Random(-1.0f, 1.0f);
+
+			/*the SSE lanes and the scalar tail must test and clip like the vertex path, whatever the count modulo 4*/
+			VertexStreams vs;
+			verticesToStreams(base, vs);
+			PODVector<bench_vertex> vd(base);
+			bool behindStreams[NUM_CORNER_CUTS] = { false };
+			bool behindVertices[NUM_CORNER_CUTS] = { false };
+			markVerticesBehindPlanes(vs, cuts.Buffer(), cuts.Size(), behindStreams);
+			markVerticesBehindPlanes(vd, cuts.Buffer(), cuts.Size(), behindVertices);
+			benchCheck(memcmp(behindStreams, behindVertices, sizeof(behindStreams)) == 0,
+				"shape stages: subdivision %u, stream plane test differs from the vertex path", edge_division);
+			cutByPlanes(vs, cuts);
+			cutByPlanes(vd, cuts);
+			bool sameCut = true;
+			for (unsigned kk = 0; kk < vd.Size() && sameCut; ++kk)
+				sameCut = vd[kk].position.x_ == vs.px_[kk] && vd[kk].position.y_ == vs.py_[kk] && vd[kk].position.z_ == vs.pz_[kk];
+			benchCheck(sameCut, "shape stages: subdivision %u, stream cut differs from the vertex path", edge_division);
+
+			HiresTimer timer;
+			BoundingBox BB;
+			Vector3 center;
+			long long streamsUs = 0;
+			for (unsigned rr = 0; rr < repeats; ++rr)
+			{
+				verticesToStreams(base, vs);
+				for (unsigned kk = 0; kk < base.Size(); ++kk)
+				{
+					vs.nx_[kk] = base[kk].normal.x_;
+					vs.ny_[kk] = base[kk].normal.y_;
+					vs.nz_[kk] = base[kk].normal.z_;
+				}
+				timer.Reset();
+				shapeStagesStreams(vs, scale, cuts, noise, 0.1f, BB, center);
+				streamsUs += timer.GetUSec(false);
+			}
+			benchLog("%u, %u, %.3f", edge_division, base.Size(), streamsUs / 1000.0f / repeats);
+		}
+	}
+
+	/*lower part of a generated asteroid split through the base mesh center, the input autoUV gets*/
+	static void createAsteroidHalf(unsigned budget, unsigned long long seed, std::vector<float> &vertices, std::vector<int> &faces)
+	{
+		AsteroidRandom rng(seed);
+		VertexStreams vs;
+		PODVector<unsigned> id;
+		AsteroidShapeParams params;
+		PODVector<Vector3> basePositions;
+		GenerateAsteroidShape(ABM_ICOSPHERE, budget, rng, vs, id, params, &basePositions);
+
+		vertices.clear();
+		faces.clear();
+		for (unsigned ii = 0; ii < vs.Size(); ++ii)
+		{
+			vertices.push_back(vs.px_[ii]);
+			vertices.push_back(vs.py_[ii]);
+			vertices.push_back(vs.pz_[ii]);
+		}
+		for (unsigned ii = 0; ii < id.Size() / 3; ++ii)
+		{
+			if (basePositions[id[ii * 3]].y_ < 0.0f && basePositions[id[ii * 3 + 1]].y_ < 0.0f && basePositions[id[ii * 3 + 2]].y_ < 0.0f)
+			{
+				faces.push_back(id[ii * 3]);
+				faces.push_back(id[ii * 3 + 1]);
+				faces.push_back(id[ii * 3 + 2]);
+			}
+		}
+	}
+
+	static void BenchmarkUvSolvers()
+	{
+		URHO3D_LOGINFO("uvMap solvers on asteroid halves: vertex budget, vertices, sparse LU(ms), LDLT(ms), CG(ms), multigrid(ms), "
+			"LDLT with the pattern of another asteroid(ms)");
+		const unsigned budgets[] = { 500, 2000, 8000, 30000, 120000 };
+		for (unsigned ii = 0; ii < sizeof(budgets) / sizeof(budgets[0]); ++ii)
+		{
+			std::vector<float> vertices;
+			std::vector<int> faces;
+			createAsteroidHalf(budgets[ii], budgets[ii], vertices, faces);
+
+			const UvSolver solvers[] = { UV_SOLVER_SPARSE_LU, UV_SOLVER_LDLT, UV_SOLVER_CG, UV_SOLVER_MULTIGRID };
+			const char * solverNames[] = { "sparse LU", "LDLT", "CG", "multigrid" };
+			const unsigned numSolvers = sizeof(solvers) / sizeof(solvers[0]);
+			float ms[numSolvers];
+			std::vector<float> reference;
+			unsigned numVertices = 0;
+			for (unsigned ss = 0; ss < numSolvers; ++ss)
+			{
+				std::vector<float> outVertices, outUv;
+				std::vector<int> outFaces;
+				/*every solver starts without a cached pattern*/
+				uvClearPatternCache();
+				HiresTimer timer;
+				uvMap(vertices, faces, outVertices, outFaces, outUv, nullptr, solvers[ss]);
+				ms[ss] = timer.GetUSec(false) / 1000.0f;
+				if (ss == 0)
+					reference = outUv;
+				float diff = outUv.size() == reference.size() ? 0.0f : M_INFINITY;
+				for (unsigned kk = 0; kk < outUv.size() && kk < reference.size(); ++kk)
+					diff = Max(diff, Abs(outUv[kk] - reference[kk]));
+				/*the iterative solvers stop at a relative residual; 1e-4 is less than a texel of a 4096 texture*/
+				benchCheck(diff <= 1e-4f, "uvMap: budget %u, %s uvs differ from sparse LU by %g", budgets[ii], solverNames[ss], diff);
+				numVertices = outVertices.size() / 3;
+			}
+
+			/*a different asteroid of the same base mesh and budget has the same connectivity*/
+			std::vector<float> otherVertices;
+			std::vector<int> otherFaces;
+			createAsteroidHalf(budgets[ii], budgets[ii] + 1, otherVertices, otherFaces);
+			std::vector<float> outVertices, outUv;
+			std::vector<int> outFaces;
+			uvClearPatternCache();
+			uvMap(otherVertices, otherFaces, outVertices, outFaces, outUv, nullptr, UV_SOLVER_LDLT);
+			outVertices.clear();
+			outFaces.clear();
+			outUv.clear();
+			HiresTimer timer;
+			uvMap(vertices, faces, outVertices, outFaces, outUv, nullptr, UV_SOLVER_LDLT);
+			const float cachedMs = timer.GetUSec(false) / 1000.0f;
+			unsigned hits, misses;
+			uvGetPatternCacheStats(hits, misses);
+			benchCheck(hits == 1, "uvMap: budget %u, the pattern of another asteroid was not reused", budgets[ii]);
+
+			benchLog("%u, %u, %.3f, %.3f, %.3f, %.3f, %.3f", budgets[ii], numVertices, ms[0], ms[1], ms[2], ms[3], cachedMs);
+		}
+		uvClearPatternCache();
+	}
+
+	static void BenchmarkHeightMap(Context* ctx)
+	{
+		URHO3D_LOGINFO("crater height map: size, float plane(ms), float plane with 1000 craters(ms), float plane with normal map(ms)");
+		const AsteroidCraterParams craters = { 1, 10, 5.0f, 30.0f };
+		const AsteroidCraterParams manyCraters = { 1000, 1001, 2.0f, 40.0f };
+		const int sizes[] = { 256, 512, 1024, 2048 };
+		for (unsigned ii = 0; ii < sizeof(sizes) / sizeof(sizes[0]); ++ii)
+		{
+			SharedPtr<Image> image(MakeShared<Image>(ctx));
+			SharedPtr<Image> other(MakeShared<Image>(ctx));
+
+			AsteroidRandom planeRng(sizes[ii], ARS_SURFACE);
+			HiresTimer timer;
+			CreateCraterHeightMap(image, sizes[ii], planeRng, craters);
+			const float planeMs = timer.GetUSec(true) / 1000.0f;
+
+			AsteroidRandom manyRng(sizes[ii], ARS_SURFACE);
+			timer.Reset();
+			CreateCraterHeightMap(other, sizes[ii], manyRng, manyCraters);
+			const float manyMs = timer.GetUSec(true) / 1000.0f;
+
+			SharedPtr<Image> normal(MakeShared<Image>(ctx));
+			AsteroidRandom normalRng(sizes[ii], ARS_SURFACE);
+			timer.Reset();
+			CreateCraterHeightMap(other, sizes[ii], normalRng, craters, normal);
+			const float normalMs = timer.GetUSec(false) / 1000.0f;
+
+			/*the normal map is written alongside, the heights must not change*/
+			benchCheck(memcmp(image->GetData(), other->GetData(), sizes[ii] * sizes[ii]) == 0,
+				"crater height map: size %d, heights differ when the normal map is written", sizes[ii]);
+
+			benchLog("%d, %.2f, %.2f, %.2f", sizes[ii], planeMs, manyMs, normalMs);
+		}
+	}
+
+	static bool sameImage(const Image * a, const Image * b)
+	{
+		const unsigned bytes = a->GetWidth() * a->GetHeight() * a->GetComponents();
+		if (a->GetWidth() != b->GetWidth() || a->GetHeight() != b->GetHeight() || a->GetComponents() != b->GetComponents())
+			return false;
+		return bytes == 0 || memcmp(a->GetData(), b->GetData(), bytes) == 0;
+	}
+
+	/*the bytes of what the cache stores: vertices and indices of every lod, and the normal map*/
+	static bool sameAsteroidData(const AsteroidBlobData_triplanar &a, const AsteroidBlobData_triplanar &b)
+	{
+		const asteroid_triplanar_mesh_data_ &ma = a.mesh_;
+		const asteroid_triplanar_mesh_data_ &mb = b.mesh_;
+		if (!(ma.BB == mb.BB) || ma.lods_vd.Size() != mb.lods_vd.Size())
+			return false;
+		for (unsigned lod = 0; lod < ma.lods_vd.Size(); ++lod)
+		{
+			const AsteroidIndices &ia = ma.lods_id[lod];
+			const AsteroidIndices &ib = mb.lods_id[lod];
+			if (ma.lods_vd[lod].Size() != mb.lods_vd[lod].Size() || ia.IsLarge() != ib.IsLarge() || ia.Size() != ib.Size())
+				return false;
+			if (!ma.lods_vd[lod].Empty() && memcmp(ma.lods_vd[lod].Buffer(), mb.lods_vd[lod].Buffer(), ma.lods_vd[lod].Size() * sizeof(asteroid_triplanar_vertex)) != 0)
+				return false;
+			if (ia.Size() != 0 && memcmp(ia.Data(), ib.Data(), ia.Size() * ia.IndexSize()) != 0)
+				return false;
+		}
+		return a.texturesValid_ == b.texturesValid_ && sameImage(a.normal_, b.normal_);
+	}
+
+	static void readBenchFile(Context* ctx, const String &fileName, PODVector<unsigned char> &bytes)
+	{
+		File file(ctx, fileName, FILE_READ);
+		bytes.Resize(file.IsOpen() ? file.GetSize() : 0);
+		if (!bytes.Empty())
+			file.Read(bytes.Buffer(), bytes.Size());
+	}
+
+	static void writeBenchFile(Context* ctx, const String &fileName, const unsigned char * bytes, unsigned size)
+	{
+		File file(ctx, fileName, FILE_WRITE);
+		file.Write(bytes, size);
+	}
+
+	/*a triplanar asteroid is stored and loaded back unchanged; damaged and stale files load as a miss and are generated again*/
+	static void BenchmarkAsteroidCache(Context* ctx)
+	{
+		URHO3D_LOGINFO("asteroid cache: texture size, generated and stored(ms), loaded(ms)");
+		const unsigned long long seed = 0xa57e401dULL;
+		const unsigned textureSize = 512;
+		const unsigned detail = 2000;
+		FileSystem * fs = ctx->GetSubsystem<FileSystem>();
+		const String dir = fs->GetAppPreferencesDir("procedural_asteroid", "AsteroidBench");
+		if (!benchCheck(!dir.Empty() && (fs->DirExists(dir) || fs->CreateDir(dir)), "asteroid cache: no directory for the bench cache file"))
+			return;
+		const String cacheFile = dir + "triplanar_bench.bin";
+		fs->Delete(cacheFile);
+
+		AsteroidBlobData_triplanar generated;
+		HiresTimer timer;
+		CreateAsteroidData_triplanar(ctx, seed, textureSize, ABM_SPHERIFIED_CUBE, detail, cacheFile, generated);
+		const float generateMs = timer.GetUSec(true) / 1000.0f;
+		benchCheck(generated.texturesValid_ && !generated.cached_ && fs->FileExists(cacheFile), "asteroid cache: the asteroid was not generated and stored");
+
+		AsteroidBlobData_triplanar loaded;
+		timer.Reset();
+		CreateAsteroidData_triplanar(ctx, seed, textureSize, ABM_SPHERIFIED_CUBE, detail, cacheFile, loaded);
+		const float loadMs = timer.GetUSec(false) / 1000.0f;
+		benchCheck(loaded.cached_ && sameAsteroidData(generated, loaded), "asteroid cache: the stored asteroid did not load back unchanged");
+
+		PODVector<unsigned char> stored;
+		readBenchFile(ctx, cacheFile, stored);
+		const unsigned headerSize = 8;
+		if (!benchCheck(stored.Size() > headerSize, "asteroid cache: the cache file is empty"))
+			return;
+
+		/*every damaged file is regenerated, which also writes a good file again for the next case*/
+		const char * damages[] = { "a truncated file", "a file of another pipeline version", "a file with indices past the vertex count" };
+		for (unsigned ii = 0; ii < sizeof(damages) / sizeof(damages[0]); ++ii)
+		{
+			PODVector<unsigned char> bytes(stored);
+			if (ii == 0)
+			{
+				bytes.Resize(bytes.Size() / 2);
+			}
+			else if (ii == 1)
+			{
+				const unsigned staleVersion = ASTEROID_PIPELINE_VERSION - 1;
+				memcpy(&bytes[4], &staleVersion, sizeof(staleVersion));
+			}
+			else
+			{
+				/*header, bounding box and lod count, then the vertices of lod 0 and its index arrays, each array after its size and element size*/
+				const asteroid_triplanar_mesh_data_ &mesh = generated.mesh_;
+				unsigned offset = headerSize + 6 * sizeof(float) + 4 + 8 + mesh.lods_vd[0].Size() * sizeof(asteroid_triplanar_vertex) + 8;
+				if (mesh.lods_id[0].IsLarge())
+					offset += 8;
+				const unsigned outOfRange = mesh.lods_vd[0].Size();
+				memcpy(&bytes[offset], &outOfRange, mesh.lods_id[0].IndexSize());
+			}
+			writeBenchFile(ctx, cacheFile, bytes.Buffer(), bytes.Size());
+
+			AsteroidBlobData_triplanar damaged;
+			CreateAsteroidData_triplanar(ctx, seed, textureSize, ABM_SPHERIFIED_CUBE, detail, cacheFile, damaged);
+			benchCheck(!damaged.cached_ && sameAsteroidData(generated, damaged), "asteroid cache: %s was not regenerated as the same asteroid", damages[ii]);
+		}
+		fs->Delete(cacheFile);
+
+		benchLog("%u, %.2f, %.2f", textureSize, generateMs, loadMs);
+	}
+
+	/*
+	the same seed gives the same asteroid whatever runs its stages: every task on the main thread, the height map bands spread
+	over worker threads by Run(), or the whole job on worker threads by StartAsync(). Must run before the work queue has threads.
+	*/
+	static void BenchmarkAsteroidDeterminism(Context* ctx)
+	{
+		URHO3D_LOGINFO("asteroid determinism: worker threads, main thread(ms), Run(ms), StartAsync(ms)");
+		const unsigned long long seed = 0xd37e2a11ULL;
+		const unsigned textureSize = 512;
+		const unsigned detail = 2000;
+		WorkQueue * queue = ctx->GetSubsystem<WorkQueue>();
+		Time * time = ctx->GetSubsystem<Time>();
+		if (!benchCheck(queue->GetNumThreads() == 0, "asteroid determinism: the work queue already has threads"))
+			return;
+
+		AsteroidBlobData_triplanar serial;
+		HiresTimer timer;
+		CreateAsteroidData_triplanar(ctx, seed, textureSize, ABM_SPHERIFIED_CUBE, detail, String::EMPTY, serial);
+		const float serialMs = timer.GetUSec(true) / 1000.0f;
+		benchCheck(serial.texturesValid_ && !serial.cached_, "asteroid determinism: the asteroid was not generated");
+
+		/*the mesh stage draws only from its own stream*/
+		VertexStreams vs;
+		PODVector<unsigned> id;
+		AsteroidShapeParams params;
+		AsteroidRandom shapeRng(seed, ARS_SHAPE);
+		GenerateAsteroidShape(ABM_SPHERIFIED_CUBE, detail, shapeRng, vs, id, params);
+		PODVector<asteroid_triplanar_vertex> vd;
+		streamsToVertices(vs, vd);
+		const PODVector<asteroid_triplanar_vertex> &lod0 = serial.mesh_.lods_vd[0];
+		benchCheck(vd.Size() == lod0.Size() && memcmp(vd.Buffer(), lod0.Buffer(), vd.Size() * sizeof(asteroid_triplanar_vertex)) == 0,
+			"asteroid determinism: the job mesh differs from GenerateAsteroidShape with the ARS_SHAPE stream");
+
+		queue->CreateThreads(Max(GetNumPhysicalCPUs(), 3u) - 1);
+
+		AsteroidBlobData_triplanar banded;
+		timer.Reset();
+		CreateAsteroidData_triplanar(ctx, seed, textureSize, ABM_SPHERIFIED_CUBE, detail, String::EMPTY, banded);
+		const float bandedMs = timer.GetUSec(true) / 1000.0f;
+		benchCheck(sameAsteroidData(serial, banded) && sameImage(serial.height_, banded.height_),
+			"asteroid determinism: Run() on worker threads differs from the main thread");
+
+		/*completed work items are only reported at the start of a frame*/
+		AsteroidBlobData_triplanar async;
+		timer.Reset();
+		SharedPtr<AsteroidJob> job(CreateAsteroidDataAsync_triplanar(ctx, seed, textureSize, ABM_SPHERIFIED_CUBE, detail, String::EMPTY, async));
+		while (!job->IsCompleted())
+		{
+			Time::Sleep(1);
+			time->BeginFrame(0.0f);
+			time->EndFrame();
+		}
+		const float asyncMs = timer.GetUSec(false) / 1000.0f;
+		benchCheck(sameAsteroidData(serial, async) && sameImage(serial.height_, async.height_),
+			"asteroid determinism: StartAsync() differs from the main thread");
+
+		benchLog("%u, %.2f, %.2f, %.2f", queue->GetNumThreads(), serialMs, bandedMs, asyncMs);
+	}
+
+	enum bench_noise { BN_PERLIN_FRACTAL_2D, BN_WHITE_NOISE_2D, BN_PERLIN_FRACTAL_3D, BN_SIMPLEX_4D };
+
+	static void noisePerPoint(const FastNoise &noise, bench_noise function, const PODVector<float> *c, PODVector<float> &out)
+	{
+		for (unsigned ii = 0; ii < out.Size(); ++ii)
+		{
+			switch (function)
+			{
+			case BN_PERLIN_FRACTAL_2D: out[ii] = noise.GetPerlinFractal(c[0][ii], c[1][ii]); break;
+			case BN_WHITE_NOISE_2D: out[ii] = noise.GetWhiteNoise(c[0][ii], c[1][ii]); break;
+			case BN_PERLIN_FRACTAL_3D: out[ii] = noise.GetPerlinFractal(c[0][ii], c[1][ii], c[2][ii]); break;
+			case BN_SIMPLEX_4D: out[ii] = noise.GetSimplex(c[0][ii], c[1][ii], c[2][ii], c[3][ii]); break;
+			}
+		}
+	}
+
+	static void noiseBatch(const FastNoise &noise, bench_noise function, const PODVector<float> *c, PODVector<float> &out)
+	{
+		switch (function)
+		{
+		case BN_PERLIN_FRACTAL_2D: noise.GetPerlinFractalBatch(&c[0][0], &c[1][0], &out[0], out.Size()); break;
+		case BN_WHITE_NOISE_2D: noise.GetWhiteNoiseBatch(&c[0][0], &c[1][0], &out[0], out.Size()); break;
+		case BN_PERLIN_FRACTAL_3D: noise.GetPerlinFractalBatch(&c[0][0], &c[1][0], &c[2][0], &out[0], out.Size()); break;
+		case BN_SIMPLEX_4D: noise.GetSimplexBatch(&c[0][0], &c[1][0], &c[2][0], &c[3][0], &out[0], out.Size()); break;
+		}
+	}
+
+	static void BenchmarkNoiseBatch()
+	{
+		const FastNoise::BatchLevel detected = FastNoise::GetBatchLevel();
+		const char * levelNames[] = { "scalar", "SSE4.1", "AVX2" };
+		benchLog("noise batches (%s): function, points, per point(ms), scalar batch(ms), SSE4.1 batch(ms), AVX2 batch(ms) or -1 without it", levelNames[detected]);
+
+		/*the configurations of the callers: nebula, height map roughness, shape displacement, height map topography*/
+		const char * names[] = { "perlin fractal 2D, 8 octaves", "white noise 2D", "perlin fractal 3D, 3 octaves", "simplex 4D" };
+		const unsigned numPoints = 1 << 18;
+		PODVector<float> c[4];
+		randomCoordinates(1, 4, numPoints, c);
+
+		PODVector<float> reference(numPoints), batch(numPoints);
+		for (unsigned ff = 0; ff < 4; ++ff)
+		{
+			const bench_noise function = (bench_noise)ff;
+			FastNoise noise(1337);
+			if (function == BN_PERLIN_FRACTAL_2D)
+			{
+				noise.SetFractalOctaves(8);
+				noise.SetFrequency(0.04f);
+			}
+
+			HiresTimer timer;
+			noisePerPoint(noise, function, c, reference);
+			const float perPointMs = timer.GetUSec(false) / 1000.0f;
+
+			float levelMs[3] = { -1.0f, -1.0f, -1.0f };
+			for (int level = FastNoise::BatchScalar; level <= detected; ++level)
+			{
+				FastNoise::SetBatchLevel((FastNoise::BatchLevel)level);
+				timer.Reset();
+				noiseBatch(noise, function, c, batch);
+				levelMs[level] = timer.GetUSec(false) / 1000.0f;
+				/*the kernels do the float operations of the per-point code in the same order*/
+				benchCheck(memcmp(&reference[0], &batch[0], numPoints * sizeof(float)) == 0, "noise batches: %s, %s batch differs from per point",
+					names[ff], levelNames[level]);
+			}
+			FastNoise::SetBatchLevel(detected);
+
+			benchLog("%s, %u, %.2f, %.2f, %.2f, %.2f", names[ff], numPoints, perPointMs, levelMs[0], levelMs[1], levelMs[2]);
+		}
+	}
+
+	static void BenchmarkNoiseGrid()
+	{
+		URHO3D_LOGINFO("nebula noise grid (perlin fractal 2D, 8 octaves): size, per point(ms), row batches(ms), grid(ms)");
+		FastNoise noise(1337);
+		noise.SetNoiseType(FastNoise::PerlinFractal);
+		noise.SetFractalOctaves(8);
+		noise.SetFrequency(0.04f);
+		const int sizes[] = { 256, 512, 1024 };
+		for (unsigned ii = 0; ii < sizeof(sizes) / sizeof(sizes[0]); ++ii)
+		{
+			const int size = sizes[ii];
+			PODVector<float> reference(size * size), batch(size * size), grid(size * size);
+
+			HiresTimer timer;
+			for (int y = 0; y < size; ++y)
+				for (int x = 0; x < size; ++x)
+					reference[y * size + x] = noise.GetPerlinFractal(x, y);
+			const float perPointMs = timer.GetUSec(true) / 1000.0f;
+
+			timer.Reset();
+			PODVector<float> columnX(size), rowY(size);
+			for (int x = 0; x < size; ++x)
+				columnX[x] = x;
+			for (int y = 0; y < size; ++y)
+			{
+				for (int x = 0; x < size; ++x)
+					rowY[x] = y;
+				noise.GetPerlinFractalBatch(&columnX[0], &rowY[0], &batch[y * size], size);
+			}
+			const float batchMs = timer.GetUSec(true) / 1000.0f;
+
+			timer.Reset();
+			noise.GetNoiseGrid2D(0.0f, 0.0f, 1.0f, 1.0f, size, size, &grid[0], size);
+			const float gridMs = timer.GetUSec(false) / 1000.0f;
+
+			benchCheck(memcmp(&reference[0], &batch[0], size * size * sizeof(float)) == 0, "nebula noise grid: size %d, row batches differ from per point", size);
+			benchCheck(memcmp(&reference[0], &grid[0], size * size * sizeof(float)) == 0, "nebula noise grid: size %d, grid differs from per point", size);
+			benchLog("%d, %.2f, %.2f, %.2f", size, perPointMs, batchMs, gridMs);
+		}
+	}
+
+	/*one configuration of shape noise (perlin fractal 3D, 3 octaves): the FastNoise call, which picks the kernel per call,
+	against the kernel of the configuration with the octave count from the object and compiled in, per point and batched*/
+	template <FastNoise::FractalType Fractal, FastNoise::Interp Interpolation>
+	static void benchNoiseKernel(const PODVector<float> *c, PODVector<float> &reference, PODVector<float> &out)
+	{
+		typedef NoiseKernel<FastNoise::PerlinFractal, Fractal, Interpolation> RuntimeOctaves;
+		typedef NoiseKernel<FastNoise::PerlinFractal, Fractal, Interpolation, 3> FixedOctaves;
+		const char * fractalNames[] = { "FBM", "billow", "rigid multi" };
+		const char * interpNames[] = { "linear", "hermite", "quintic" };
+		const unsigned numPoints = out.Size();
+		const unsigned bytes = numPoints * sizeof(float);
+
+		FastNoise noise(1337);
+		noise.SetFractalType(Fractal);
+		noise.SetInterp(Interpolation);
+		noise.SetFractalOctaves(3);
+
+		HiresTimer timer;
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+			reference[ii] = noise.GetPerlinFractal(c[0][ii], c[1][ii], c[2][ii]);
+		const float callMs = timer.GetUSec(true) / 1000.0f;
+
+		timer.Reset();
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+			out[ii] = RuntimeOctaves::Get(noise, c[0][ii], c[1][ii], c[2][ii]);
+		const float runtimeMs = timer.GetUSec(true) / 1000.0f;
+		benchCheck(memcmp(&reference[0], &out[0], bytes) == 0, "noise kernels: %s %s, kernel differs from GetPerlinFractal",
+			fractalNames[Fractal], interpNames[Interpolation]);
+
+		timer.Reset();
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+			out[ii] = FixedOctaves::Get(noise, c[0][ii], c[1][ii], c[2][ii]);
+		const float fixedMs = timer.GetUSec(true) / 1000.0f;
+		benchCheck(memcmp(&reference[0], &out[0], bytes) == 0, "noise kernels: %s %s, kernel with octaves differs from GetPerlinFractal",
+			fractalNames[Fractal], interpNames[Interpolation]);
+
+		timer.Reset();
+		FixedOctaves::GetBatch(noise, &c[0][0], &c[1][0], &c[2][0], &out[0], numPoints);
+		const float batchMs = timer.GetUSec(false) / 1000.0f;
+		benchCheck(memcmp(&reference[0], &out[0], bytes) == 0, "noise kernels: %s %s, kernel batch differs from GetPerlinFractal",
+			fractalNames[Fractal], interpNames[Interpolation]);
+
+		benchLog("%s %s, %u, %.2f, %.2f, %.2f, %.2f", fractalNames[Fractal], interpNames[Interpolation], numPoints,
+			callMs, runtimeMs, fixedMs, batchMs);
+	}
+
+	static void BenchmarkNoiseKernels()
+	{
+		benchLog("noise kernels (perlin fractal 3D, 3 octaves): configuration, points, GetPerlinFractal(ms), kernel(ms), kernel with octaves(ms), kernel batch(ms)");
+		const unsigned numPoints = 1 << 18;
+		PODVector<float> c[3];
+		randomCoordinates(2, 3, numPoints, c);
+
+		PODVector<float> reference(numPoints), out(numPoints);
+		benchNoiseKernel<FastNoise::FBM, FastNoise::Linear>(c, reference, out);
+		benchNoiseKernel<FastNoise::FBM, FastNoise::Hermite>(c, reference, out);
+		benchNoiseKernel<FastNoise::FBM, FastNoise::Quintic>(c, reference, out);
+		benchNoiseKernel<FastNoise::Billow, FastNoise::Linear>(c, reference, out);
+		benchNoiseKernel<FastNoise::Billow, FastNoise::Hermite>(c, reference, out);
+		benchNoiseKernel<FastNoise::Billow, FastNoise::Quintic>(c, reference, out);
+		benchNoiseKernel<FastNoise::RigidMulti, FastNoise::Linear>(c, reference, out);
+		benchNoiseKernel<FastNoise::RigidMulti, FastNoise::Hermite>(c, reference, out);
+		benchNoiseKernel<FastNoise::RigidMulti, FastNoise::Quintic>(c, reference, out);
+	}
+
+	/*
+	mean difference of the analytic gradients to central differences, relative to the mean gradient.
+	Not the largest: the FastNoise 4D simplex steps a little where the simplex changes, its corners reach further than 0.5
+	*/
+	template <class Function>
+	static float gradientError(Function function, const PODVector<float> *c, unsigned dims, unsigned numPoints)
+	{
+		const float h = 1e-2f;
+		double error = 0.0, magnitude = 0.0;
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+		{
+			float p[4], gradient[4], unused[4];
+			for (unsigned dd = 0; dd < dims; ++dd)
+				p[dd] = c[dd][ii];
+			function(p, gradient);
+			for (unsigned dd = 0; dd < dims; ++dd)
+			{
+				/*the step the rounded coordinates actually take*/
+				const float center = p[dd];
+				const float upper = center + h;
+				const float lower = center - h;
+				p[dd] = upper;
+				const float up = function(p, unused);
+				p[dd] = lower;
+				const float down = function(p, unused);
+				p[dd] = center;
+				error += Abs((up - down) / (upper - lower) - gradient[dd]);
+				magnitude += Abs(gradient[dd]);
+			}
+		}
+		return magnitude > 0.0 ? (float)(error / magnitude) : 0.0f;
+	}
+
+	static void BenchmarkNoiseGradients()
+	{
+		benchLog("noise gradients: function, points, value(ms), value and gradient(ms)");
+		const unsigned numPoints = 1 << 18;
+		const unsigned checkPoints = 4096;
+		/*about 5e-4 when the derivatives are right, a missing or wrong term makes it of order 1*/
+		const float maxGradientError = 1e-2f;
+		PODVector<float> c[4];
+		randomCoordinates(3, 4, numPoints, c);
+		PODVector<float> reference(numPoints), out(numPoints), gradient[4];
+		for (unsigned dd = 0; dd < 4; ++dd)
+			gradient[dd].Resize(numPoints);
+		const unsigned bytes = numPoints * sizeof(float);
+
+		FastNoise perlin(1337);
+		perlin.SetFrequency(0.02f);
+		HiresTimer timer;
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+			reference[ii] = perlin.GetPerlinFractal(c[0][ii], c[1][ii], c[2][ii]);
+		float valueMs = timer.GetUSec(true) / 1000.0f;
+		timer.Reset();
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+		{
+			float g[3];
+			out[ii] = perlin.GetPerlinFractalWithGradient(c[0][ii], c[1][ii], c[2][ii], g);
+		}
+		float gradientMs = timer.GetUSec(false) / 1000.0f;
+		benchCheck(memcmp(&reference[0], &out[0], bytes) == 0, "noise gradients: perlin fractal 3D values differ from GetPerlinFractal");
+		float error = gradientError([&perlin](const float *p, float *g) { return perlin.GetPerlinFractalWithGradient(p[0], p[1], p[2], g); }, c, 3, checkPoints);
+		benchCheck(error < maxGradientError, "noise gradients: perlin fractal 3D gradients are off central differences by %g", error);
+		benchLog("perlin fractal 3D, %u, %.2f, %.2f", numPoints, valueMs, gradientMs);
+
+		FastNoise simplex(1337);
+		simplex.SetFrequency(0.02f);
+		timer.Reset();
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+			reference[ii] = simplex.GetSimplex(c[0][ii], c[1][ii], c[2][ii], c[3][ii]);
+		valueMs = timer.GetUSec(true) / 1000.0f;
+		timer.Reset();
+		for (unsigned ii = 0; ii < numPoints; ++ii)
+		{
+			float g[4];
+			out[ii] = simplex.GetSimplexWithGradient(c[0][ii], c[1][ii], c[2][ii], c[3][ii], g);
+		}
+		gradientMs = timer.GetUSec(false) / 1000.0f;
+		benchCheck(memcmp(&reference[0], &out[0], bytes) == 0, "noise gradients: simplex 4D values differ from GetSimplex");
+		error = gradientError([&simplex](const float *p, float *g) { return simplex.GetSimplexWithGradient(p[0], p[1], p[2], p[3], g); }, c, 4, checkPoints);
+		benchCheck(error < maxGradientError, "noise gradients: simplex 4D gradients are off central differences by %g", error);
+		benchLog("simplex 4D, %u, %.2f, %.2f", numPoints, valueMs, gradientMs);
+
+		timer.Reset();
+		simplex.GetSimplexBatch(&c[0][0], &c[1][0], &c[2][0], &c[3][0], &out[0], numPoints);
+		valueMs = timer.GetUSec(true) / 1000.0f;
+		timer.Reset();
+		simplex.GetSimplexWithGradientBatch(&c[0][0], &c[1][0], &c[2][0], &c[3][0], &out[0], &gradient[0][0], &gradient[1][0], &gradient[2][0], &gradient[3][0], numPoints);
+		gradientMs = timer.GetUSec(false) / 1000.0f;
+		benchCheck(memcmp(&reference[0], &out[0], bytes) == 0, "noise gradients: simplex 4D batch values differ from GetSimplex");
+		/*the batch gradients are those of the per-point function*/
+		bool same = true;
+		for (unsigned ii = 0; ii < checkPoints && same; ++ii)
+		{
+			float g[4];
+			simplex.GetSimplexWithGradient(c[0][ii], c[1][ii], c[2][ii], c[3][ii], g);
+			same = memcmp(g, &gradient[0][ii], sizeof(float)) == 0 && memcmp(g + 1, &gradient[1][ii], sizeof(float)) == 0 &&
+				memcmp(g + 2, &gradient[2][ii], sizeof(float)) == 0 && memcmp(g + 3, &gradient[3][ii], sizeof(float)) == 0;
+		}
+		benchCheck(same, "noise gradients: simplex 4D batch gradients differ from GetSimplexWithGradient");
+		benchLog("simplex 4D batch, %u, %.2f, %.2f", numPoints, valueMs, gradientMs);
+	}
+
+	static void RunAsteroidBenchmarks(Context* ctx)
+	{
+		BenchmarkUvSolvers();
+		BenchmarkNormals();
+		BenchmarkShapeStages();
+		BenchmarkHeightMap(ctx);
+		BenchmarkAsteroidCache(ctx);
+		/*creates the worker threads, every section that needs a single threaded work queue goes before it*/
+		BenchmarkAsteroidDeterminism(ctx);
+		BenchmarkNoiseBatch();
+		BenchmarkNoiseGrid();
+		BenchmarkNoiseKernels();
+		BenchmarkNoiseGradients();
+	}
+}		/*namespace Urho3D*/
+
+int main()
+{
+	Urho3D::SharedPtr<Urho3D::Context> context(new Urho3D::Context());
+	context->RegisterSubsystem(new Urho3D::Log(context));
+	/*the asteroid jobs read and write their cache and run their stages on the work queue, which completes async items each frame*/
+	context->RegisterSubsystem(new Urho3D::FileSystem(context));
+	context->RegisterSubsystem(new Urho3D::WorkQueue(context));
+	context->RegisterSubsystem(new Urho3D::Time(context));
+	Urho3D::RunAsteroidBenchmarks(context);
+	return Urho3D::benchFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+#include "asteroid_cache.h"
+#include <atomic>
+#include <stdio.h>
+#include <Urho3D/Urho3DAll.h>
+
+namespace Urho3D
+{
+	static const char * ASTEROID_CACHE_ID = "ASTC";
+
+	static std::atomic<unsigned> cacheHits(0);
+	static std::atomic<unsigned> cacheMisses(0);
+	/*makes temporary file names unique when two jobs write the same key*/
+	static std::atomic<unsigned> tempFileCounter(0);
+
+	String GetAsteroidCacheFile(Context* ctx, const String &kind, unsigned long long seed, unsigned base, unsigned detail, unsigned textureSize)
+	{
+		FileSystem * fs = ctx->GetSubsystem<FileSystem>();
+		const String dir = fs->GetAppPreferencesDir("procedural_asteroid", "AsteroidCache");
+		if (dir.Empty() || (!fs->DirExists(dir) && !fs->CreateDir(dir)))
+			return String::EMPTY;
+		char name[128];
+		snprintf(name, sizeof(name), "%s_%016llx_%u_%u_%u_v%u.bin", kind.CString(), seed, base, detail, textureSize, ASTEROID_PIPELINE_VERSION);
+		return dir + name;
+	}
+
+	SharedPtr<File> OpenAsteroidCache(Context* ctx, const String &fileName)
+	{
+		if (fileName.Empty() || !ctx->GetSubsystem<FileSystem>()->FileExists(fileName))
+			return SharedPtr<File>();
+
+		SharedPtr<File> file(new File(ctx, fileName, FILE_READ));
+		if (!file->IsOpen() || file->ReadFileID() != ASTEROID_CACHE_ID || file->ReadUInt() != ASTEROID_PIPELINE_VERSION)
+			return SharedPtr<File>();
+		return file;
+	}
+
+	SharedPtr<File> CreateAsteroidCache(Context* ctx, const String &fileName)
+	{
+		if (fileName.Empty())
+			return SharedPtr<File>();
+
+		const String tempName = fileName + "." + String(tempFileCounter.fetch_add(1)) + ".tmp";
+		SharedPtr<File> file(new File(ctx, tempName, FILE_WRITE));
+		if (!file->IsOpen())
+			return SharedPtr<File>();
+		file->WriteFileID(ASTEROID_CACHE_ID);
+		file->WriteUInt(ASTEROID_PIPELINE_VERSION);
+		return file;
+	}
+
+	bool CommitAsteroidCache(Context* ctx, SharedPtr<File> &file, const String &fileName)
+	{
+		if (file == nullptr)
+			return false;
+
+		const String tempName = file->GetName();
+		file->Close();
+		file.Reset();
+
+		FileSystem * fs = ctx->GetSubsystem<FileSystem>();
+		/*Rename does not replace an existing file on every platform*/
+		if (fs->FileExists(fileName))
+			fs->Delete(fileName);
+		if (!fs->Rename(tempName, fileName))
+		{
+			fs->Delete(tempName);
+			return false;
+		}
+		return true;
+	}
+
+	void DiscardAsteroidCache(Context* ctx, SharedPtr<File> &file)
+	{
+		if (file == nullptr)
+			return;
+
+		const String tempName = file->GetName();
+		file->Close();
+		file.Reset();
+		ctx->GetSubsystem<FileSystem>()->Delete(tempName);
+	}
+
+	void CountAsteroidCacheLookup(bool hit)
+	{
+		if (hit)
+			++cacheHits;
+		else
+			++cacheMisses;
+	}
+
+	unsigned GetAsteroidCacheHits()
+	{
+		return cacheHits;
+	}
+
+	unsigned GetAsteroidCacheMisses()
+	{
+		return cacheMisses;
+	}
+
+	bool WriteCachedImage(Serializer &dst, const Image * image)
+	{
+		VectorBuffer png;
+		if (!image->Save(png))
+			return false;
+		return dst.WriteBuffer(png.GetBuffer());
+	}
+
+	bool ReadCachedImage(Deserializer &src, Image * image, int width, int height, unsigned components)
+	{
+		/*the size prefix of WriteBuffer; ReadBuffer would not tell a file that ends early*/
+		const unsigned size = src.ReadVLE();
+		if (size == 0 || src.GetPosition() > src.GetSize() || size > src.GetSize() - src.GetPosition())
+			return false;
+		PODVector<unsigned char> png(size);
+		if (src.Read(png.Buffer(), size) != size)
+			return false;
+		MemoryBuffer buffer(png);
+		if (!image->Load(buffer))
+			return false;
+		return image->GetWidth() == width && image->GetHeight() == height && image->GetDepth() == 1 && image->GetComponents() == components;
+	}
+}		/*namespace Urho3D*/
@@ -0,0 +1,85 @@
+#pragma once
+#include <Urho3D/Urho3DAll.h>
+#include "asteroid_mesh.h"
+
+namespace Urho3D
+{
+	/*bump whenever a change alters the generated meshes or textures, stale cache files are ignored afterwards*/
+	static const unsigned ASTEROID_PIPELINE_VERSION = 14;
+
+	/*
+	On-disk cache of generated asteroids keyed by (kind, seed, base mesh, detail, textureSize, ASTEROID_PIPELINE_VERSION).
+	GetAsteroidCacheFile() must be called on the main thread; the other functions are safe on worker threads.
+	*/
+	String GetAsteroidCacheFile(Context* ctx, const String &kind, unsigned long long seed, unsigned base, unsigned detail, unsigned textureSize);
+	/*open a cache file for reading and validate its header, nullptr when absent or stale*/
+	SharedPtr<File> OpenAsteroidCache(Context* ctx, const String &fileName);
+	/*write the header to a temporary file next to fileName*/
+	SharedPtr<File> CreateAsteroidCache(Context* ctx, const String &fileName);
+	/*close the temporary file and move it in place, so readers never see a partial file*/
+	bool CommitAsteroidCache(Context* ctx, SharedPtr<File> &file, const String &fileName);
+	/*close and delete the temporary file*/
+	void DiscardAsteroidCache(Context* ctx, SharedPtr<File> &file);
+
+	/*lookups are counted by the caller, a file that fails to read after the header is still a miss*/
+	void CountAsteroidCacheLookup(bool hit);
+	unsigned GetAsteroidCacheHits();
+	unsigned GetAsteroidCacheMisses();
+
+	template <class T>
+	void WriteCachedArray(Serializer &dst, const PODVector<T> &arr)
+	{
+		dst.WriteUInt(arr.Size());
+		dst.WriteUInt(sizeof(T));
+		if (!arr.Empty())
+			dst.Write(arr.Buffer(), arr.Size() * sizeof(T));
+	}
+
+	template <class T>
+	bool ReadCachedArray(Deserializer &src, PODVector<T> &arr)
+	{
+		const unsigned size = src.ReadUInt();
+		if (src.ReadUInt() != sizeof(T))
+			return false;
+		/*a damaged file must not make us allocate more than it can hold*/
+		if (src.GetPosition() > src.GetSize() || size > (src.GetSize() - src.GetPosition()) / sizeof(T))
+			return false;
+		arr.Resize(size);
+		if (size == 0)
+			return true;
+		const size_t bytes = (size_t)size * sizeof(T);
+		return src.Read(arr.Buffer(), (unsigned)bytes) == bytes;
+	}
+
+	/*both arrays are written, the unused one is empty*/
+	inline void WriteCachedIndices(Serializer &dst, const AsteroidIndices &id)
+	{
+		WriteCachedArray(dst, id.small_);
+		WriteCachedArray(dst, id.large_);
+	}
+
+	template <class I>
+	bool IndicesInRange(const PODVector<I> &id, unsigned numVertices)
+	{
+		for (unsigned ii = 0; ii < id.Size(); ++ii)
+		{
+			if (id[ii] >= numVertices)
+				return false;
+		}
+		return true;
+	}
+
+	/*numVertices is the size of the vertex array read for the same geometry, indices past it are a damaged file*/
+	inline bool ReadCachedIndices(Deserializer &src, AsteroidIndices &id, unsigned numVertices)
+	{
+		if (!ReadCachedArray(src, id.small_) || !ReadCachedArray(src, id.large_))
+			return false;
+		if (!id.small_.Empty() && (!id.large_.Empty() || needsLargeIndices(numVertices)))
+			return false;
+		return IndicesInRange(id.small_, numVertices) && IndicesInRange(id.large_, numVertices);
+	}
+
+	/*PNG-compressed image; reading fails unless the decoded image has the expected size and component count*/
+	bool WriteCachedImage(Serializer &dst, const Image * image);
+	bool ReadCachedImage(Deserializer &src, Image * image, int width, int height, unsigned components);
+}		/*namespace Urho3D*/
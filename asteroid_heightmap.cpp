@@ -0,0 +1,436 @@
+#include "asteroid_heightmap.h"
+#include <Urho3D/Urho3DAll.h>
+
+namespace Urho3D
+{
+	/*craters are stamped tile by tile; a tile only visits the craters whose footprint overlaps it*/
+	static const int CRATER_TILE_SIZE = 64;
+
+	/*tile range covered by the stamp's bounding square, clipped to the image*/
+	static void stampTiles(const crater_stamp &stamp, int size, int &minTileX, int &minTileY, int &maxTileX, int &maxTileY)
+	{
+		const int r = (int)stamp.radius_;
+		minTileX = Max(stamp.x_ - r, 0) / CRATER_TILE_SIZE;
+		minTileY = Max(stamp.y_ - r, 0) / CRATER_TILE_SIZE;
+		maxTileX = Min(stamp.x_ + r, size - 1) / CRATER_TILE_SIZE;
+		maxTileY = Min(stamp.y_ + r, size - 1) / CRATER_TILE_SIZE;
+	}
+
+	static void binCraters(const PODVector<crater_stamp> &stamps, int size, crater_bins &bins)
+	{
+		bins.tilesPerSide_ = (size + CRATER_TILE_SIZE - 1) / CRATER_TILE_SIZE;
+		const unsigned numTiles = bins.tilesPerSide_ * bins.tilesPerSide_;
+		bins.offsets_.Resize(numTiles + 1);
+		for (unsigned ii = 0; ii < numTiles + 1; ++ii)
+			bins.offsets_[ii] = 0;
+
+		int minTileX, minTileY, maxTileX, maxTileY;
+		for (unsigned ii = 0; ii < stamps.Size(); ++ii)
+		{
+			stampTiles(stamps[ii], size, minTileX, minTileY, maxTileX, maxTileY);
+			for (int ty = minTileY; ty <= maxTileY; ++ty)
+				for (int tx = minTileX; tx <= maxTileX; ++tx)
+					bins.offsets_[ty * bins.tilesPerSide_ + tx + 1] += 1;
+		}
+		for (unsigned ii = 0; ii < numTiles; ++ii)
+			bins.offsets_[ii + 1] += bins.offsets_[ii];
+
+		PODVector<unsigned> cursor(bins.offsets_.Buffer(), numTiles);
+		bins.stamps_.Resize(bins.offsets_[numTiles]);
+		for (unsigned ii = 0; ii < stamps.Size(); ++ii)
+		{
+			stampTiles(stamps[ii], size, minTileX, minTileY, maxTileX, maxTileY);
+			for (int ty = minTileY; ty <= maxTileY; ++ty)
+				for (int tx = minTileX; tx <= maxTileX; ++tx)
+					bins.stamps_[cursor[ty * bins.tilesPerSide_ + tx]++] = ii;
+		}
+	}
+
+	/*depth of the bowl below its rim at the squared distance sqrDist from the center, 0 outside*/
+	static float craterDepth(float sqrDist, float radius)
+	{
+		return Sqrt(Max(1.0f - sqrDist / (radius * radius), 0.0f)) * 0.5f;
+	}
+
+	/*
+	spherical bowl, overwrites the height below it; only the part inside [minX, maxX) x [minY, maxY) is written.
+	slopeX and slopeY are the slope planes or null; the bowl gets infinitely steep at the rim,
+	so its slope is the height difference across the pixel
+	*/
+	static void stampCrater(PODVector<float> &height, float *slopeX, float *slopeY, int size, const crater_stamp &stamp, int minX, int minY, int maxX, int maxY)
+	{
+		const int r = (int)stamp.radius_;
+		const int x0 = Max(stamp.x_ - r, minX);
+		const int y0 = Max(stamp.y_ - r, minY);
+		const int x1 = Min(stamp.x_ + r + 1, maxX);
+		const int y1 = Min(stamp.y_ + r + 1, maxY);
+		const float radius = stamp.radius_;
+		for (int y = y0; y < y1; ++y)
+		{
+			const int sqrY = (y - stamp.y_) * (y - stamp.y_);
+			float *row = &height[y * size];
+			for (int x = x0; x < x1; ++x)
+			{
+				const int sqrX = (x - stamp.x_) * (x - stamp.x_);
+				if (sqrX + sqrY <= radius * radius)
+				{
+					float cosTheta = Sqrt((float)sqrX + sqrY) / radius;
+					float sinTheta = Sqrt(1.0f - cosTheta * cosTheta);
+					float deepness = sinTheta * 0.5f;		//radius * sinTheta * 0.5f / radius
+					row[x] = 0.5f - deepness;
+					if (slopeX != nullptr)
+					{
+						const float fx = (float)(x - stamp.x_);
+						const float fy = (float)(y - stamp.y_);
+						slopeX[y * size + x] = craterDepth((fx - 0.5f) * (fx - 0.5f) + fy * fy, radius) - craterDepth((fx + 0.5f) * (fx + 0.5f) + fy * fy, radius);
+						slopeY[y * size + x] = craterDepth(fx * fx + (fy - 0.5f) * (fy - 0.5f), radius) - craterDepth(fx * fx + (fy + 0.5f) * (fy + 0.5f), radius);
+					}
+				}
+			}
+		}
+	}
+
+	/*the fBm is normalized to [-0.5, 0.5], then scaled around the base level 0.5*/
+	static const float TOPOGRAPHY_FACTOR = 0.3f;
+	/*the white noise is normalized to [-0.5, 0.5], then scaled and added*/
+	static const float ROUGHNESS_FACTOR = 0.1f;
+
+	/*
+	normal map as github.com/cpetry/NormalMap-Online makes it: the Sobel derivatives of the height scaled by 255
+	against a z of (1 + 2^level) / strength, level 7 and strength 2.5. A Sobel kernel answers a unit slope with 8
+	*/
+	static const float NORMAL_Z = (1.0f + 128.0f) / 2.5f;
+	static const float SOBEL_SLOPE = 8.0f;
+	/*
+	the roughness is white noise, its grain is the Sobel response to it. The kernel used to run on bilinear samples
+	half a pixel off, that blur left sqrt(5 / 12) of the response; the grain keeps that strength
+	*/
+	static const float ROUGHNESS_GRAIN = 0.6455f;
+
+	/*
+	the slope of a noise octave finer than the pixels would only alias, the image can not show that octave either.
+	Its slope fades out between SLOPE_FADE_START and SLOPE_FADE_END lattice cells per pixel
+	*/
+	static const float SLOPE_FADE_START = 0.25f;
+	static const float SLOPE_FADE_END = 0.5f;
+
+	static float slopeFade(float cellsPerPixel)
+	{
+		return Clamp((SLOPE_FADE_END - cellsPerPixel) / (SLOPE_FADE_END - SLOPE_FADE_START), 0.0f, 1.0f);
+	}
+
+	/*the same rounding as Image::SetPixel()*/
+	static unsigned char quantize(float f)
+	{
+		return (unsigned char)Clamp((int)(f * 255.0f), 0, 255);
+	}
+
+	/*reciprocal of the range for the mapping of [min, max] to [-0.5, 0.5]*/
+	static float normalizeScale(float min, float max)
+	{
+		return max > min ? 1.0f / (max - min) : 0.0f;
+	}
+
+	AsteroidHeightMap::AsteroidHeightMap()
+		: image_(nullptr), normal_(nullptr), size_(0), x1_(0.0f), y1_(0.0f), dx_(0.0f), dy_(0.0f)
+	{
+		bins_.tilesPerSide_ = 0;
+	}
+
+	bool AsteroidHeightMap::Begin(Image * ret, Image * normal, int size, AsteroidRandom &rng, const AsteroidCraterParams &craters)
+	{
+		bins_.tilesPerSide_ = 0;
+		if (ret->SetSize(size, size, 1) == false || (normal != nullptr && normal->SetSize(size, size, 4) == false))
+		{
+			URHO3D_LOGERROR("CreateCraterHeightMap: Image::SetSize fail");
+			return false;
+		}
+		image_ = ret;
+		normal_ = normal;
+		size_ = size;
+
+		/*topography height; need to be tile-able
+		www.gamedev.net/blogs/entry/2138456-seamless-noise/
+		*/
+		simplex_.SetSeed(rng.NextSeed());
+		simplex_.SetFrequency(0.02f);
+
+		x1_ = rng.Random(500.0f);
+		y1_ = rng.Random(500.0f);
+		const float x2 = x1_ + rng.Random(500.0f);
+		const float y2 = y1_ + rng.Random(500.0f);
+		dx_ = x2 - x1_;
+		dy_ = y2 - y1_;
+
+		/*the torus coordinates of a column only depend on x, those of a row only on y*/
+		columnX_.Resize(size);
+		columnZ_.Resize(size);
+		columnDX_.Resize(size);
+		columnDZ_.Resize(size);
+		for (int x = 0; x < size; ++x)
+		{
+			const float s = (float)x / size;
+			columnX_[x] = x1_ + Cos(s * 360.0f)*dx_ / (2 * M_PI);
+			columnZ_[x] = x1_ + Sin(s * 360.0f)*dx_ / (2 * M_PI);
+			columnDX_[x] = -Sin(s * 360.0f)*dx_ / size;
+			columnDZ_[x] = Cos(s * 360.0f)*dx_ / size;
+		}
+
+		/*
+		the center may be anywhere, a crater crossing the image border continues on the opposite side like the topography.
+		Every crater is stamped as up to 4 copies shifted by the image size, each clipped to the image.
+		*/
+		const unsigned numCraters = rng.Random(craters.minCraters_, craters.maxCraters_);
+		const float maxRadius = size * 0.5f - 1.0f;
+		stamps_.Clear();
+		for (unsigned ii = 0; ii < numCraters; ++ii)
+		{
+			crater_stamp crater;
+			crater.x_ = rng.Random(0, size);
+			crater.y_ = rng.Random(0, size);
+			crater.radius_ = Min(rng.Random(craters.minRadius_, craters.maxRadius_), maxRadius);
+
+			const int r = (int)crater.radius_;
+			for (int oy = -1; oy <= 1; ++oy)
+			{
+				for (int ox = -1; ox <= 1; ++ox)
+				{
+					crater_stamp stamp(crater);
+					stamp.x_ += ox * size;
+					stamp.y_ += oy * size;
+					if (stamp.x_ + r >= 0 && stamp.x_ - r < size && stamp.y_ + r >= 0 && stamp.y_ - r < size)
+						stamps_.Push(stamp);
+				}
+			}
+		}
+		/*a band is one row of crater tiles*/
+		binCraters(stamps_, size, bins_);
+
+		/*add shallow roughness: white noise of the integer pixel coordinates*/
+		cell_.SetSeed(rng.NextSeed());
+		cell_.SetNoiseType(FastNoise::WhiteNoise);
+		cell_.SetFrequency(1.0f);
+
+		height_.Resize(size * size);
+		roughness_.Resize(size * size);
+		slopeX_.Resize(normal != nullptr ? size * size : 0);
+		slopeY_.Resize(normal != nullptr ? size * size : 0);
+		heightMin_.Resize(GetNumBands());
+		heightMax_.Resize(GetNumBands());
+		roughnessMin_.Resize(GetNumBands());
+		roughnessMax_.Resize(GetNumBands());
+		return true;
+	}
+
+	void AsteroidHeightMap::RunNoiseBand(unsigned band)
+	{
+		const int size = size_;
+		const int minY = band * CRATER_TILE_SIZE;
+		const int maxY = Min(minY + CRATER_TILE_SIZE, size);
+
+		/*one row of coordinates for the batch calls, scaled in place octave by octave*/
+		PODVector<float> nx(size), ny(size), nz(size), nw(size), octave(size);
+		/*with a normal map the gradient of every octave, chained through the torus coordinates into slopes along x and y*/
+		const bool slopes = normal_ != nullptr;
+		PODVector<float> gradX(slopes ? size : 0), gradY(slopes ? size : 0), gradZ(slopes ? size : 0), gradW(slopes ? size : 0);
+
+		float max = -FLT_MAX, min = FLT_MAX;
+		for (int y = minY; y < maxY; ++y)
+		{
+			const float t = (float)y / size;
+			const float rowY = y1_ + Cos(t * 360.0f)*dy_ / (2 * M_PI);
+			const float rowW = y1_ + Sin(t * 360.0f)*dy_ / (2 * M_PI);
+			const float rowDY = -Sin(t * 360.0f)*dy_ / size;
+			const float rowDW = Cos(t * 360.0f)*dy_ / size;
+			for (int x = 0; x < size; ++x)
+			{
+				nx[x] = columnX_[x];
+				ny[x] = rowY;
+				nz[x] = columnZ_[x];
+				nw[x] = rowW;
+			}
+
+			const unsigned octaves = 5;
+			const float lacunarity = 2.0f;
+			const float gain = 0.5f;
+			float amp = 1.0f;
+			float scale = 1.0f;
+			float *row = &height_[y * size];
+			for (unsigned ii = 0; ii <= octaves; ++ii)
+			{
+				if (ii > 0)
+				{
+					for (int x = 0; x < size; ++x)
+					{
+						nx[x] *= lacunarity;
+						ny[x] *= lacunarity;
+						nz[x] *= lacunarity;
+						nw[x] *= lacunarity;
+					}
+					amp *= gain;
+					scale *= lacunarity;
+				}
+				/*the torus coordinates move by dx_ / size per column and dy_ / size per row*/
+				const float fadeX = slopes ? slopeFade(simplex_.GetFrequency() * scale * dx_ / size) : 0.0f;
+				const float fadeY = slopes ? slopeFade(simplex_.GetFrequency() * scale * dy_ / size) : 0.0f;
+				const bool octaveSlopes = fadeX > 0.0f || fadeY > 0.0f;
+				float *dest = ii == 0 ? row : &octave[0];
+				if (octaveSlopes)
+					simplex_.GetSimplexWithGradientBatch(&nx[0], &ny[0], &nz[0], &nw[0], dest, &gradX[0], &gradY[0], &gradZ[0], &gradW[0], size);
+				else
+					simplex_.GetSimplexBatch(&nx[0], &ny[0], &nz[0], &nw[0], dest, size);
+				if (ii > 0)
+				{
+					for (int x = 0; x < size; ++x)
+						row[x] += octave[x] * amp;
+				}
+				if (slopes)
+				{
+					float *slopeX = &slopeX_[y * size];
+					float *slopeY = &slopeY_[y * size];
+					if (ii == 0)
+					{
+						for (int x = 0; x < size; ++x)
+							slopeX[x] = slopeY[x] = 0.0f;
+					}
+					if (octaveSlopes)
+					{
+						/*the octave samples the coordinates times scale, so its slope is scaled by that too*/
+						const float slopeScaleX = amp * scale * fadeX;
+						const float slopeScaleY = amp * scale * fadeY;
+						for (int x = 0; x < size; ++x)
+						{
+							slopeX[x] += (gradX[x] * columnDX_[x] + gradZ[x] * columnDZ_[x]) * slopeScaleX;
+							slopeY[x] += (gradY[x] * rowDY + gradW[x] * rowDW) * slopeScaleY;
+						}
+					}
+				}
+			}
+			for (int x = 0; x < size; ++x)
+			{
+				min = Min(min, row[x]);
+				max = Max(max, row[x]);
+			}
+		}
+		heightMin_[band] = min;
+		heightMax_[band] = max;
+
+		cell_.GetNoiseGrid2D(0.0f, (float)minY, 1.0f, 1.0f, size, maxY - minY, &roughness_[minY * size], size);
+		max = -FLT_MAX, min = FLT_MAX;
+		for (int ii = minY * size; ii < maxY * size; ++ii)
+		{
+			min = Min(min, roughness_[ii]);
+			max = Max(max, roughness_[ii]);
+		}
+		roughnessMin_[band] = min;
+		roughnessMax_[band] = max;
+	}
+
+	void AsteroidHeightMap::RunComposeBand(unsigned band)
+	{
+		const int size = size_;
+		const int minY = band * CRATER_TILE_SIZE;
+		const int maxY = Min(minY + CRATER_TILE_SIZE, size);
+
+		/*min and max do not depend on the order, so every band reduces the few per band values itself*/
+		float heightMin = FLT_MAX, heightMax = -FLT_MAX, roughnessMin = FLT_MAX, roughnessMax = -FLT_MAX;
+		for (unsigned ii = 0; ii < GetNumBands(); ++ii)
+		{
+			heightMin = Min(heightMin, heightMin_[ii]);
+			heightMax = Max(heightMax, heightMax_[ii]);
+			roughnessMin = Min(roughnessMin, roughnessMin_[ii]);
+			roughnessMax = Max(roughnessMax, roughnessMax_[ii]);
+		}
+
+		/*base level 0.5 plus the topography normalized to [-0.5, 0.5], both in one pass*/
+		const float heightScale = normalizeScale(heightMin, heightMax);
+		for (int ii = minY * size; ii < maxY * size; ++ii)
+		{
+			const float topography = (height_[ii] - heightMin) * heightScale - 0.5f;
+			height_[ii] = 0.5f + (topography - 0.5f) * TOPOGRAPHY_FACTOR;
+		}
+		const bool slopes = normal_ != nullptr;
+		if (slopes)
+		{
+			for (int ii = minY * size; ii < maxY * size; ++ii)
+			{
+				slopeX_[ii] *= heightScale * TOPOGRAPHY_FACTOR;
+				slopeY_[ii] *= heightScale * TOPOGRAPHY_FACTOR;
+			}
+		}
+
+		for (int tx = 0; tx < bins_.tilesPerSide_; ++tx)
+		{
+			const unsigned tile = band * bins_.tilesPerSide_ + tx;
+			const int minX = tx * CRATER_TILE_SIZE;
+			const int maxX = Min(minX + CRATER_TILE_SIZE, size);
+			for (unsigned ii = bins_.offsets_[tile]; ii < bins_.offsets_[tile + 1]; ++ii)
+				stampCrater(height_, slopes ? &slopeX_[0] : nullptr, slopes ? &slopeY_[0] : nullptr, size, stamps_[bins_.stamps_[ii]], minX, minY, maxX, maxY);
+		}
+
+		/*the roughness is added while quantizing, the same rounding as Image::SetPixel()*/
+		const float roughnessScale = normalizeScale(roughnessMin, roughnessMax);
+		unsigned char *dest = image_->GetData();
+		for (int ii = minY * size; ii < maxY * size; ++ii)
+		{
+			const float rough = (roughness_[ii] - roughnessMin) * roughnessScale - 0.5f;
+			const float h = height_[ii] + (rough - 0.5f) * ROUGHNESS_FACTOR;
+			dest[ii] = quantize(h);
+		}
+		if (!slopes)
+			return;
+
+		/*
+		the white noise roughness has no slope, it is the only layer that keeps the Sobel kernel, on the float plane that wraps like the image.
+		The roughness rows above and below the band belong to other bands, they are complete since the noise pass
+		*/
+		const float roughnessSlope = roughnessScale * ROUGHNESS_FACTOR * ROUGHNESS_GRAIN;
+		unsigned char *normal = normal_->GetData();
+		for (int y = minY; y < maxY; ++y)
+		{
+			const float *up = &roughness_[(y == 0 ? size - 1 : y - 1) * size];
+			const float *mid = &roughness_[y * size];
+			const float *down = &roughness_[(y == size - 1 ? 0 : y + 1) * size];
+			for (int x = 0; x < size; ++x)
+			{
+				const int left = x == 0 ? size - 1 : x - 1;
+				const int right = x == size - 1 ? 0 : x + 1;
+				const float roughX = up[right] + mid[right] * 2.0f + down[right] - up[left] - mid[left] * 2.0f - down[left];
+				const float roughY = up[left] + up[x] * 2.0f + up[right] - down[left] - down[x] * 2.0f - down[right];
+
+				/*the image rows grow downwards, its y derivative is the one of the rows above minus the ones below*/
+				const int ii = y * size + x;
+				const float dx = slopeX_[ii] * SOBEL_SLOPE + roughX * roughnessSlope;
+				const float dy = -slopeY_[ii] * SOBEL_SLOPE + roughY * roughnessSlope;
+				const Vector3 n = Vector3(-dx * 255.0f, -dy * 255.0f, NORMAL_Z).Normalized();
+				normal[ii * 4] = quantize(n.x_ * 0.5f + 0.5f);
+				normal[ii * 4 + 1] = quantize(n.y_ * 0.5f + 0.5f);
+				normal[ii * 4 + 2] = quantize(n.z_);
+				normal[ii * 4 + 3] = 255;
+			}
+		}
+	}
+
+	void AsteroidHeightMap::Clear()
+	{
+		height_.Clear();
+		roughness_.Clear();
+		slopeX_.Clear();
+		slopeY_.Clear();
+		stamps_.Clear();
+		bins_.offsets_.Clear();
+		bins_.stamps_.Clear();
+	}
+
+	bool CreateCraterHeightMap(Image * ret, int size, AsteroidRandom &rng, const AsteroidCraterParams &craters, Image * normal)
+	{
+		AsteroidHeightMap heightMap;
+		if (!heightMap.Begin(ret, normal, size, rng, craters))
+			return false;
+		for (unsigned ii = 0; ii < heightMap.GetNumBands(); ++ii)
+			heightMap.RunNoiseBand(ii);
+		for (unsigned ii = 0; ii < heightMap.GetNumBands(); ++ii)
+			heightMap.RunComposeBand(ii);
+		return true;
+	}
+}		/*namespace Urho3D*/
@@ -0,0 +1,87 @@
+#pragma once
+#include "asteroid_random.h"
+#include "FastNoise.h"
+#include <Urho3D/Urho3DAll.h>
+
+namespace Urho3D
+{
+	/*the crater layer of the two asteroid kinds differs only in these ranges*/
+	struct AsteroidCraterParams
+	{
+		/*number of craters in [minCraters_, maxCraters_)*/
+		int minCraters_;
+		int maxCraters_;
+		/*radius in pixels in [minRadius_, maxRadius_)*/
+		float minRadius_;
+		float maxRadius_;
+	};
+
+	struct crater_stamp
+	{
+		/*center in pixels; outside the image for the copies that wrap around the image border*/
+		int x_, y_;
+		float radius_;
+	};
+
+	/*
+	per tile lists of stamps, in stamp order so overlapping craters still overwrite each other in the order they were drawn.
+	stamps_[offsets_[t]] to stamps_[offsets_[t + 1]] are the stamps of tile t
+	*/
+	struct crater_bins
+	{
+		int tilesPerSide_;
+		PODVector<unsigned> offsets_;
+		PODVector<unsigned> stamps_;
+	};
+
+	/*
+	tile-able single channel height map of size x size: topography noise, craters and shallow roughness.
+	The layers are summed on one float plane and quantized into the image once at the end.
+	Optionally the matching RGBA normal map is written in the same passes: the slopes of the topography come
+	from the analytic gradient of its noise, those of the craters from their bowl, only the white noise
+	roughness is differentiated across neighbouring pixels.
+
+	The synthesis is split into bands of rows that can run as parallel tasks:
+	Begin() draws every random parameter, then RunNoiseBand() has to run for every band, then RunComposeBand() for every band.
+	The bands of a pass may run in any order and on any thread, the image does not depend on it.
+	*/
+	class AsteroidHeightMap
+	{
+	public:
+		AsteroidHeightMap();
+
+		/*sizes the images, normal may be null; false if that fails, the bands must not run then*/
+		bool Begin(Image * ret, Image * normal, int size, AsteroidRandom &rng, const AsteroidCraterParams &craters);
+		unsigned GetNumBands() const { return bins_.tilesPerSide_; }
+		/*fBm topography and white noise roughness of the rows of the band, and their ranges*/
+		void RunNoiseBand(unsigned band);
+		/*normalizes the band with the ranges of all bands, stamps its craters, adds the roughness and quantizes it into the image, then its normals*/
+		void RunComposeBand(unsigned band);
+		/*release the float planes*/
+		void Clear();
+
+	private:
+		Image * image_;
+		Image * normal_;
+		int size_;
+		FastNoise simplex_;
+		FastNoise cell_;
+		/*torus coordinates of the columns and their derivatives along x*/
+		PODVector<float> columnX_, columnZ_;
+		PODVector<float> columnDX_, columnDZ_;
+		float x1_, y1_, dx_, dy_;
+		PODVector<crater_stamp> stamps_;
+		crater_bins bins_;
+		/*row major like the image, [y * size + x]*/
+		PODVector<float> height_;
+		PODVector<float> roughness_;
+		/*derivatives of height_ along x and y, only with a normal map*/
+		PODVector<float> slopeX_, slopeY_;
+		/*per band ranges, reduced by every compose band*/
+		PODVector<float> heightMin_, heightMax_;
+		PODVector<float> roughnessMin_, roughnessMax_;
+	};
+
+	/*Begin() and both passes of AsteroidHeightMap on the calling thread*/
+	bool CreateCraterHeightMap(Image * ret, int size, AsteroidRandom &rng, const AsteroidCraterParams &craters, Image * normal = nullptr);
+}		/*namespace Urho3D*/
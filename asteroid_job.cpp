@@ -0,0 +1,91 @@
+#include "asteroid_job.h"
+#include <Urho3D/Urho3DAll.h>
+
+namespace Urho3D
+{
+	/*
+	Async tasks use the lowest priority so the per-frame WorkQueue::Complete(M_MAX_UNSIGNED) calls of the engine
+	never wait for asteroid generation; Run() uses the highest one to wait only for its own tasks.
+	*/
+	static const unsigned ASYNC_TASK_PRIORITY = 0;
+	static const unsigned SYNC_TASK_PRIORITY = M_MAX_UNSIGNED;
+
+	AsteroidJob::AsteroidJob(Context* ctx)
+		: Object(ctx), stage_(0), pendingTasks_(0), completed_(false)
+	{
+	}
+
+	void AsteroidJob::ExecuteTask(const WorkItem* item, unsigned threadIndex)
+	{
+		AsteroidJob* job = static_cast<AsteroidJob*>(item->aux_);
+		/*start_ carries the task index, stage_ does not change while tasks of a stage are running*/
+		job->RunTask(job->stage_, (unsigned)(size_t)item->start_);
+	}
+
+	bool AsteroidJob::QueueStage(unsigned priority, bool sendEvent)
+	{
+		const unsigned numTasks = GetNumTasks(stage_);
+		if (numTasks == 0)
+			return false;
+
+		WorkQueue* queue = GetSubsystem<WorkQueue>();
+		pendingTasks_ = numTasks;
+		for (unsigned ii = 0; ii < numTasks; ++ii)
+		{
+			SharedPtr<WorkItem> item = queue->GetFreeItem();
+			item->priority_ = priority;
+			item->workFunction_ = ExecuteTask;
+			item->aux_ = this;
+			item->start_ = (void*)(size_t)ii;
+			item->end_ = nullptr;
+			item->sendEvent_ = sendEvent;
+			queue->AddWorkItem(item);
+		}
+		return true;
+	}
+
+	void AsteroidJob::StartAsync()
+	{
+		self_ = this;
+		SubscribeToEvent(E_WORKITEMCOMPLETED, URHO3D_HANDLER(AsteroidJob, HandleWorkItemCompleted));
+		stage_ = 0;
+		if (!QueueStage(ASYNC_TASK_PRIORITY, true))
+			Finish();
+	}
+
+	void AsteroidJob::Run()
+	{
+		WorkQueue* queue = GetSubsystem<WorkQueue>();
+		for (stage_ = 0; QueueStage(SYNC_TASK_PRIORITY, false); ++stage_)
+		{
+			queue->Complete(SYNC_TASK_PRIORITY);
+			pendingTasks_ = 0;
+		}
+		Finish();
+	}
+
+	void AsteroidJob::HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData)
+	{
+		using namespace WorkItemCompleted;
+
+		WorkItem* item = static_cast<WorkItem*>(eventData[P_ITEM].GetPtr());
+		if (item == nullptr || item->aux_ != this || item->workFunction_ != ExecuteTask)
+			return;
+
+		if (--pendingTasks_ > 0)
+			return;
+
+		++stage_;
+		if (!QueueStage(ASYNC_TASK_PRIORITY, true))
+			Finish();
+	}
+
+	void AsteroidJob::Finish()
+	{
+		UnsubscribeFromEvent(E_WORKITEMCOMPLETED);
+		Finalize();
+		completed_ = true;
+		/*may delete the job, so it must come last*/
+		self_.Reset();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <Urho3D/Urho3DAll.h>
+
+namespace Urho3D
+{
+	/*
+	Asteroid generation split into stages.
+	All tasks of a stage run in parallel on WorkQueue worker threads and must only touch CPU side data;
+	the next stage is queued once every task of the previous one is done.
+	After the last stage, Finalize() creates the Urho objects (buffers, textures, materials) on the main thread.
+	*/
+	class AsteroidJob : public Object
+	{
+		URHO3D_OBJECT(AsteroidJob, Object);
+
+	public:
+		explicit AsteroidJob(Context* ctx);
+
+		/*queue the first stage and return immediately; the job keeps itself alive until it is finalized*/
+		void StartAsync();
+		/*run every stage before returning, the calling main thread works together with the worker threads*/
+		void Run();
+		/*true once Finalize() has run*/
+		bool IsCompleted() const { return completed_; }
+
+	protected:
+		/*number of tasks in the stage, called on the main thread; 0 ends the job: later stages are not run and Finalize() follows*/
+		virtual unsigned GetNumTasks(unsigned stage) = 0;
+		/*called on a worker thread (or on the main thread while it waits in Run())*/
+		virtual void RunTask(unsigned stage, unsigned task) = 0;
+		/*called on the main thread after the last stage*/
+		virtual void Finalize() = 0;
+
+	private:
+		/*queue the tasks of stage_, return false if there are none, which ends the job*/
+		bool QueueStage(unsigned priority, bool sendEvent);
+		void Finish();
+		void HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData);
+		static void ExecuteTask(const WorkItem* item, unsigned threadIndex);
+
+		unsigned stage_;
+		unsigned pendingTasks_;
+		bool completed_;
+		/*reference held by the job itself while it runs asynchronously*/
+		SharedPtr<AsteroidJob> self_;
+	};
+}		/*namespace Urho3D*/
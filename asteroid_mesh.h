@@ -0,0 +1,866 @@
+#pragma once
+#include <limits>
+#include <Urho3D/Urho3DAll.h>
+#include "asteroid_random.h"
+
+/*mesh helpers shared by the UV mapped and the triplanar asteroid;
+vertex type T only needs a Vector3 position (and a Vector3 normal for calculateNormal);
+index type I is unsigned short or unsigned*/
+
+namespace Urho3D
+{
+	/*true if indices of I can address numVertices vertices*/
+	template <class I>
+	bool indicesFit(unsigned numVertices)
+	{
+		return numVertices == 0 || numVertices - 1 <= (unsigned)std::numeric_limits<I>::max();
+	}
+
+	/*geometries keep 16 bit indices while every vertex is addressable*/
+	inline bool needsLargeIndices(unsigned numVertices)
+	{
+		return numVertices > 65535;
+	}
+
+	/*
+	index buffer of one geometry in the narrowest type for its vertex count, picked at run time.
+	Meshes are generated with 32 bit indices and narrowed here, so small asteroids keep half size index buffers
+	while detailed ones can exceed 65535 vertices in the same build. Only one of the arrays is used.
+	*/
+	struct AsteroidIndices
+	{
+		PODVector<unsigned short> small_;
+		PODVector<unsigned> large_;
+
+		bool IsLarge() const { return !large_.Empty(); }
+		unsigned Size() const { return IsLarge() ? large_.Size() : small_.Size(); }
+		unsigned IndexSize() const { return IsLarge() ? sizeof(unsigned) : sizeof(unsigned short); }
+		const void * Data() const { return IsLarge() ? (const void *)large_.Buffer() : (const void *)small_.Buffer(); }
+
+		template <class I>
+		void Assign(const PODVector<I> &id, unsigned numVertices)
+		{
+			small_.Clear();
+			large_.Clear();
+			if (needsLargeIndices(numVertices))
+			{
+				large_.Resize(id.Size());
+				for (unsigned ii = 0; ii < id.Size(); ++ii)
+					large_[ii] = id[ii];
+			}
+			else
+			{
+				small_.Resize(id.Size());
+				for (unsigned ii = 0; ii < id.Size(); ++ii)
+					small_[ii] = (unsigned short)id[ii];
+			}
+		}
+	};
+
+	template <class T>
+	BoundingBox calculateBB(const PODVector<T> &vd)
+	{
+		BoundingBox ret;
+		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+			ret.Merge(vd[ii].position);
+
+		return ret;
+	}
+
+	class XZplaneIterator{
+	public:
+		virtual unsigned iter(unsigned i) const = 0;
+		virtual ~XZplaneIterator() = default;
+	};
+
+	class TopBottomPlane : public XZplaneIterator
+	{
+	public:
+		TopBottomPlane(unsigned start_offset, const IntVector3 &Segment)
+			: XZplaneIterator(), off(start_offset), seg(Segment)
+		{}
+		unsigned iter(unsigned i) const override
+		{
+			if(i < seg.z_)
+			{
+				return off + i;
+			}
+			else if(i < seg.z_ + seg.x_)
+			{
+				unsigned xx = i - seg.z_;
+				return off + seg.z_ + xx * (seg.z_ + 1);
+			}
+			else if(i < seg.z_ + seg.x_ + seg.z_)
+			{
+				unsigned zz = seg.z_ + seg.x_ + seg.z_ - i;
+				return off + seg.x_ * (seg.z_ + 1) + zz;
+			}
+			else if(i < 2*seg.x_ + 2*seg.z_)
+			{
+				unsigned xx = 2*seg.x_ + 2*seg.z_ - i;
+				return off + xx * (seg.z_ + 1);
+			}
+			else if(i == 2*seg.x_ + 2*seg.z_)
+			{
+				return off;
+			}
+			else
+			{
+				URHO3D_LOGERROR("TopBottomPlane: exceed boundary");
+				return off;
+			}
+		}
+	private:
+		const unsigned off;
+		const IntVector3 seg;
+	};
+
+	class MiddlePlane : public XZplaneIterator
+	{
+	public:
+		MiddlePlane(unsigned start_offset, const IntVector3 &Segment)
+			: XZplaneIterator(), off(start_offset), seg(Segment)
+		{}
+		unsigned iter(unsigned i) const override
+		{
+			if(i < 2*seg.x_ + 2*seg.z_)
+			{
+				return off + i;
+			}
+			else if(i == 2*seg.x_ + 2*seg.z_)
+			{
+				return off;
+			}
+			else
+			{
+				URHO3D_LOGERROR("MiddlePlane: exceed boundary");
+				return off;
+			}
+		}
+	private:
+		const unsigned off;
+		const IntVector3 seg;
+	};
+
+	/*
+	quad:
+	i0			i1
+
+	i2			i3
+	*/
+	template <class I>
+	void buildQuadIndex(PODVector<I> &id, unsigned i0, unsigned i1, unsigned i2, unsigned i3, const bool bottom)
+	{
+		if (!bottom)
+		{		//CW
+			id.Push((I)i0); id.Push((I)i1); id.Push((I)i3);
+			id.Push((I)i0); id.Push((I)i3); id.Push((I)i2);
+		}
+		else
+		{		//CCW
+			id.Push((I)i0); id.Push((I)i3); id.Push((I)i1);
+			id.Push((I)i0); id.Push((I)i2); id.Push((I)i3);
+		}
+	}
+
+	template <class T, class I>
+	unsigned CreateCubeTopBottomPlane(PODVector<T> &vd, PODVector<I> &id, const Vector3 &Size, const IntVector3 &Segment, 
+		const bool bottom)
+	{
+		const unsigned vdStart = vd.Size();
+		const Vector3 half(Size / 2.0f);
+
+		for (unsigned xx = 0; xx < Segment.x_ + 1; ++xx)
+		{
+			for (unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
+			{
+				T data;
+				data.position = Vector3(-half.x_ + xx * Size.x_ / Segment.x_, bottom ? -half.y_ : half.y_, -half.z_ + zz * Size.z_ / Segment.z_);
+				vd.Push(data);
+			}
+		}
+
+		for (unsigned xx = 0; xx < Segment.x_; ++xx)
+		{
+			for (unsigned zz = 0; zz < Segment.z_; ++zz)
+			{
+				const unsigned i0 = vdStart + xx * (Segment.z_ + 1) + 1 + zz;
+				const unsigned i1 = vdStart + (xx + 1) * (Segment.z_ + 1) + 1 + zz;
+				const unsigned i2 = vdStart + xx * (Segment.z_ + 1) + zz;
+				const unsigned i3 = vdStart + (xx + 1) * (Segment.z_ + 1) + zz;
+				buildQuadIndex(id, i0, i1, i2, i3, bottom);
+			}
+		}
+
+		return vdStart;
+	}
+	
+	template <class T>
+	unsigned CreateMiddleXZVertices(PODVector<T> &vd, const Vector3 &Size, const IntVector3 &Segment, float y)
+	{
+		const unsigned vdStart = vd.Size();
+		const Vector3 half(Size / 2.0f);
+		for(unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
+		{
+			T data;
+			data.position = Vector3(-half.x_, y, -half.z_ + zz * (Size.z_ / Segment.z_));
+			vd.Push(data);
+		}
+		for(unsigned xx = 1; xx < Segment.x_; ++xx)
+		{
+			T data;
+			data.position = Vector3(-half.x_ + xx * (Size.x_ / Segment.x_), y, half.z_);
+			vd.Push(data);
+		}
+		for(unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
+		{
+			T data;
+			data.position = Vector3(half.x_, y, half.z_ - zz * (Size.z_ / Segment.z_));
+			vd.Push(data);
+		}
+		for(unsigned xx = 1; xx < Segment.x_; ++xx)
+		{
+			T data;
+			data.position = Vector3(half.x_ - xx * (Size.x_ / Segment.x_), y, -half.z_);
+			vd.Push(data);
+		}
+		return vdStart;
+	}
+
+	/*create cube without duplicated vertices*/
+	template <class T, class I>
+	void CreateCube(PODVector<T> &vd, PODVector<I> &id, const Vector3 &Size, const IntVector3 &Segment)
+	{
+		if (Segment.x_ <= 0 || Segment.y_ <= 0 || Segment.z_ <= 0 || Size.x_ <= 0.0f || Size.y_ <= 0.0f || Size.z_ <= 0.0f)
+		{
+			URHO3D_LOGERROR("CreateCube: size or segment cannot <= 0");
+			return;
+		}
+
+		const unsigned numVertices = (Segment.x_ + 1) * (Segment.y_ + 1) * 2 + (Segment.y_ + 1)*(Segment.z_ + 1) * 2 + (Segment.x_ + 1)*(Segment.z_ + 1) * 2
+			- 4 * (Segment.x_ - 1) - 4 * (Segment.y_ - 1) - 4 * (Segment.z_ - 1) - 8 * 2;
+		const unsigned numIndices = Segment.x_*Segment.y_ * 2 * 3 * 2 + Segment.y_*Segment.z_ * 2 * 3 * 2 + Segment.x_*Segment.z_ * 2 * 3 * 2;
+
+		if (!indicesFit<I>(numVertices))
+		{
+			URHO3D_LOGERROR("CreateCube: too many vertices for the index type");
+			vd.Clear();
+			id.Clear();
+			return;
+		}
+
+		vd.Clear();
+		vd.Reserve(numVertices);
+		id.Clear();
+		id.Reserve(numIndices);
+
+		/*bottom xz plane*/
+		const unsigned bottomOff = CreateCubeTopBottomPlane(vd, id, Size, Segment, true);
+		XZplaneIterator * lastPlane = new TopBottomPlane(bottomOff, Segment);
+		XZplaneIterator * newPlane = nullptr;
+		for(unsigned ii=0; ii<Segment.y_-1; ++ii)
+		{
+			const unsigned middleOff = CreateMiddleXZVertices(vd,Size, Segment, -Size.y_/2.0f + (ii+1)*(Size.y_/Segment.y_));
+			newPlane = new MiddlePlane(middleOff, Segment);
+			
+			for(unsigned jj=0; jj<Segment.x_*2 + Segment.z_*2; ++jj)
+			{
+				buildQuadIndex(id, newPlane->iter(jj+1), newPlane->iter(jj), lastPlane->iter(jj+1), lastPlane->iter(jj), false);
+			}
+			delete lastPlane;
+			lastPlane = newPlane;
+			newPlane = nullptr;
+		}
+		const unsigned topOff = CreateCubeTopBottomPlane(vd, id, Size, Segment, false);
+		newPlane = new TopBottomPlane(topOff, Segment);
+		for(unsigned jj=0; jj<Segment.x_*2 + Segment.z_*2; ++jj)
+		{
+			buildQuadIndex(id, newPlane->iter(jj+1), newPlane->iter(jj), lastPlane->iter(jj+1), lastPlane->iter(jj), false);
+		}
+		delete newPlane;
+		delete lastPlane;
+
+		if(vd.Size() != numVertices)
+		{
+			URHO3D_LOGERROR("numVertices calculation error");
+		}
+
+		if(id.Size() != numIndices)
+		{
+			URHO3D_LOGERROR("numIndices calculation error");
+		}
+	}
+
+	/*Create sphere without duplicated vertices, github.com/caosdoar/spheres*/
+	template <class T, class I>
+	void CreateSphere(PODVector<T> &vd, PODVector<I> &id, const float radius, const unsigned parallels_count, const unsigned meridians_count)
+	{
+		if (radius <= 0.0f || parallels_count < 3 || meridians_count < 3)
+		{
+			URHO3D_LOGERROR("CreateSphere: parameter error");
+			return;
+		}
+
+		const unsigned numVertices = 2 + (parallels_count-1) * meridians_count;
+		const unsigned numIndices = 2 * meridians_count * 3 + (parallels_count - 2) * meridians_count * 6;
+
+		if (!indicesFit<I>(numVertices))
+		{
+			URHO3D_LOGERROR("CreateSphere: too many vertices for the index type");
+			vd.Clear();
+			id.Clear();
+			return;
+		}
+
+		vd.Clear();
+		vd.Reserve(numVertices);
+		id.Clear();
+		id.Reserve(numIndices);
+		{
+			T north;
+			north.position = Vector3(0.0f, radius, 0.0f);
+			vd.Push(north);
+		}
+		for(unsigned j=0; j<parallels_count-1; ++j)
+		{
+			float const polar = 180.0f * float(j+1) / float(parallels_count);
+			float const sp = Sin(polar);
+			float const cp = Cos(polar);
+			for(unsigned i=0; i<meridians_count; ++i)
+			{
+				float const azimuth = 360.0f * float(i) / float(meridians_count);
+				float const sa = Sin(azimuth);
+				float const ca = Cos(azimuth);
+				float const x = sp * ca * radius;
+				float const y = cp * radius;
+				float const z = sp * sa * radius;
+				T point;
+				point.position = Vector3(x, y, z);
+				vd.Push(point);
+			}
+		}
+		{
+			T south;
+			south.position = Vector3(0.0f, -radius, 0.0f);
+			vd.Push(south);
+		}
+
+		for(unsigned i=0; i<meridians_count; ++i)
+		{
+			const I a = i + 1;
+			const I b = (i + 1) % meridians_count + 1;
+			id.Push(0);
+			id.Push(b);
+			id.Push(a);
+		}
+		for (unsigned  j = 0; j < parallels_count - 2; ++j)
+		{
+			const unsigned aStart = j * meridians_count + 1;
+			const unsigned bStart = (j + 1) * meridians_count + 1;
+			for (unsigned i = 0; i < meridians_count; ++i)
+			{
+				const I a = aStart + i;
+				const I a1 = aStart + (i + 1) % meridians_count;
+				const I b = bStart + i;
+				const I b1 = bStart + (i + 1) % meridians_count;
+				id.Push(a);
+				id.Push(a1);
+				id.Push(b1);
+				id.Push(a);
+				id.Push(b1);
+				id.Push(b);
+			}
+		}
+		for (unsigned i = 0; i < meridians_count; ++i)
+		{
+			const I a = i + meridians_count * (parallels_count - 2) + 1;
+			const I b = (i + 1) % meridians_count + meridians_count * (parallels_count - 2) + 1;
+			id.Push((I)(vd.Size()-1));
+			id.Push(a);
+			id.Push(b);
+		}	
+
+		if(vd.Size() != numVertices)
+		{
+			URHO3D_LOGERROR("numVertices calculation error");
+		}
+
+		if(id.Size() != numIndices)
+		{
+			URHO3D_LOGERROR("numIndices calculation error");
+		}	
+	}
+
+	/*largest icosphere frequency whose 10 * n * n + 2 vertices fit in the budget, at least 1*/
+	inline unsigned icosphereFrequency(unsigned vertexBudget)
+	{
+		unsigned n = 1;
+		while (10 * (n + 1) * (n + 1) + 2 <= vertexBudget)
+			++n;
+		return n;
+	}
+
+	/*largest cube segment count whose 6 * n * n + 2 vertices fit in the budget, at least 1*/
+	inline unsigned spherifiedCubeSegments(unsigned vertexBudget)
+	{
+		unsigned n = 1;
+		while (6 * (n + 1) * (n + 1) + 2 <= vertexBudget)
+			++n;
+		return n;
+	}
+
+	/*
+	Geodesic sphere without duplicated vertices: every icosahedron face is split into frequency^2 triangles and projected onto the sphere.
+	10 * frequency^2 + 2 vertices, triangles of near uniform area, valence 6 except the 12 icosahedron corners (5).
+	*/
+	template <class T, class I>
+	void CreateIcosphere(PODVector<T> &vd, PODVector<I> &id, const float radius, const unsigned frequency)
+	{
+		if (radius <= 0.0f || frequency < 1)
+		{
+			URHO3D_LOGERROR("CreateIcosphere: parameter error");
+			return;
+		}
+
+		const unsigned n = frequency;
+		const unsigned numVertices = 10 * n * n + 2;
+		const unsigned numIndices = 20 * n * n * 3;
+
+		if (!indicesFit<I>(numVertices))
+		{
+			URHO3D_LOGERROR("CreateIcosphere: too many vertices for the index type");
+			vd.Clear();
+			id.Clear();
+			return;
+		}
+
+		const float t = (1.0f + Sqrt(5.0f)) * 0.5f;
+		const Vector3 corners[12] = {
+			Vector3(-1.0f, t, 0.0f), Vector3(1.0f, t, 0.0f), Vector3(-1.0f, -t, 0.0f), Vector3(1.0f, -t, 0.0f),
+			Vector3(0.0f, -1.0f, t), Vector3(0.0f, 1.0f, t), Vector3(0.0f, -1.0f, -t), Vector3(0.0f, 1.0f, -t),
+			Vector3(t, 0.0f, -1.0f), Vector3(t, 0.0f, 1.0f), Vector3(-t, 0.0f, -1.0f), Vector3(-t, 0.0f, 1.0f)
+		};
+		static const unsigned faces[20][3] = {
+			{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+			{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+			{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+			{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+		};
+
+		vd.Clear();
+		vd.Reserve(numVertices);
+		id.Clear();
+		id.Reserve(numIndices);
+
+		for (unsigned ii = 0; ii < 12; ++ii)
+		{
+			T data;
+			data.position = corners[ii].Normalized() * radius;
+			vd.Push(data);
+		}
+
+		/*n - 1 vertices per icosahedron edge, stored from the lower to the higher corner index*/
+		unsigned edgeStart[12 * 12];
+		for (unsigned ii = 0; ii < 12 * 12; ++ii)
+			edgeStart[ii] = M_MAX_UNSIGNED;
+		for (unsigned ff = 0; ff < 20; ++ff)
+		{
+			for (unsigned ee = 0; ee < 3; ++ee)
+			{
+				const unsigned lo = Min(faces[ff][ee], faces[ff][(ee + 1) % 3]);
+				const unsigned hi = Max(faces[ff][ee], faces[ff][(ee + 1) % 3]);
+				if (edgeStart[lo * 12 + hi] != M_MAX_UNSIGNED)
+					continue;
+				edgeStart[lo * 12 + hi] = vd.Size();
+				for (unsigned kk = 1; kk < n; ++kk)
+				{
+					T data;
+					data.position = (corners[lo] + (corners[hi] - corners[lo]) * ((float)kk / n)).Normalized() * radius;
+					vd.Push(data);
+				}
+			}
+		}
+
+		/*face grid (i, j): corner a + i steps towards b + j steps towards c, i + j <= n*/
+		PODVector<unsigned> grid((n + 1) * (n + 1));
+		for (unsigned ff = 0; ff < 20; ++ff)
+		{
+			const unsigned a = faces[ff][0], b = faces[ff][1], c = faces[ff][2];
+			for (unsigned ii = 0; ii <= n; ++ii)
+			{
+				for (unsigned jj = 0; ii + jj <= n; ++jj)
+				{
+					unsigned from = a, to = b, step = ii;
+					if (ii == 0 && jj == 0)
+						step = 0;
+					else if (ii == n)
+						from = b, step = 0;
+					else if (jj == n)
+						from = c, step = 0;
+					else if (jj == 0)
+						from = a, to = b, step = ii;
+					else if (ii == 0)
+						from = a, to = c, step = jj;
+					else if (ii + jj == n)
+						from = b, to = c, step = jj;
+					else
+					{
+						T data;
+						data.position = (corners[a] + (corners[b] - corners[a]) * ((float)ii / n) + (corners[c] - corners[a]) * ((float)jj / n)).Normalized() * radius;
+						grid[ii * (n + 1) + jj] = vd.Size();
+						vd.Push(data);
+						continue;
+					}
+
+					if (step == 0)
+						grid[ii * (n + 1) + jj] = from;
+					else
+					{
+						const unsigned lo = Min(from, to);
+						const unsigned hi = Max(from, to);
+						grid[ii * (n + 1) + jj] = edgeStart[lo * 12 + hi] + (from == lo ? step : n - step) - 1;
+					}
+				}
+			}
+
+			for (unsigned ii = 0; ii < n; ++ii)
+			{
+				for (unsigned jj = 0; ii + jj < n; ++jj)
+				{
+					id.Push((I)grid[ii * (n + 1) + jj]);
+					id.Push((I)grid[(ii + 1) * (n + 1) + jj]);
+					id.Push((I)grid[ii * (n + 1) + jj + 1]);
+					if (ii + jj + 1 < n)
+					{
+						id.Push((I)grid[(ii + 1) * (n + 1) + jj]);
+						id.Push((I)grid[(ii + 1) * (n + 1) + jj + 1]);
+						id.Push((I)grid[ii * (n + 1) + jj + 1]);
+					}
+				}
+			}
+		}
+
+		if (vd.Size() != numVertices)
+		{
+			URHO3D_LOGERROR("numVertices calculation error");
+		}
+
+		if (id.Size() != numIndices)
+		{
+			URHO3D_LOGERROR("numIndices calculation error");
+		}
+	}
+
+	/*
+	Cube with segments x segments quads per face projected onto the sphere; 6 * segments^2 + 2 vertices.
+	Uses the mapping of mathproofs.blogspot.com/2005/07/mapping-cube-to-sphere.html, which keeps the quads far more even than normalizing.
+	*/
+	template <class T, class I>
+	void CreateSpherifiedCube(PODVector<T> &vd, PODVector<I> &id, const float radius, const unsigned segments)
+	{
+		CreateCube(vd, id, Vector3(2.0f, 2.0f, 2.0f), IntVector3(segments, segments, segments));
+		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+		{
+			const Vector3 p(vd[ii].position);
+			const float x2 = p.x_ * p.x_, y2 = p.y_ * p.y_, z2 = p.z_ * p.z_;
+			vd[ii].position = Vector3(p.x_ * Sqrt(Max(0.0f, 1.0f - y2 * 0.5f - z2 * 0.5f + y2 * z2 / 3.0f)),
+				p.y_ * Sqrt(Max(0.0f, 1.0f - z2 * 0.5f - x2 * 0.5f + z2 * x2 / 3.0f)),
+				p.z_ * Sqrt(Max(0.0f, 1.0f - x2 * 0.5f - y2 * 0.5f + x2 * y2 / 3.0f))) * radius;
+		}
+	}
+
+	/*project every vertex behind a plane onto it; planes are applied in order, one pass over the vertices*/
+	template <class T>
+	void cutByPlanes(PODVector<T> &vd, const PODVector<Plane> &planes)
+	{
+		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+		{
+			Vector3 p(vd[ii].position);
+			for (unsigned kk = 0; kk < planes.Size(); ++kk)
+			{
+				if (planes[kk].Distance(p) < 0.0f)
+					p = planes[kk].Project(p);
+			}
+			vd[ii].position = p;
+		}
+	}
+
+	template <class T>
+	Vector3 calculateCenter(const PODVector<T> &vd)
+	{
+		Vector3 ret(Vector3::ZERO);
+		const unsigned sz = vd.Size();
+
+		for(unsigned ii=0; ii<sz; ++ii)
+		{
+			ret += vd[ii].position;
+		}
+
+		ret /= sz;
+		return ret;
+	}
+
+	enum NormalWeighting
+	{
+		/*face normals weighted by triangle area, same as summing the un-normalized cross products*/
+		NW_AREA = 0,
+		/*face normals weighted by the corner angle at the vertex*/
+		NW_ANGLE
+	};
+
+	/*vertex -> triangle adjacency in CSR form; triangles of vertex v are triangles_[offsets_[v]] .. triangles_[offsets_[v+1]-1], in ascending order*/
+	struct VertexTriangleMap
+	{
+		PODVector<unsigned> offsets_;
+		PODVector<unsigned> triangles_;
+	};
+
+	/*true if the corner repeats an index already seen in the same triangle, so degenerate triangles are counted once per vertex*/
+	template <class I>
+	bool isRepeatedCorner(const PODVector<I> &id, unsigned tri, unsigned corner)
+	{
+		const I v = id[tri * 3 + corner];
+		for (unsigned kk = 0; kk < corner; ++kk)
+		{
+			if (id[tri * 3 + kk] == v)
+				return true;
+		}
+		return false;
+	}
+
+	template <class I>
+	void buildVertexTriangleMap(VertexTriangleMap &map, const PODVector<I> &id, unsigned numVertices)
+	{
+		const unsigned numTriangles = id.Size() / 3;
+		map.offsets_.Resize(numVertices + 1);
+		for (unsigned ii = 0; ii < numVertices + 1; ++ii)
+			map.offsets_[ii] = 0;
+
+		for (unsigned ii = 0; ii < numTriangles; ++ii)
+		{
+			for (unsigned kk = 0; kk < 3; ++kk)
+			{
+				if (!isRepeatedCorner(id, ii, kk))
+					map.offsets_[id[ii * 3 + kk] + 1] += 1;
+			}
+		}
+		for (unsigned ii = 0; ii < numVertices; ++ii)
+			map.offsets_[ii + 1] += map.offsets_[ii];
+
+		PODVector<unsigned> cursor(map.offsets_.Buffer(), numVertices);
+		map.triangles_.Resize(map.offsets_[numVertices]);
+		for (unsigned ii = 0; ii < numTriangles; ++ii)
+		{
+			for (unsigned kk = 0; kk < 3; ++kk)
+			{
+				if (!isRepeatedCorner(id, ii, kk))
+					map.triangles_[cursor[id[ii * 3 + kk]]++] = ii;
+			}
+		}
+	}
+
+	/*contribution of triangle tri to the normal of its corner-th vertex*/
+	template <class T, class I>
+	Vector3 triangleNormalContribution(const PODVector<T> &vd, const PODVector<I> &id, unsigned tri, unsigned corner, NormalWeighting weighting)
+	{
+		const Vector3 &p0 = vd[id[tri * 3]].position;
+		const Vector3 &p1 = vd[id[tri * 3 + 1]].position;
+		const Vector3 &p2 = vd[id[tri * 3 + 2]].position;
+		Vector3 triNormal((p1 - p0).CrossProduct(p2 - p0));
+		if (weighting == NW_AREA)
+			return triNormal;
+
+		const Vector3 &c = vd[id[tri * 3 + corner]].position;
+		const Vector3 e0(vd[id[tri * 3 + (corner + 1) % 3]].position - c);
+		const Vector3 e1(vd[id[tri * 3 + (corner + 2) % 3]].position - c);
+		const float lenSquared = e0.LengthSquared() * e1.LengthSquared();
+		if (lenSquared <= 0.0f || triNormal.LengthSquared() <= 0.0f)
+			return Vector3::ZERO;
+		const float angle = Acos(Clamp(e0.DotProduct(e1) / Sqrt(lenSquared), -1.0f, 1.0f));
+		return triNormal.Normalized() * angle;
+	}
+
+	/*single pass over the index buffer, scattering every triangle into its 3 vertices*/
+	template <class T, class I>
+	void calculateNormal(PODVector<T> &vd, const PODVector<I> &id, NormalWeighting weighting = NW_AREA)
+	{
+		if(id.Size() % 3)
+		{
+			URHO3D_LOGERROR("calculateNormal: size of index buffer mod 3 != 0");
+			return;
+		}
+		const unsigned numTriangles = id.Size() / 3;
+		const unsigned numVertices = vd.Size();
+
+		for (unsigned ii = 0; ii < numVertices; ++ii)
+			vd[ii].normal = Vector3::ZERO;
+
+		for (unsigned jj = 0; jj < numTriangles; ++jj)
+		{
+			for (unsigned kk = 0; kk < 3; ++kk)
+			{
+				if (!isRepeatedCorner(id, jj, kk))
+					vd[id[jj * 3 + kk]].normal += triangleNormalContribution(vd, id, jj, kk, weighting);
+			}
+		}
+
+		for (unsigned ii = 0; ii < numVertices; ++ii)
+			vd[ii].normal = vd[ii].normal.Normalized();
+	}
+
+	/*gather version; the map only depends on topology so it can be built once and reused after vertices move*/
+	template <class T, class I>
+	void calculateNormal(PODVector<T> &vd, const PODVector<I> &id, const VertexTriangleMap &map, NormalWeighting weighting = NW_AREA)
+	{
+		const unsigned numVertices = vd.Size();
+		if (map.offsets_.Size() != numVertices + 1)
+		{
+			URHO3D_LOGERROR("calculateNormal: vertex triangle map does not match vertex buffer");
+			return;
+		}
+
+		for (unsigned ii = 0; ii < numVertices; ++ii)
+		{
+			Vector3 n(Vector3::ZERO);
+			for (unsigned kk = map.offsets_[ii]; kk < map.offsets_[ii + 1]; ++kk)
+			{
+				const unsigned tri = map.triangles_[kk];
+				unsigned corner = 0;
+				while (id[tri * 3 + corner] != ii)
+					++corner;
+				n += triangleNormalContribution(vd, id, tri, corner, weighting);
+			}
+			vd[ii].normal = n.Normalized();
+		}
+	}
+
+	inline unsigned numCornersBehindPlane(const BoundingBox &bb, const Plane &p)
+	{
+		Vector3 bbCorners[8] = {
+			bb.min_,
+			bb.max_,
+			Vector3(bb.min_.x_, bb.min_.y_, bb.max_.z_),
+			Vector3(bb.min_.x_, bb.max_.y_,bb.min_.z_),
+			Vector3(bb.max_.x_, bb.min_.y_, bb.min_.z_),
+			Vector3(bb.max_.x_, bb.max_.y_, bb.min_.z_),
+			Vector3(bb.max_.x_, bb.min_.y_, bb.max_.z_),
+			Vector3(bb.min_.x_, bb.max_.y_, bb.max_.z_)
+		};
+		unsigned cnt = 0;
+
+		for (unsigned ii = 0; ii < 8; ++ii)
+		{
+			if (p.Distance(bbCorners[ii]) < 0.0f)
+			{
+				cnt += 1;
+			}
+		}
+		return cnt;
+	}
+
+	static const unsigned NUM_CORNER_CUTS = 8;
+	/*candidates drawn per plane and sweep, each costs 8 corner tests*/
+	static const unsigned MAX_CORNER_PLANE_TRIES = 64;
+	/*vertex passes spent on rejecting planes that would not cut anything*/
+	static const unsigned MAX_CORNER_CUT_SWEEPS = 4;
+
+	/*random plane through the octant of corner (bit 0: -x, bit 1: -z, bit 2: -y) facing the origin, with exactly one bounding box corner behind it*/
+	inline bool randomCornerPlane(const BoundingBox &bb, unsigned corner, AsteroidRandom &rng, Plane &plane)
+	{
+		const Vector3 pointMin((corner & 1) ? bb.min_.x_ : 0.0f, (corner & 4) ? bb.min_.y_ : 0.0f, (corner & 2) ? bb.min_.z_ : 0.0f);
+		const Vector3 pointMax((corner & 1) ? 0.0f : bb.max_.x_, (corner & 4) ? 0.0f : bb.max_.y_, (corner & 2) ? 0.0f : bb.max_.z_);
+		for (unsigned tries = 0; tries < MAX_CORNER_PLANE_TRIES; ++tries)
+		{
+			/*one draw per statement, argument evaluation order is unspecified*/
+			const float angleX = rng.Random(-30.0f, 30.0f);
+			const float angleY = rng.Random(-30.0f, 30.0f);
+			const float angleZ = rng.Random(-30.0f, 30.0f);
+			const float x = rng.Random(pointMin.x_, pointMax.x_);
+			const float y = rng.Random(pointMin.y_, pointMax.y_);
+			const float z = rng.Random(pointMin.z_, pointMax.z_);
+			const Quaternion q(angleX, angleY, angleZ);
+			const Vector3 point(x, y, z);
+			plane = Plane(-(q * point), point);
+			if (numCornersBehindPlane(bb, plane) == 1)
+				return true;
+		}
+		return false;
+	}
+
+	/*behind[kk] |= some vertex is behind planes[kk]*/
+	template <class T>
+	void markVerticesBehindPlanes(const PODVector<T> &vd, const Plane *planes, unsigned numPlanes, bool *behind)
+	{
+		unsigned numBehind = 0;
+		for (unsigned kk = 0; kk < numPlanes; ++kk)
+			numBehind += behind[kk] ? 1 : 0;
+		for (unsigned ii = 0; ii < vd.Size() && numBehind < numPlanes; ++ii)
+		{
+			for (unsigned kk = 0; kk < numPlanes; ++kk)
+			{
+				if (!behind[kk] && planes[kk].Distance(vd[ii].position) < 0.0f)
+				{
+					behind[kk] = true;
+					++numBehind;
+				}
+			}
+		}
+	}
+
+	/*
+	one cut plane per bounding box corner, each with at least one vertex behind it.
+	Candidates are checked against the corners only; every sweep then tests all pending candidates in a single vertex pass.
+	A corner that still has no valid plane after the try/sweep budget is not cut, which is what a plane without vertices behind it would do anyway.
+	*/
+	/*V is PODVector<T> or any vertex container with a markVerticesBehindPlanes overload*/
+	template <class V>
+	void randomCornerCuts(const V &vertices, const BoundingBox &bb, AsteroidRandom &rng, PODVector<Plane> &planes)
+	{
+		Plane accepted[NUM_CORNER_CUTS];
+		bool done[NUM_CORNER_CUTS];
+		bool valid[NUM_CORNER_CUTS];
+		for (unsigned ii = 0; ii < NUM_CORNER_CUTS; ++ii)
+		{
+			done[ii] = false;
+			valid[ii] = false;
+		}
+
+		for (unsigned sweep = 0; sweep < MAX_CORNER_CUT_SWEEPS; ++sweep)
+		{
+			Plane candidates[NUM_CORNER_CUTS];
+			unsigned corners[NUM_CORNER_CUTS];
+			unsigned numCandidates = 0;
+			for (unsigned ii = 0; ii < NUM_CORNER_CUTS; ++ii)
+			{
+				if (done[ii])
+					continue;
+				if (randomCornerPlane(bb, ii, rng, candidates[numCandidates]))
+					corners[numCandidates++] = ii;
+				else
+					done[ii] = true;
+			}
+			if (numCandidates == 0)
+				break;
+
+			bool behind[NUM_CORNER_CUTS] = { false };
+			markVerticesBehindPlanes(vertices, candidates, numCandidates, behind);
+
+			for (unsigned kk = 0; kk < numCandidates; ++kk)
+			{
+				if (behind[kk])
+				{
+					accepted[corners[kk]] = candidates[kk];
+					valid[corners[kk]] = true;
+					done[corners[kk]] = true;
+				}
+			}
+		}
+
+		planes.Clear();
+		for (unsigned ii = 0; ii < NUM_CORNER_CUTS; ++ii)
+		{
+			if (valid[ii])
+				planes.Push(accepted[ii]);
+		}
+	}
+}		/*namespace Urho3D*/
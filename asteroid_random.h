@@ -0,0 +1,83 @@
+#pragma once
+
+namespace Urho3D
+{
+	/*independent streams of one asteroid; each generation stage draws from its own stream
+	so the result does not depend on which stage runs first or on which thread*/
+	enum AsteroidRandomStream
+	{
+		ARS_SHAPE = 0,
+		ARS_SURFACE,
+		ARS_MATERIAL
+	};
+
+	/*
+	Seedable replacement of Urho3D::Random()/SetRandomSeed() without global state.
+	splitmix64: the state is a 64 bit counter, the output is a mix of it.
+	The same (seed, stream) always gives the same sequence.
+	*/
+	class AsteroidRandom
+	{
+	public:
+		explicit AsteroidRandom(unsigned long long seed, unsigned stream = 0)
+			: state_(Mix(seed + Mix(stream + GOLDEN_GAMMA)))
+		{
+		}
+
+		unsigned long long Next64()
+		{
+			state_ += GOLDEN_GAMMA;
+			return Mix(state_);
+		}
+
+		unsigned NextUInt()
+		{
+			return (unsigned)(Next64() >> 32);
+		}
+
+		/*seed for FastNoise*/
+		int NextSeed()
+		{
+			return (int)NextUInt();
+		}
+
+		/*[0, 1)*/
+		float Random()
+		{
+			return (NextUInt() >> 8) * (1.0f / 16777216.0f);
+		}
+
+		/*[0, range)*/
+		float Random(float range)
+		{
+			return Random() * range;
+		}
+
+		/*[min, max)*/
+		float Random(float min, float max)
+		{
+			return Random() * (max - min) + min;
+		}
+
+		/*[min, max) like Urho3D::Random(int, int)*/
+		int Random(int min, int max)
+		{
+			if (max <= min)
+				return min;
+			const unsigned long long range = (unsigned long long)((long long)max - min);
+			return (int)((long long)min + (long long)((NextUInt() * range) >> 32));
+		}
+
+	private:
+		static const unsigned long long GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+		static unsigned long long Mix(unsigned long long z)
+		{
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		unsigned long long state_;
+	};
+}		/*namespace Urho3D*/
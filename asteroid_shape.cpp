@@ -0,0 +1,433 @@
+#include "asteroid_shape.h"
+#include "FastNoise.h"
+#include "FastNoiseKernel.h"
+#include <Urho3D/Urho3DAll.h>
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace Urho3D
+{
+	struct shape_base_vertex
+	{
+		Vector3 position;
+	};
+
+#ifdef URHO3D_SSE
+	static inline float horizontalMin(__m128 v)
+	{
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(v);
+	}
+
+	static inline float horizontalMax(__m128 v)
+	{
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(v);
+	}
+
+	static inline float horizontalSum(__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(v);
+	}
+#endif
+
+	/*SSE loops handle the first simdEnd(size) elements, the scalar tail the rest*/
+	static inline unsigned simdEnd(unsigned size)
+	{
+#ifdef URHO3D_SSE
+		return size & ~3u;
+#else
+		return 0;
+#endif
+	}
+
+	static void scaleStream(PODVector<float> &s, float scale)
+	{
+		const unsigned size = s.Size();
+		const unsigned end = simdEnd(size);
+		float *p = s.Buffer();
+#ifdef URHO3D_SSE
+		const __m128 vScale = _mm_set1_ps(scale);
+		for (unsigned ii = 0; ii < end; ii += 4)
+			_mm_storeu_ps(p + ii, _mm_mul_ps(_mm_loadu_ps(p + ii), vScale));
+#endif
+		for (unsigned ii = end; ii < size; ++ii)
+			p[ii] *= scale;
+	}
+
+	static void streamRange(const PODVector<float> &s, float &min, float &max)
+	{
+		const unsigned size = s.Size();
+		const unsigned end = simdEnd(size);
+		const float *p = s.Buffer();
+		min = M_INFINITY;
+		max = -M_INFINITY;
+#ifdef URHO3D_SSE
+		if (end > 0)
+		{
+			__m128 vMin = _mm_loadu_ps(p);
+			__m128 vMax = vMin;
+			for (unsigned ii = 4; ii < end; ii += 4)
+			{
+				const __m128 v = _mm_loadu_ps(p + ii);
+				vMin = _mm_min_ps(vMin, v);
+				vMax = _mm_max_ps(vMax, v);
+			}
+			min = horizontalMin(vMin);
+			max = horizontalMax(vMax);
+		}
+#endif
+		for (unsigned ii = end; ii < size; ++ii)
+		{
+			min = Min(min, p[ii]);
+			max = Max(max, p[ii]);
+		}
+	}
+
+	static float streamSum(const PODVector<float> &s)
+	{
+		const unsigned size = s.Size();
+		const unsigned end = simdEnd(size);
+		const float *p = s.Buffer();
+		float sum = 0.0f;
+#ifdef URHO3D_SSE
+		__m128 vSum = _mm_setzero_ps();
+		for (unsigned ii = 0; ii < end; ii += 4)
+			vSum = _mm_add_ps(vSum, _mm_loadu_ps(p + ii));
+		sum = horizontalSum(vSum);
+#endif
+		for (unsigned ii = end; ii < size; ++ii)
+			sum += p[ii];
+		return sum;
+	}
+
+	void scaleStreams(VertexStreams &vs, const Vector3 &scale)
+	{
+		scaleStream(vs.px_, scale.x_);
+		scaleStream(vs.py_, scale.y_);
+		scaleStream(vs.pz_, scale.z_);
+	}
+
+	BoundingBox calculateBB(const VertexStreams &vs)
+	{
+		if (vs.Size() == 0)
+			return BoundingBox();
+
+		Vector3 min, max;
+		streamRange(vs.px_, min.x_, max.x_);
+		streamRange(vs.py_, min.y_, max.y_);
+		streamRange(vs.pz_, min.z_, max.z_);
+		return BoundingBox(min, max);
+	}
+
+	Vector3 calculateCenter(const VertexStreams &vs)
+	{
+		return Vector3(streamSum(vs.px_), streamSum(vs.py_), streamSum(vs.pz_)) / (float)vs.Size();
+	}
+
+	void markVerticesBehindPlanes(const VertexStreams &vs, const Plane *planes, unsigned numPlanes, bool *behind)
+	{
+		const unsigned size = vs.Size();
+		const unsigned end = simdEnd(size);
+		const float *px = vs.px_.Buffer();
+		const float *py = vs.py_.Buffer();
+		const float *pz = vs.pz_.Buffer();
+
+		for (unsigned kk = 0; kk < numPlanes; ++kk)
+		{
+			if (behind[kk])
+				continue;
+			const Plane &plane = planes[kk];
+			float minDistance = M_INFINITY;
+#ifdef URHO3D_SSE
+			const __m128 nx = _mm_set1_ps(plane.normal_.x_);
+			const __m128 ny = _mm_set1_ps(plane.normal_.y_);
+			const __m128 nz = _mm_set1_ps(plane.normal_.z_);
+			const __m128 d = _mm_set1_ps(plane.d_);
+			__m128 vMin = _mm_set1_ps(M_INFINITY);
+			for (unsigned ii = 0; ii < end; ii += 4)
+			{
+				/*same order of additions as Plane::Distance, so the scalar tail and the interleaved path round alike*/
+				__m128 dist = _mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(px + ii)), _mm_mul_ps(ny, _mm_loadu_ps(py + ii)));
+				dist = _mm_add_ps(_mm_add_ps(dist, _mm_mul_ps(nz, _mm_loadu_ps(pz + ii))), d);
+				vMin = _mm_min_ps(vMin, dist);
+			}
+			minDistance = horizontalMin(vMin);
+#endif
+			for (unsigned ii = end; ii < size; ++ii)
+				minDistance = Min(minDistance, plane.Distance(Vector3(px[ii], py[ii], pz[ii])));
+			behind[kk] = minDistance < 0.0f;
+		}
+	}
+
+	void cutByPlanes(VertexStreams &vs, const PODVector<Plane> &planes)
+	{
+		const unsigned size = vs.Size();
+		const unsigned end = simdEnd(size);
+		float *px = vs.px_.Buffer();
+		float *py = vs.py_.Buffer();
+		float *pz = vs.pz_.Buffer();
+
+#ifdef URHO3D_SSE
+		const __m128 zero = _mm_setzero_ps();
+		for (unsigned ii = 0; ii < end; ii += 4)
+		{
+			__m128 x = _mm_loadu_ps(px + ii);
+			__m128 y = _mm_loadu_ps(py + ii);
+			__m128 z = _mm_loadu_ps(pz + ii);
+			for (unsigned kk = 0; kk < planes.Size(); ++kk)
+			{
+				const __m128 nx = _mm_set1_ps(planes[kk].normal_.x_);
+				const __m128 ny = _mm_set1_ps(planes[kk].normal_.y_);
+				const __m128 nz = _mm_set1_ps(planes[kk].normal_.z_);
+				/*same order of additions as Plane::Distance*/
+				__m128 dist = _mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y));
+				dist = _mm_add_ps(_mm_add_ps(dist, _mm_mul_ps(nz, z)), _mm_set1_ps(planes[kk].d_));
+				/*Plane::Project only for the lanes behind the plane*/
+				dist = _mm_and_ps(dist, _mm_cmplt_ps(dist, zero));
+				x = _mm_sub_ps(x, _mm_mul_ps(nx, dist));
+				y = _mm_sub_ps(y, _mm_mul_ps(ny, dist));
+				z = _mm_sub_ps(z, _mm_mul_ps(nz, dist));
+			}
+			_mm_storeu_ps(px + ii, x);
+			_mm_storeu_ps(py + ii, y);
+			_mm_storeu_ps(pz + ii, z);
+		}
+#endif
+		for (unsigned ii = end; ii < size; ++ii)
+		{
+			Vector3 p(px[ii], py[ii], pz[ii]);
+			for (unsigned kk = 0; kk < planes.Size(); ++kk)
+			{
+				if (planes[kk].Distance(p) < 0.0f)
+					p = planes[kk].Project(p);
+			}
+			px[ii] = p.x_;
+			py[ii] = p.y_;
+			pz[ii] = p.z_;
+		}
+	}
+
+	void calculateNormal(VertexStreams &vs, const PODVector<unsigned> &id, const VertexTriangleMap &map)
+	{
+		const unsigned numVertices = vs.Size();
+		const unsigned numTriangles = id.Size() / 3;
+		if (map.offsets_.Size() != numVertices + 1)
+		{
+			URHO3D_LOGERROR("calculateNormal: vertex triangle map does not match vertex streams");
+			return;
+		}
+
+		PODVector<Vector3> faceNormals(numTriangles);
+		for (unsigned jj = 0; jj < numTriangles; ++jj)
+		{
+			const unsigned i0 = id[jj * 3], i1 = id[jj * 3 + 1], i2 = id[jj * 3 + 2];
+			const Vector3 p0(vs.px_[i0], vs.py_[i0], vs.pz_[i0]);
+			const Vector3 p1(vs.px_[i1], vs.py_[i1], vs.pz_[i1]);
+			const Vector3 p2(vs.px_[i2], vs.py_[i2], vs.pz_[i2]);
+			faceNormals[jj] = (p1 - p0).CrossProduct(p2 - p0);
+		}
+
+		for (unsigned ii = 0; ii < numVertices; ++ii)
+		{
+			Vector3 n(Vector3::ZERO);
+			for (unsigned kk = map.offsets_[ii]; kk < map.offsets_[ii + 1]; ++kk)
+				n += faceNormals[map.triangles_[kk]];
+			n.Normalize();
+			vs.nx_[ii] = n.x_;
+			vs.ny_[ii] = n.y_;
+			vs.nz_[ii] = n.z_;
+		}
+	}
+
+	void calculateRange(const PODVector<float> &values, float &min, float &max)
+	{
+		streamRange(values, min, max);
+	}
+
+	void displaceAlongNormals(VertexStreams &vs, const PODVector<float> &noise, float noiseMin, float noiseMax, float factor)
+	{
+		const unsigned size = vs.Size();
+		if (noise.Size() != size)
+		{
+			URHO3D_LOGERROR("displaceAlongNormals: noise does not match vertex streams");
+			return;
+		}
+
+		if (!(noiseMax > noiseMin))
+			return;
+		/*((noise - min) / (max - min) - 0.5) * factor == noise * scale + offset*/
+		const float scale = factor / (noiseMax - noiseMin);
+		const float offset = -noiseMin * scale - 0.5f * factor;
+
+		const unsigned end = simdEnd(size);
+		const float *d = noise.Buffer();
+		float *px = vs.px_.Buffer();
+		float *py = vs.py_.Buffer();
+		float *pz = vs.pz_.Buffer();
+		const float *nx = vs.nx_.Buffer();
+		const float *ny = vs.ny_.Buffer();
+		const float *nz = vs.nz_.Buffer();
+#ifdef URHO3D_SSE
+		const __m128 vScale = _mm_set1_ps(scale);
+		const __m128 vOffset = _mm_set1_ps(offset);
+		for (unsigned ii = 0; ii < end; ii += 4)
+		{
+			const __m128 disp = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(d + ii), vScale), vOffset);
+			_mm_storeu_ps(px + ii, _mm_add_ps(_mm_loadu_ps(px + ii), _mm_mul_ps(disp, _mm_loadu_ps(nx + ii))));
+			_mm_storeu_ps(py + ii, _mm_add_ps(_mm_loadu_ps(py + ii), _mm_mul_ps(disp, _mm_loadu_ps(ny + ii))));
+			_mm_storeu_ps(pz + ii, _mm_add_ps(_mm_loadu_ps(pz + ii), _mm_mul_ps(disp, _mm_loadu_ps(nz + ii))));
+		}
+#endif
+		for (unsigned ii = end; ii < size; ++ii)
+		{
+			const float disp = d[ii] * scale + offset;
+			px[ii] += disp * nx[ii];
+			py[ii] += disp * ny[ii];
+			pz[ii] += disp * nz[ii];
+		}
+	}
+
+	/*base mesh of a shape level, positions written to vs (normals zeroed) and optionally to basePositions*/
+	static void CreateBaseMesh(AsteroidBaseMesh base, unsigned detail, bool sphereBase, VertexStreams &vs, PODVector<unsigned> &id,
+		PODVector<Vector3> *basePositions)
+	{
+		PODVector<shape_base_vertex> vd;
+		id.Clear();
+		switch (base)
+		{
+		case ABM_ICOSPHERE:
+			CreateIcosphere(vd, id, 0.5f, icosphereFrequency(detail));
+			break;
+		case ABM_SPHERIFIED_CUBE:
+			CreateSpherifiedCube(vd, id, 0.5f, spherifiedCubeSegments(detail));
+			break;
+		default:
+			if (sphereBase)
+				CreateSphere(vd, id, 0.5f, detail / 2, detail);
+			else
+				CreateCube(vd, id, Vector3::ONE, IntVector3(detail, detail, detail));
+			break;
+		}
+		verticesToStreams(vd, vs);
+		if (basePositions != nullptr)
+		{
+			basePositions->Resize(vd.Size());
+			for (unsigned ii = 0; ii < vd.Size(); ++ii)
+				(*basePositions)[ii] = vd[ii].position;
+		}
+	}
+
+	/*the shape noise keeps the FastNoise defaults, 3 octaves of quintic FBM perlin, compiled in*/
+	typedef NoiseKernel<FastNoise::PerlinFractal, FastNoise::FBM, FastNoise::Quintic, 3> ShapeNoise;
+
+	/*perlin noise of the shape at every vertex position*/
+	static void sampleShapeNoise(const AsteroidShapeParams &params, const VertexStreams &vs, PODVector<float> &noise)
+	{
+		FastNoise perlin(params.noiseSeed_);
+		perlin.SetFrequency(params.noiseFrequency_);
+		noise.Resize(vs.Size());
+		/*the batch call takes the scaled positions, they are scaled a chunk at a time on the stack*/
+		const unsigned chunk = 256;
+		float px[chunk], py[chunk], pz[chunk];
+		for (unsigned first = 0; first < vs.Size(); first += chunk)
+		{
+			const unsigned count = Min(chunk, vs.Size() - first);
+			for (unsigned ii = 0; ii < count; ++ii)
+			{
+				px[ii] = vs.px_[first + ii] * params.noiseScale_;
+				py[ii] = vs.py_[first + ii] * params.noiseScale_;
+				pz[ii] = vs.pz_[first + ii] * params.noiseScale_;
+			}
+			ShapeNoise::GetBatch(perlin, px, py, pz, &noise[first], count);
+		}
+	}
+
+	void GenerateAsteroidShape(AsteroidBaseMesh base, unsigned detail, AsteroidRandom &rng, VertexStreams &vs, PODVector<unsigned> &id,
+		AsteroidShapeParams &params, PODVector<Vector3> *basePositions)
+	{
+		/*drawn for every base so the other parameters of a seed do not depend on it*/
+		params.sphereBase_ = rng.Random(1.0f) < 0.5f;
+		CreateBaseMesh(base, detail, params.sphereBase_, vs, id, basePositions);
+		if (vs.Size() == 0)
+			return;
+
+		/*topology never changes below, so the adjacency is shared by both normal passes*/
+		VertexTriangleMap adjacency;
+		buildVertexTriangleMap(adjacency, id, vs.Size());
+
+		/*random scale; one draw per statement, argument evaluation order is unspecified*/
+		const float scaleX = rng.Random(0.5f, 1.5f);
+		const float scaleY = rng.Random(0.5f, 1.5f);
+		const float scaleZ = rng.Random(0.5f, 1.5f);
+		params.scale_ = Vector3(scaleX, scaleY, scaleZ);
+		scaleStreams(vs, params.scale_);
+
+		/*random cut with plane, one per bounding box corner*/
+		randomCornerCuts(vs, calculateBB(vs), rng, params.cuts_);
+
+		/*displace with noise*/
+		params.noiseSeed_ = rng.NextSeed();
+		params.noiseFrequency_ = rng.Random(0.01f, 0.03f);
+		params.noiseScale_ = rng.Random(100.0f, 200.0f);
+		params.noiseFactor_ = rng.Random(0.05f, 0.2f);
+
+		cutByPlanes(vs, params.cuts_);
+		calculateNormal(vs, id, adjacency);
+		PODVector<float> noise;
+		sampleShapeNoise(params, vs, noise);
+		/*the displacement is normalized with the noise range of this level, coarser levels reuse it so they do not drift*/
+		calculateRange(noise, params.noiseMin_, params.noiseMax_);
+		displaceAlongNormals(vs, noise, params.noiseMin_, params.noiseMax_, params.noiseFactor_);
+		calculateNormal(vs, id, adjacency);
+	}
+
+	void GenerateAsteroidShapeLod(AsteroidBaseMesh base, unsigned detail, const AsteroidShapeParams &params, VertexStreams &vs, PODVector<unsigned> &id,
+		PODVector<Vector3> *basePositions)
+	{
+		CreateBaseMesh(base, detail, params.sphereBase_, vs, id, basePositions);
+		if (vs.Size() == 0)
+			return;
+
+		VertexTriangleMap adjacency;
+		buildVertexTriangleMap(adjacency, id, vs.Size());
+		scaleStreams(vs, params.scale_);
+		cutByPlanes(vs, params.cuts_);
+		calculateNormal(vs, id, adjacency);
+		PODVector<float> noise;
+		sampleShapeNoise(params, vs, noise);
+		displaceAlongNormals(vs, noise, params.noiseMin_, params.noiseMax_, params.noiseFactor_);
+		calculateNormal(vs, id, adjacency);
+	}
+
+	unsigned AsteroidLodDetail(AsteroidBaseMesh base, unsigned detail, unsigned level)
+	{
+		if (level == 0)
+			return detail;
+
+		unsigned n;
+		switch (base)
+		{
+		case ABM_ICOSPHERE:
+			n = icosphereFrequency(detail) >> level;
+			return n < 2 ? 0 : 10 * n * n + 2;
+		case ABM_SPHERIFIED_CUBE:
+			n = spherifiedCubeSegments(detail) >> level;
+			return n < 2 ? 0 : 6 * n * n + 2;
+		default:
+			/*the UV sphere needs at least 3 parallels*/
+			n = detail >> level;
+			return n < 6 ? 0 : n;
+		}
+	}
+
+	float AsteroidLodDistance(unsigned level)
+	{
+		return level == 0 ? 0.0f : ASTEROID_LOD_DISTANCE * (float)(1u << (level - 1));
+	}
+}		/*namespace Urho3D*/
@@ -0,0 +1,112 @@
+#pragma once
+#include "asteroid_mesh.h"
+#include "asteroid_random.h"
+
+namespace Urho3D
+{
+	enum AsteroidBaseMesh
+	{
+		/*UV sphere or flat cube picked by the seed; detail is the edge division*/
+		ABM_UV_SPHERE_OR_CUBE = 0,
+		/*geodesic icosphere; detail is the vertex budget*/
+		ABM_ICOSPHERE,
+		/*cube projected onto the sphere; detail is the vertex budget*/
+		ABM_SPHERIFIED_CUBE
+	};
+
+	/*
+	structure-of-arrays vertices used while the shape is generated.
+	The shape stages only touch positions and normals, so separate float streams keep every loop dense
+	and let it work on 4 vertices at a time with SSE; they are converted to the interleaved layout once at the end.
+	*/
+	struct VertexStreams
+	{
+		PODVector<float> px_, py_, pz_;
+		PODVector<float> nx_, ny_, nz_;
+
+		unsigned Size() const { return px_.Size(); }
+
+		void Resize(unsigned size)
+		{
+			px_.Resize(size);
+			py_.Resize(size);
+			pz_.Resize(size);
+			nx_.Resize(size);
+			ny_.Resize(size);
+			nz_.Resize(size);
+		}
+	};
+
+	/*positions only, normals are zeroed*/
+	template <class T>
+	void verticesToStreams(const PODVector<T> &vd, VertexStreams &vs)
+	{
+		vs.Resize(vd.Size());
+		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+		{
+			vs.px_[ii] = vd[ii].position.x_;
+			vs.py_[ii] = vd[ii].position.y_;
+			vs.pz_[ii] = vd[ii].position.z_;
+			vs.nx_[ii] = 0.0f;
+			vs.ny_[ii] = 0.0f;
+			vs.nz_[ii] = 0.0f;
+		}
+	}
+
+	/*positions and normals; other members of T are left as they are*/
+	template <class T>
+	void streamsToVertices(const VertexStreams &vs, PODVector<T> &vd)
+	{
+		vd.Resize(vs.Size());
+		for (unsigned ii = 0; ii < vs.Size(); ++ii)
+		{
+			vd[ii].position = Vector3(vs.px_[ii], vs.py_[ii], vs.pz_[ii]);
+			vd[ii].normal = Vector3(vs.nx_[ii], vs.ny_[ii], vs.nz_[ii]);
+		}
+	}
+
+	void scaleStreams(VertexStreams &vs, const Vector3 &scale);
+	BoundingBox calculateBB(const VertexStreams &vs);
+	Vector3 calculateCenter(const VertexStreams &vs);
+	void markVerticesBehindPlanes(const VertexStreams &vs, const Plane *planes, unsigned numPlanes, bool *behind);
+	void cutByPlanes(VertexStreams &vs, const PODVector<Plane> &planes);
+	/*area weighted; face normals are computed once, then gathered per vertex*/
+	void calculateNormal(VertexStreams &vs, const PODVector<unsigned> &id, const VertexTriangleMap &map);
+	void calculateRange(const PODVector<float> &values, float &min, float &max);
+	/*position += ((noise - noiseMin) / (noiseMax - noiseMin) - 0.5) * factor * normal*/
+	void displaceAlongNormals(VertexStreams &vs, const PODVector<float> &noise, float noiseMin, float noiseMax, float factor);
+
+	/*every random parameter of a shape, drawn once for the finest level and reused by the coarser LODs so they match it*/
+	struct AsteroidShapeParams
+	{
+		bool sphereBase_;
+		Vector3 scale_;
+		PODVector<Plane> cuts_;
+		int noiseSeed_;
+		float noiseFrequency_;
+		float noiseScale_;
+		float noiseFactor_;
+		float noiseMin_;
+		float noiseMax_;
+	};
+
+	/*at most this many levels, each with about a quarter of the vertices of the previous one*/
+	static const unsigned ASTEROID_MAX_LODS = 3;
+	/*LOD distance of level 1 for a model of unit scale, doubled for every further level as the edge length doubles*/
+	static const float ASTEROID_LOD_DISTANCE = 12.0f;
+
+	/*detail of LOD level `level`, 0 if the level would be too coarse to exist*/
+	unsigned AsteroidLodDetail(AsteroidBaseMesh base, unsigned detail, unsigned level);
+	/*value for Geometry::SetLodDistance() of level `level`*/
+	float AsteroidLodDistance(unsigned level);
+
+	/*
+	base mesh, random scale, corner cuts and noise displacement shared by both asteroid kinds; positions and normals are final on return.
+	basePositions (optional) receives the base mesh position of every vertex, which is the same parameterization for every level.
+	*/
+	void GenerateAsteroidShape(AsteroidBaseMesh base, unsigned detail, AsteroidRandom &rng, VertexStreams &vs, PODVector<unsigned> &id,
+		AsteroidShapeParams &params, PODVector<Vector3> *basePositions = nullptr);
+	/*coarser level of the shape described by params*/
+	void GenerateAsteroidShapeLod(AsteroidBaseMesh base, unsigned detail, const AsteroidShapeParams &params, VertexStreams &vs, PODVector<unsigned> &id,
+		PODVector<Vector3> *basePositions = nullptr);
+}		/*namespace Urho3D*/
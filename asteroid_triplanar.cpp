@@ -1,874 +1,320 @@
 #include <vector>
+#include <stdio.h>
 #include "uv_mapper.hpp"
-#include "FastNoise.h"
+#include "asteroid_mesh.h"
+#include "asteroid_shape.h"
+#include "asteroid_random.h"
+#include "asteroid_cache.h"
+#include "asteroid_heightmap.h"
 #include "asteroid_triplanar.h"
 #include <Urho3D/Urho3DAll.h>
 
-//uncomment this if u want to subdivide more
-//#define DETAIL_ASTEROID_MODEL		1
 namespace Urho3D
 {
-	struct asteroid_triplanar_vertex
+	static void CreateMeshData(AsteroidBaseMesh base, unsigned detail, AsteroidRandom &rng, asteroid_triplanar_mesh_data_ &mesh)
 	{
-		Vector3 position;
-		Vector3 normal;
-	};
-
-	#ifdef DETAIL_ASTEROID_MODEL
-	typedef unsigned IBtype;
-	#else
-	typedef unsigned short IBtype;
-	#endif
-
-	static BoundingBox calculateBB(const PODVector<asteroid_triplanar_vertex> &vd)
-	{
-		BoundingBox ret;
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
-			ret.Merge(vd[ii].position);
-
-		return ret;
-	}
-
-	class XZplaneIterator{
-	public:
-		virtual IBtype iter(unsigned i) const = 0;
-		virtual ~XZplaneIterator() = default;
-	};
-
-	class TopBottomPlane : public XZplaneIterator
-	{
-	public:
-		TopBottomPlane(IBtype start_offset, const IntVector3 &Segment)
-			: XZplaneIterator(), off(start_offset), seg(Segment)
-		{}
-		IBtype iter(unsigned i) const override
-		{
-			if(i < seg.z_)
-			{
-				return off + i;
-			}
-			else if(i < seg.z_ + seg.x_)
-			{
-				unsigned xx = i - seg.z_;
-				return off + seg.z_ + xx * (seg.z_ + 1);
-			}
-			else if(i < seg.z_ + seg.x_ + seg.z_)
-			{
-				unsigned zz = seg.z_ + seg.x_ + seg.z_ - i;
-				return off + seg.x_ * (seg.z_ + 1) + zz;
-			}
-			else if(i < 2*seg.x_ + 2*seg.z_)
-			{
-				unsigned xx = 2*seg.x_ + 2*seg.z_ - i;
-				return off + xx * (seg.z_ + 1);
-			}
-			else if(i == 2*seg.x_ + 2*seg.z_)
-			{
-				return off;
-			}
-			else
-			{
-				URHO3D_LOGERROR("TopBottomPlane: exceed boundary");
-				return off;
-			}
-		}
-	private:
-		const IBtype off;
-		const IntVector3 seg;
-	};
-
-	class MiddlePlane : public XZplaneIterator
-	{
-	public:
-		MiddlePlane(IBtype start_offset, const IntVector3 &Segment)
-			: XZplaneIterator(), off(start_offset), seg(Segment)
-		{}
-		IBtype iter(unsigned i) const override
-		{
-			if(i < 2*seg.x_ + 2*seg.z_)
-			{
-				return off + i;
-			}
-			else if(i == 2*seg.x_ + 2*seg.z_)
-			{
-				return off;
-			}
-			else
-			{
-				URHO3D_LOGERROR("MiddlePlane: exceed boundary");
-				return off;
-			}
-		}
-	private:
-		const IBtype off;
-		const IntVector3 seg;
-	};
-
-	/*
-	quad:
-	i0			i1
-
-	i2			i3
-	*/
-	static void buildQuadIndex(PODVector<IBtype> &id, IBtype i0, IBtype i1, IBtype i2, IBtype i3, const bool bottom)
-	{
-		if (!bottom)
-		{		//CW
-			id.Push(i0); id.Push(i1); id.Push(i3);
-			id.Push(i0); id.Push(i3); id.Push(i2);
-		}
-		else
-		{		//CCW
-			id.Push(i0); id.Push(i3); id.Push(i1);
-			id.Push(i0); id.Push(i2); id.Push(i3);
-		}
-	}
-
-	static IBtype CreateCubeTopBottomPlane(PODVector<asteroid_triplanar_vertex> &vd, PODVector<IBtype> &id, const Vector3 &Size, const IntVector3 &Segment, 
-		const bool bottom)
-	{
-		const unsigned vdStart = vd.Size();
-		const Vector3 half(Size / 2.0f);
-
-		for (unsigned xx = 0; xx < Segment.x_ + 1; ++xx)
-		{
-			for (unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
-			{
-				asteroid_triplanar_vertex data;
-				data.position = Vector3(-half.x_ + xx * Size.x_ / Segment.x_, bottom ? -half.y_ : half.y_, -half.z_ + zz * Size.z_ / Segment.z_);
-				vd.Push(data);
-			}
-		}
-
-		for (unsigned xx = 0; xx < Segment.x_; ++xx)
-		{
-			for (unsigned zz = 0; zz < Segment.z_; ++zz)
-			{
-				IBtype i0 = vdStart + xx * (Segment.z_ + 1) + 1 + zz;
-				IBtype i1 = vdStart + (xx + 1) * (Segment.z_ + 1) + 1 + zz;
-				IBtype i2 = vdStart + xx * (Segment.z_ + 1) + zz;
-				IBtype i3 = vdStart + (xx + 1) * (Segment.z_ + 1) + zz;
-				buildQuadIndex(id, i0, i1, i2, i3, bottom);
-			}
-		}
-
-		return vdStart;
-	}
-	
-	static IBtype CreateMiddleXZVertices(PODVector<asteroid_triplanar_vertex> &vd, const Vector3 &Size, const IntVector3 &Segment, float y)
-	{
-		const unsigned vdStart = vd.Size();
-		const Vector3 half(Size / 2.0f);
-		for(unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
-		{
-			asteroid_triplanar_vertex data;
-			data.position = Vector3(-half.x_, y, -half.z_ + zz * (Size.z_ / Segment.z_));
-			vd.Push(data);
-		}
-		for(unsigned xx = 1; xx < Segment.x_; ++xx)
-		{
-			asteroid_triplanar_vertex data;
-			data.position = Vector3(-half.x_ + xx * (Size.x_ / Segment.x_), y, half.z_);
-			vd.Push(data);
+		VertexStreams vs;
+		AsteroidShapeParams params;
+		mesh.lods_vd.Clear();
+		mesh.lods_id.Clear();
+		mesh.lods_vd.Resize(1);
+		mesh.lods_id.Resize(1);
+		PODVector<unsigned> id;
+		GenerateAsteroidShape(base, detail, rng, vs, id, params);
+		mesh.BB = calculateBB(vs);
+		streamsToVertices(vs, mesh.lods_vd[0]);
+		mesh.lods_id[0].Assign(id, vs.Size());
+
+		/*triplanar texturing needs no uv, coarser levels are just the same shape on a coarser base mesh*/
+		for (unsigned level = 1; level < ASTEROID_MAX_LODS; ++level)
+		{
+			const unsigned lodDetail = AsteroidLodDetail(base, detail, level);
+			if (lodDetail == 0)
+				break;
+
+			GenerateAsteroidShapeLod(base, lodDetail, params, vs, id);
+			if (vs.Size() == 0)
+				break;
+			mesh.lods_vd.Resize(level + 1);
+			mesh.lods_id.Resize(level + 1);
+			streamsToVertices(vs, mesh.lods_vd[level]);
+			mesh.lods_id[level].Assign(id, vs.Size());
 		}
-		for(unsigned zz = 0; zz < Segment.z_ + 1; ++zz)
-		{
-			asteroid_triplanar_vertex data;
-			data.position = Vector3(half.x_, y, half.z_ - zz * (Size.z_ / Segment.z_));
-			vd.Push(data);
-		}
-		for(unsigned xx = 1; xx < Segment.x_; ++xx)
-		{
-			asteroid_triplanar_vertex data;
-			data.position = Vector3(half.x_ - xx * (Size.x_ / Segment.x_), y, -half.z_);
-			vd.Push(data);
-		}
-		return vdStart;
 	}
 
-	/*create cube without duplicated vertices*/
-	static void CreateCube(PODVector<asteroid_triplanar_vertex> &vd, PODVector<IBtype> &id, const Vector3 &Size, const IntVector3 &Segment)
+	static Geometry * CreateGeometry(Context* ctx, const PODVector<asteroid_triplanar_vertex> &vd, const AsteroidIndices &id)
 	{
-		if (Segment.x_ <= 0 || Segment.y_ <= 0 || Segment.z_ <= 0 || Size.x_ <= 0.0f || Size.y_ <= 0.0f || Size.z_ <= 0.0f)
-		{
-			URHO3D_LOGERROR("CreateCube: size or segment cannot <= 0");
-			return;
-		}
-
-		const unsigned numVertices = (Segment.x_ + 1) * (Segment.y_ + 1) * 2 + (Segment.y_ + 1)*(Segment.z_ + 1) * 2 + (Segment.x_ + 1)*(Segment.z_ + 1) * 2
-			- 4 * (Segment.x_ - 1) - 4 * (Segment.y_ - 1) - 4 * (Segment.z_ - 1) - 8 * 2;
-		const unsigned numIndices = Segment.x_*Segment.y_ * 2 * 3 * 2 + Segment.y_*Segment.z_ * 2 * 3 * 2 + Segment.x_*Segment.z_ * 2 * 3 * 2;
-
-		#ifndef DETAIL_ASTEROID_MODEL
-		if (numVertices > 65535)
-		{
-			URHO3D_LOGERROR("CreateCube: index buffer need larger type; plz define DETAIL_ASTEROID_MODEL");
-			return;
-		}
-		#endif
-
-		vd.Clear();
-		vd.Reserve(numVertices);
-		id.Clear();
-		id.Reserve(numIndices);
-
-		/*bottom xz plane*/
-		IBtype bottomOff = CreateCubeTopBottomPlane(vd, id, Size, Segment, true);
-		XZplaneIterator * lastPlane = new TopBottomPlane(bottomOff, Segment);
-		XZplaneIterator * newPlane = nullptr;
-		for(unsigned ii=0; ii<Segment.y_-1; ++ii)
-		{
-			IBtype middleOff = CreateMiddleXZVertices(vd,Size, Segment, -Size.y_/2.0f + (ii+1)*(Size.y_/Segment.y_));
-			newPlane = new MiddlePlane(middleOff, Segment);
-			
-			for(unsigned jj=0; jj<Segment.x_*2 + Segment.z_*2; ++jj)
-			{
-				buildQuadIndex(id, newPlane->iter(jj+1), newPlane->iter(jj), lastPlane->iter(jj+1), lastPlane->iter(jj), false);
-			}
-			delete lastPlane;
-			lastPlane = newPlane;
-			newPlane = nullptr;
-		}
-		IBtype topOff = CreateCubeTopBottomPlane(vd, id, Size, Segment, false);
-		newPlane = new TopBottomPlane(topOff, Segment);
-		for(unsigned jj=0; jj<Segment.x_*2 + Segment.z_*2; ++jj)
-		{
-			buildQuadIndex(id, newPlane->iter(jj+1), newPlane->iter(jj), lastPlane->iter(jj+1), lastPlane->iter(jj), false);
-		}
-		delete newPlane;
-		delete lastPlane;
+		VertexBuffer * vb(new VertexBuffer(ctx));
+		IndexBuffer * ib(new IndexBuffer(ctx));
+		Geometry * geom(new Geometry(ctx));
+		vb->SetShadowed(true);
+		PODVector<VertexElement> elements;
+		elements.Push(VertexElement(TYPE_VECTOR3, SEM_POSITION));
+		elements.Push(VertexElement(TYPE_VECTOR3, SEM_NORMAL));
+		vb->SetSize(vd.Size(), elements);
+		vb->SetData(vd.Buffer());
 
-		if(vd.Size() != numVertices)
-		{
-			URHO3D_LOGERROR("numVertices calculation error");
-		}
+		ib->SetShadowed(true);
+		ib->SetSize(id.Size(), id.IsLarge());
+		ib->SetData(id.Data());
 
-		if(id.Size() != numIndices)
-		{
-			URHO3D_LOGERROR("numIndices calculation error");
-		}
+		geom->SetVertexBuffer(0, vb);
+		geom->SetIndexBuffer(ib);
+		geom->SetDrawRange(TRIANGLE_LIST, 0, id.Size());
+		return geom;
 	}
 
-	/*Create sphere without duplicated vertices, github.com/caosdoar/spheres*/
-	static void CreateSphere(PODVector<asteroid_triplanar_vertex> &vd, PODVector<IBtype> &id, const float radius, const unsigned parallels_count, const unsigned meridians_count)
+	static Model * CreateModel(Context* ctx, const asteroid_triplanar_mesh_data_ &mesh)
 	{
-		if (radius <= 0.0f || parallels_count < 3 || meridians_count < 3)
-		{
-			URHO3D_LOGERROR("CreateSphere: parameter error");
-			return;
-		}
-
-		const unsigned numVertices = 2 + (parallels_count-1) * meridians_count;
-		const unsigned numIndices = 2 * meridians_count * 3 + (parallels_count - 2) * meridians_count * 6;
-
-		#ifndef DETAIL_ASTEROID_MODEL
-		if (numVertices > 65535)
-		{
-			URHO3D_LOGERROR("CreateSphere: index buffer need larger type; plz define DETAIL_ASTEROID_MODEL");
-			return;
-		}
-		#endif
-
-		vd.Clear();
-		vd.Reserve(numVertices);
-		id.Clear();
-		id.Reserve(numIndices);
-		{
-			asteroid_triplanar_vertex north;
-			north.position = Vector3(0.0f, radius, 0.0f);
-			vd.Push(north);
-		}
-		for(unsigned j=0; j<parallels_count-1; ++j)
-		{
-			float const polar = 180.0f * float(j+1) / float(parallels_count);
-			float const sp = Sin(polar);
-			float const cp = Cos(polar);
-			for(unsigned i=0; i<meridians_count; ++i)
-			{
-				float const azimuth = 360.0f * float(i) / float(meridians_count);
-				float const sa = Sin(azimuth);
-				float const ca = Cos(azimuth);
-				float const x = sp * ca * radius;
-				float const y = cp * radius;
-				float const z = sp * sa * radius;
-				asteroid_triplanar_vertex point;
-				point.position = Vector3(x, y, z);
-				vd.Push(point);
-			}
-		}
-		{
-			asteroid_triplanar_vertex south;
-			south.position = Vector3(0.0f, -radius, 0.0f);
-			vd.Push(south);
-		}
-
-		for(unsigned i=0; i<meridians_count; ++i)
-		{
-			IBtype const a = i + 1;
-			IBtype const b = (i + 1) % meridians_count + 1;
-			id.Push(0);
-			id.Push(b);
-			id.Push(a);
-		}
-		for (unsigned  j = 0; j < parallels_count - 2; ++j)
-		{
-			IBtype aStart = j * meridians_count + 1;
-			IBtype bStart = (j + 1) * meridians_count + 1;
-			for (unsigned i = 0; i < meridians_count; ++i)
-			{
-				const IBtype a = aStart + i;
-				const IBtype a1 = aStart + (i + 1) % meridians_count;
-				const IBtype b = bStart + i;
-				const IBtype b1 = bStart + (i + 1) % meridians_count;
-				id.Push(a);
-				id.Push(a1);
-				id.Push(b1);
-				id.Push(a);
-				id.Push(b1);
-				id.Push(b);
-			}
-		}
-		for (unsigned i = 0; i < meridians_count; ++i)
-		{
-			IBtype const a = i + meridians_count * (parallels_count - 2) + 1;
-			IBtype const b = (i + 1) % meridians_count + meridians_count * (parallels_count - 2) + 1;
-			id.Push(vd.Size()-1);
-			id.Push(a);
-			id.Push(b);
-		}	
-
-		if(vd.Size() != numVertices)
+		Model * fromScratchModel(new Model(ctx));
+		fromScratchModel->SetNumGeometries(1);
+		fromScratchModel->SetNumGeometryLodLevels(0, mesh.lods_vd.Size());
+		for (unsigned lod = 0; lod < mesh.lods_vd.Size(); ++lod)
 		{
-			URHO3D_LOGERROR("numVertices calculation error");
+			Geometry * geom = CreateGeometry(ctx, mesh.lods_vd[lod], mesh.lods_id[lod]);
+			geom->SetLodDistance(AsteroidLodDistance(lod));
+			fromScratchModel->SetGeometry(0, lod, geom);
 		}
+		fromScratchModel->SetBoundingBox(mesh.BB);
 
-		if(id.Size() != numIndices)
-		{
-			URHO3D_LOGERROR("numIndices calculation error");
-		}	
-	}
-
-	static void cutByPlane(PODVector<asteroid_triplanar_vertex> &vd, const Plane &p)
-	{
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
-		{
-			if (p.Distance(vd[ii].position) < 0.0f)
-			{
-				vd[ii].position = p.Project(vd[ii].position);
-			}
-		}
+		return fromScratchModel;
 	}
 
-	static Vector3 calculateCenter(const PODVector<asteroid_triplanar_vertex> &vd)
-	{
-		Vector3 ret(Vector3::ZERO);
-		const unsigned sz = vd.Size();
-
-		for(unsigned ii=0; ii<sz; ++ii)
-		{
-			ret += vd[ii].position;
-		}
-
-		ret /= sz;
-		return ret;
-	}
+	/*crater count and radius of this asteroid kind*/
+	static const AsteroidCraterParams ASTEROID_CRATERS = { 5, 15, 10.0f, 40.0f };
 
-	static void calculateNormal(PODVector<asteroid_triplanar_vertex> &vd, const PODVector<IBtype> &id)
+	class AsteroidBlobJob_triplanar : public AsteroidJob
 	{
-		if(id.Size() % 3)
-		{
-			URHO3D_LOGERROR("calculateNormal: size of index buffer mod 3 != 0");
-			return;
-		}
-		const unsigned numTriangles = id.Size() / 3;
-		const unsigned numVertices = vd.Size();
-
-		for (unsigned ii = 0; ii < numVertices; ++ii)
+	public:
+		/*node null creates no Urho objects, data (may be null) gets the CPU side result instead*/
+		AsteroidBlobJob_triplanar(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths,
+			const String &cacheFile, AsteroidBlobData_triplanar * data)
+			: AsteroidJob(ctx), group_(node != nullptr ? node->CreateComponent<StaticModelGroup>() : nullptr), seed_(seed), textureSize_(textureSize), base_(base), detail_(detail),
+			diffusePaths_(diffusePaths), height_(MakeShared<Image>(ctx)), normal_(MakeShared<Image>(ctx)), texturesValid_(false), cached_(false),
+			cacheFile_(cacheFile), data_(data)
 		{
-			Vector3 n(Vector3::ZERO);
-			for (unsigned jj = 0; jj < numTriangles; ++jj)
-			{
-				bool found = false;
-				for(unsigned kk=0; kk<3; ++kk)
-				{
-					if(id[jj*3 + kk] == ii)
-					{
-						found = true;
-						break;
-					}
-				}
-
-				if(found)
-				{
-					Vector3 triNormal((vd[ id[jj*3+1] ].position - vd[ id[jj*3] ].position).CrossProduct(vd[ id[jj*3+2] ].position - vd[ id[jj*3] ].position));
-					n += triNormal;
-				}
-			}
-			
-			vd[ii].normal = n.Normalized();
 		}
-	}
 
-	static unsigned numVerticesBehindPlane(const PODVector<asteroid_triplanar_vertex> &vd, const Plane &p)
-	{
-		unsigned ret = 0;
-
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
+	protected:
+		enum
 		{
-			if (p.Distance(vd[ii].position) < 0.0f)
-				ret += 1;
-		}
-
-		return ret;
-	}
-
-	static unsigned numCornersBehindPlane(const BoundingBox &bb, const Plane &p)
-	{
-		Vector3 bbCorners[8] = {
-			bb.min_,
-			bb.max_,
-			Vector3(bb.min_.x_, bb.min_.y_, bb.max_.z_),
-			Vector3(bb.min_.x_, bb.max_.y_,bb.min_.z_),
-			Vector3(bb.max_.x_, bb.min_.y_, bb.min_.z_),
-			Vector3(bb.max_.x_, bb.max_.y_, bb.min_.z_),
-			Vector3(bb.max_.x_, bb.min_.y_, bb.max_.z_),
-			Vector3(bb.min_.x_, bb.max_.y_, bb.max_.z_)
+			STAGE_LOAD = 0,
+			STAGE_GENERATE,
+			STAGE_COMPOSE,
+			STAGE_STORE
 		};
-		unsigned cnt = 0;
 
-		for (unsigned ii = 0; ii < 8; ++ii)
+		unsigned GetNumTasks(unsigned stage) override
 		{
-			if (p.Distance(bbCorners[ii]) < 0.0f)
+			switch (stage)
 			{
-				cnt += 1;
+			case STAGE_LOAD:
+				return 1;
+			case STAGE_GENERATE:
+				/*mesh and textures do not depend on each other; the mesh and the noise of every height map band;
+				a cached asteroid has no tasks here, which ends the job*/
+				return cached_ ? 0 : 1 + GetNumHeightBands();
+			case STAGE_COMPOSE:
+				return cached_ ? 0 : GetNumHeightBands();
+			case STAGE_STORE:
+				return (!cached_ && texturesValid_) ? 1 : 0;
+			default:
+				return 0;
 			}
 		}
-		return cnt;
-	}
-
-	static Model * CreateMesh(Context* ctx, unsigned edge_division)
-	{
-		bool sphereBase = false;
-		if (Random(1.0f) < 0.5f)
-			sphereBase = true;
-		PODVector<asteroid_triplanar_vertex> vd;
-		PODVector<IBtype> id;
-		BoundingBox BB;
-		const IntVector3 segment(edge_division, edge_division, edge_division);
-		
-		if(sphereBase)
-			CreateSphere(vd, id, 0.5f, edge_division/2, edge_division);
-		else
-			CreateCube(vd, id, Vector3::ONE, segment);
-
-		/*random scale*/
-		Vector3 scale(Random(0.5f, 1.5f), Random(0.5f, 1.5f), Random(0.5f, 1.5f));
-		for (unsigned ii = 0; ii < vd.Size(); ++ii)
-		{
-			vd[ii].position *= scale;
-		}
 
-		/*random cut with plane*/
-		const unsigned numCutPlane = 8;
-		BB = calculateBB(vd);
-		const float plane_points_x_start[numCutPlane] = { 0, BB.min_.x_ , 0, BB.min_.x_, 0, BB.min_.x_ ,0, BB.min_.x_ };
-		const float plane_points_x_end[numCutPlane] = { BB.max_.x_, 0, BB.max_.x_ , 0, BB.max_.x_, 0, BB.max_.x_ , 0 };
-		const float plane_points_y_start[numCutPlane] = { 0, 0, 0, 0, BB.min_.y_ ,BB.min_.y_ ,BB.min_.y_ ,BB.min_.y_ };
-		const float plane_points_y_end[numCutPlane] = { BB.max_.y_, BB.max_.y_, BB.max_.y_, BB.max_.y_, 0, 0, 0, 0 };
-		const float plane_points_z_start[numCutPlane] = { 0, 0, BB.min_.z_, BB.min_.z_, 0, 0, BB.min_.z_, BB.min_.z_ };
-		const float plane_points_z_end[numCutPlane] = { BB.max_.z_, BB.max_.z_, 0, 0, BB.max_.z_, BB.max_.z_, 0, 0 };
-		for (unsigned ii = 0; ii < numCutPlane; ++ii)
+		void RunTask(unsigned stage, unsigned task) override
 		{
-			while (true)
+			if (stage == STAGE_LOAD)
 			{
-				Quaternion q(Random(-30.0f, 30.0f), Random(-30.0f, 30.0f), Random(-30.0f, 30.0f));
-				Vector3 plane_point(Random(plane_points_x_start[ii], plane_points_x_end[ii]), Random(plane_points_y_start[ii], plane_points_y_end[ii]),
-					Random(plane_points_z_start[ii], plane_points_z_end[ii]));
-				Plane plane(-(q * plane_point), plane_point);
-				if (numCornersBehindPlane(BB, plane) == 1 && numVerticesBehindPlane(vd, plane) > 0)
+				cached_ = LoadCache();
+				CountAsteroidCacheLookup(cached_);
+				if (!cached_)
 				{
-					cutByPlane(vd, plane);
-					break;
+					AsteroidRandom rng(seed_, ARS_SURFACE);
+					texturesValid_ = heightMap_.Begin(height_, normal_, textureSize_, rng, ASTEROID_CRATERS);
 				}
 			}
-		}
-		calculateNormal(vd, id);
-		Vector3 center = calculateCenter(vd);
-
-		/*displace with noise*/
-		{
-			PODVector<float> displacements;
-			displacements.Reserve(vd.Size());
-			FastNoise *perlin = new FastNoise(Random(0, M_MAX_UNSIGNED));
-			perlin->SetFrequency(Random(0.01f, 0.03f));
-			const float noiseScale = Random(100.0f, 200.0f);
-			const float noiseFactor = Random(0.05f, 0.2f);
-			float noiseMax = FLT_MIN, noiseMin = FLT_MAX;
-			for (unsigned ii = 0; ii < vd.Size(); ++ii)
-			{
-				Vector3 p(vd[ii].position * noiseScale);
-				float noise = perlin->GetPerlinFractal(p.x_, p.y_, p.z_);
-				if (noise > noiseMax)
-					noiseMax = noise;
-				if (noise < noiseMin)
-					noiseMin = noise;
-				displacements.Push(noise);
-			}
-			delete perlin;
-			//normalize to [-0.5, 0.5]
-			for (unsigned ii = 0; ii < displacements.Size(); ++ii)
+			else if (stage == STAGE_STORE)
 			{
-				displacements[ii] = (displacements[ii] - noiseMin) / (noiseMax - noiseMin) - 0.5f;
+				heightMap_.Clear();
+				StoreCache();
 			}
-			for (unsigned ii = 0; ii < vd.Size(); ++ii)
+			else if (stage == STAGE_COMPOSE)
 			{
-				//vd[ii].position = vd[ii].position + displacements[ii] * noiseFactor * (center - vd[ii].position).Normalized();
-				vd[ii].position = vd[ii].position + displacements[ii] * noiseFactor * vd[ii].normal;
+				heightMap_.RunComposeBand(task);
 			}
-		}
-
-		BB = calculateBB(vd);
-		calculateNormal(vd, id);
-		center = calculateCenter(vd);
-
-		VertexBuffer * vb(new VertexBuffer(ctx));
-		IndexBuffer * ib(new IndexBuffer(ctx));
-		Geometry * geom(new Geometry(ctx));
-		vb->SetShadowed(true);
-		PODVector<VertexElement> elements;
-		elements.Push(VertexElement(TYPE_VECTOR3, SEM_POSITION));
-		elements.Push(VertexElement(TYPE_VECTOR3, SEM_NORMAL));
-		vb->SetSize(vd.Size(), elements);
-		vb->SetData(vd.Buffer());
-
-		ib->SetShadowed(true);
-		#ifdef DETAIL_ASTEROID_MODEL
-		bool largeIndices = true;
-		#else
-		bool largeIndices = false;
-		#endif
-		ib->SetSize(id.Size(), largeIndices);
-		ib->SetData(id.Buffer());
-
-		geom->SetVertexBuffer(0, vb);
-		geom->SetIndexBuffer(ib);
-		geom->SetDrawRange(TRIANGLE_LIST, 0, id.Size());
-		
-		Model * fromScratchModel(new Model(ctx));
-		fromScratchModel->SetNumGeometries(1);
-		fromScratchModel->SetGeometry(0, 0, geom);
-		fromScratchModel->SetBoundingBox(BB);
-
-		return fromScratchModel;
-	}
-
-	// github.com/cpetry/NormalMap-Online
-	static Image * CalculateNormalMapFromHeight(Context* ctx, const Image * heightMap)
-	{
-		const int w = heightMap->GetWidth();
-		const int h = heightMap->GetHeight();
-
-		Image * ret = new Image(ctx);
-		if (ret->SetSize(w, h, 4) == false)
-		{
-			URHO3D_LOGERROR("CalculateNormalMapFromHeight: Image::SetSize fail");
-			delete ret;
-			return nullptr;
-		}
-
-		const float Strength = 2.5f;
-		const float Level = 7.0f;
-
-		const int type = 0;
-		//webgl setting default is [1,1,-1]
-		const float invertR = 1.0f;		//-1 or 1
-		const float invertG = 1.0f;		//-1 or 1
-		const float invertH = -1.0f;		//-1 or 1
-		Vector2 step(-1.0f / w, -1.0f / h);
-		float dz = (1.0f / Strength) * (1.0f + Pow(2.0f, Level));
-		for (int x = 0; x < w; ++x)
-		{
-			for (int y = 0; y < h; ++y)
+			else if (task == 0)
 			{
-				Vector2 vUv((float)x/w, (float)y/h);
-				Vector2 tlv = Vector2(vUv.x_ - step.x_, vUv.y_ + step.y_);
-				Vector2 lv = Vector2(vUv.x_ - step.x_, vUv.y_);
-				Vector2 blv = Vector2(vUv.x_ - step.x_, vUv.y_ - step.y_);
-				Vector2 tv = Vector2(vUv.x_, vUv.y_ + step.y_);
-				Vector2 bv = Vector2(vUv.x_, vUv.y_ - step.y_);
-				Vector2 trv = Vector2(vUv.x_ + step.x_, vUv.y_ + step.y_);
-				Vector2 rv = Vector2(vUv.x_ + step.x_, vUv.y_);
-				Vector2 brv = Vector2(vUv.x_ + step.x_, vUv.y_ - step.y_);
-				tlv = Vector2(tlv.x_ >= 0.0 ? tlv.x_ : (1.0f + tlv.x_), tlv.y_ >= 0.0f ? tlv.y_ : (1.0f + tlv.y_));
-				tlv = Vector2(tlv.x_ < 1.0f ? tlv.x_ : (tlv.x_ - 1.0f), tlv.y_ < 1.0f ? tlv.y_ : (tlv.y_ - 1.0f));
-				lv = Vector2(lv.x_ >= 0.0f ? lv.x_ : (1.0f + lv.x_), lv.y_ >= 0.0f ? lv.y_ : (1.0f + lv.y_));
-				lv = Vector2(lv.x_ < 1.0f ? lv.x_ : (lv.x_ - 1.0f), lv.y_ < 1.0f ? lv.y_ : (lv.y_ - 1.0f));
-				blv = Vector2(blv.x_ >= 0.0f ? blv.x_ : (1.0f + blv.x_), blv.y_ >= 0.0f ? blv.y_ : (1.0f + blv.y_));
-				blv = Vector2(blv.x_ < 1.0f ? blv.x_ : (blv.x_ - 1.0f), blv.y_ < 1.0f ? blv.y_ : (blv.y_ - 1.0f));
-				tv = Vector2(tv.x_ >= 0.0f ? tv.x_ : (1.0f + tv.x_), tv.y_ >= 0.0f ? tv.y_ : (1.0f + tv.y_));
-				tv = Vector2(tv.x_ < 1.0f ? tv.x_ : (tv.x_ - 1.0f), tv.y_ < 1.0f ? tv.y_ : (tv.y_ - 1.0f));
-				bv = Vector2(bv.x_ >= 0.0f ? bv.x_ : (1.0f + bv.x_), bv.y_ >= 0.0f ? bv.y_ : (1.0f + bv.y_));
-				bv = Vector2(bv.x_ < 1.0f ? bv.x_ : (bv.x_ - 1.0f), bv.y_ < 1.0f ? bv.y_ : (bv.y_ - 1.0f));
-				trv = Vector2(trv.x_ >= 0.0f ? trv.x_ : (1.0f + trv.x_), trv.y_ >= 0.0f ? trv.y_ : (1.0f + trv.y_));
-				trv = Vector2(trv.x_ < 1.0f ? trv.x_ : (trv.x_ - 1.0f), trv.y_ < 1.0f ? trv.y_ : (trv.y_ - 1.0f));
-				rv = Vector2(rv.x_ >= 0.0f ? rv.x_ : (1.0f + rv.x_), rv.y_ >= 0.0f ? rv.y_ : (1.0f + rv.y_));
-				rv = Vector2(rv.x_ < 1.0f ? rv.x_ : (rv.x_ - 1.0f), rv.y_ < 1.0f ? rv.y_ : (rv.y_ - 1.0f));
-				brv = Vector2(brv.x_ >= 0.0f ? brv.x_ : (1.0f + brv.x_), brv.y_ >= 0.0f ? brv.y_ : (1.0f + brv.y_));
-				brv = Vector2(brv.x_ < 1.0f ? brv.x_ : (brv.x_ - 1.0f), brv.y_ < 1.0f ? brv.y_ : (brv.y_ - 1.0f));
-
-				float tl = Abs(heightMap->GetPixelBilinear(tlv.x_, tlv.y_).r_);
-				float l = Abs(heightMap->GetPixelBilinear(lv.x_, lv.y_).r_);
-				float bl = Abs(heightMap->GetPixelBilinear(blv.x_, blv.y_).r_);
-				float t = Abs(heightMap->GetPixelBilinear(tv.x_, tv.y_).r_);
-				float b = Abs(heightMap->GetPixelBilinear(bv.x_, bv.y_).r_);
-				float tr = Abs(heightMap->GetPixelBilinear(trv.x_, trv.y_).r_);
-				float r = Abs(heightMap->GetPixelBilinear(rv.x_, rv.y_).r_);
-				float br = Abs(heightMap->GetPixelBilinear(brv.x_, brv.y_).r_);
-				
-				float dx = 0.0f, dy = 0.0f;
-				if (type == 0) {	// Sobel
-					dx = tl + l * 2.0 + bl - tr - r * 2.0 - br;
-					dy = tl + t * 2.0 + tr - bl - b * 2.0 - br;
-				}
-				else {				// Scharr
-					dx = tl * 3.0 + l * 10.0 + bl * 3.0 - tr * 3.0 - r * 10.0 - br * 3.0;
-					dy = tl * 3.0 + t * 10.0 + tr * 3.0 - bl * 3.0 - b * 10.0 - br * 3.0;
-				}
-				Vector4 normal(Vector3(dx * invertR * invertH * 255.0f, dy * invertG * invertH * 255.0f, dz).Normalized(), heightMap->GetPixelBilinear(vUv.x_, vUv.y_).a_);
-				Color gl_FragColor(normal.x_ * 0.5f + 0.5f, normal.y_ * 0.5f + 0.5f, normal.z_, normal.w_);
-				ret->SetPixel(x, y, gl_FragColor);
+				AsteroidRandom rng(seed_, ARS_SHAPE);
+				CreateMeshData(base_, detail_, rng, mesh_);
 			}
-		}
-
-		return ret;
-	}
-
-	static Image * CreateCraterHeightMap(Context* ctx, int size)
-	{
-		Image * ret = new Image(ctx);
-		if (ret->SetSize(size, size, 1) == false)
-		{
-			URHO3D_LOGERROR("CreateCraterHeightMap: Image::SetSize fail");
-			return nullptr;
-		}
-
-		for (unsigned x = 0; x < size; ++x)
-		{
-			for (unsigned y = 0; y < size; ++y)
+			else
 			{
-				ret->SetPixel(x, y, Color(0.5f, 0.5f, 0.5f, 0.5f));
+				heightMap_.RunNoiseBand(task - 1);
 			}
 		}
 
-		/*topography height; need to be tile-able 
-		www.gamedev.net/blogs/entry/2138456-seamless-noise/
-		*/
-		FastNoise *simplex = new FastNoise(Random(0, M_MAX_UNSIGNED));
-		simplex->SetFrequency(0.02f);
-		float **topography = new float *[size];
-		for (unsigned ii = 0; ii < size; ++ii)
-			topography[ii] = new float[size];
-
-		float max = FLT_MIN, min = FLT_MAX;
-		const float x1 = Random(500.0f);
-		const float y1 = Random(500.0f);
-		const float x2 = x1 + Random(500.0f);
-		const float y2 = y1 + Random(500.0f);
-		for (unsigned x = 0; x < size; ++x)
+		void Finalize() override
 		{
-			for (unsigned y = 0; y < size; ++y)
+			if (data_ != nullptr)
 			{
-				const float dx = x2 - x1;
-				const float dy = y2 - y1;
-				float s = (float)x / size;
-				float t = (float)y / size;
-				float nx = x1 + Cos(s * 360.0f)*dx / (2 * M_PI);
-				float ny = y1 + Cos(t * 360.0f)*dy / (2 * M_PI);
-				float nz = x1 + Sin(s * 360.0f)*dx / (2 * M_PI);
-				float nw = y1 + Sin(t * 360.0f)*dy / (2 * M_PI);
-#if 1
-				const unsigned octaves = 5;
-				const float lacunarity = 2.0f;
-				const float gain = 0.5f;
-				float amp = 1.0f;
-				float fbmSum = simplex->GetSimplex(nx, ny, nz, nw);
-				for (unsigned ii = 0; ii < octaves; ++ii)
-				{
-					nx *= lacunarity;
-					ny *= lacunarity;
-					nz *= lacunarity;
-					nw *= lacunarity;
-					amp *= gain;
-					fbmSum += simplex->GetSimplex(nx, ny, nz, nw) * amp;
-				}
-				topography[x][y] = fbmSum;
-#else
-				topography[x][y] = simplex->GetSimplex(nx, ny, nz, nw);
-#endif
-				if (topography[x][y] > max)
-					max = topography[x][y];
-				if (topography[x][y] < min)
-					min = topography[x][y];
+				data_->mesh_ = mesh_;
+				data_->height_ = height_;
+				data_->normal_ = normal_;
+				data_->texturesValid_ = texturesValid_;
+				data_->cached_ = cached_;
 			}
-		}
-		delete simplex;
-		/*normalize to [-0.5, 0.5]*/
-		for (unsigned x = 0; x < size; ++x)
-		{
-			for (unsigned y = 0; y < size; ++y)
+			if (group_ == nullptr)
+				return;
+			group_->SetModel(CreateModel(context_, mesh_));
+
+			char log[128];
+			snprintf(log, sizeof(log), "asteroid %016llx %s (cache hits %u, misses %u)", seed_, cached_ ? "loaded from cache" : "generated",
+				GetAsteroidCacheHits(), GetAsteroidCacheMisses());
+			URHO3D_LOGINFO(log);
+			if (!texturesValid_)
+				return;
+
+			if (!cached_)
 			{
-				topography[x][y] = (topography[x][y] - min) / (max - min) - 0.5f;
+				height_->SaveBMP("height_triplanar.bmp");
+				normal_->SavePNG("normal_triplanar.png");
 			}
-		}
 
-		const float topographyFactor = 0.3f;
-		for (int x = 0; x < size; ++x)
-		{
-			for (int y = 0; y < size; ++y)
+			ResourceCache * cache = context_->GetSubsystem<ResourceCache>();
+			AsteroidRandom rng(seed_, ARS_MATERIAL);
+			SharedPtr <Texture2D> diffTex(cache->GetResource<Texture2D>(diffusePaths_[rng.Random(0, diffusePaths_.Size())]));
+			if (diffTex == nullptr)
 			{
-				Color c = ret->GetPixel(x, y);
-				float h = (topography[x][y] - 0.5f) * topographyFactor;
-				Color r(h, h, h, h);
-				c += r;
-				ret->SetPixel(x, y, c);
+				URHO3D_LOGERROR(String("diffTex->LoadFile fail"));
+				return;
 			}
-		}
-
-		for (unsigned ii = 0; ii < size; ++ii)
-			delete[] topography[ii];
-		delete[] topography;
-
-		const unsigned numCraters = Random(5, 15);
-		for (unsigned ii = 0; ii < numCraters; ++ii)
-		{
-			int centerX = Random(0, size - 1);
-			int centerY = Random(0, size - 1);
-			float radius = Random(10.0f, 40.0f);
 
-			while (centerX < radius || centerX + radius > size || centerY < radius || centerY + radius > size)
+#if 1
+			SharedPtr <Texture2D> normalMap(MakeShared<Texture2D>(context_));
+			normalMap->SetNumLevels(1);
+			if (normalMap->SetSize(textureSize_, textureSize_, Graphics::GetRGBAFormat(), TEXTURE_DYNAMIC) == false)
 			{
-				centerX = Random(0, size - 1);
-				centerY = Random(0, size - 1);
-				radius = Random(10.0f, 40.0f);
+				URHO3D_LOGERROR(String("normalMap->SetSize fail"));
+				return;
 			}
-
-			for (int x = 0; x < size; ++x)
+			normalMap->SetData(normal_, true);
+#else
+			SharedPtr <Texture2D> normalMap(cache->GetResource<Texture2D>("Textures/NormalMap.png"));
+			if (diffTex == nullptr)
 			{
-				for (int y = 0; y < size; ++y)
-				{
-					int sqrX = (x - centerX) * (x - centerX);
-					int sqrY = (y - centerY) * (y - centerY);
-					const float ring = 4;
-					if (sqrX + sqrY <= radius * radius)
-					{
-						float cosTheta = Sqrt((float)sqrX + sqrY) / radius;
-						float sinTheta = Sqrt(1.0f - cosTheta * cosTheta);
-						float deepness = sinTheta * 0.5f;		//radius * sinTheta * 0.5f / radius 
-						ret->SetPixel(x, y, Color(0.5f - deepness, 0.5f - deepness, 0.5f - deepness, 0.5f - deepness));
-					}
-				}
+				URHO3D_LOGERROR(String("normalMap->LoadFile fail"));
+				return;
 			}
-		}
+#endif
 
-		/*add shallow roughness*/
-		FastNoise *cell = new FastNoise(Random(0, M_MAX_UNSIGNED));
-		float **Layer = new float *[size];
-		for (unsigned ii = 0; ii < size; ++ii)
-			Layer[ii] = new float[size];
+			Material * m = new Material(context_);
+			m->SetNumTechniques(2); 
+			m->SetTechnique(0, cache->GetResource<Technique>("Techniques/DiffNormalTriplanar.xml"), QUALITY_MEDIUM);
+			m->SetTechnique(1, cache->GetResource<Technique>("Techniques/DiffTriplanar.xml"), QUALITY_LOW);
+			m->SetTexture(TU_DIFFUSE, diffTex);
+			m->SetTexture(TU_NORMAL, normalMap);
+			m->SetShaderParameter("MatSpecColor", Vector4(0.3f, 0.3f, 0.3f, 16.0f));
 
-		max = FLT_MIN, min = FLT_MAX;
-		for (unsigned x = 0; x < size; ++x)
-		{
-			for (unsigned y = 0; y < size; ++y)
+			group_->SetMaterial(m);
+		}
+
+	private:
+		bool LoadCache()
+		{
+			SharedPtr<File> file(OpenAsteroidCache(context_, cacheFile_));
+			if (file == nullptr)
+				return false;
+
+			asteroid_triplanar_mesh_data_ cached;
+			cached.BB = file->ReadBoundingBox();
+			const unsigned numLods = file->ReadUInt();
+			if (numLods == 0 || numLods > ASTEROID_MAX_LODS)
+				return false;
+			cached.lods_vd.Resize(numLods);
+			cached.lods_id.Resize(numLods);
+			for (unsigned lod = 0; lod < numLods; ++lod)
 			{
-				Layer[x][y] = cell->GetWhiteNoise(x, y);
-				if (Layer[x][y] > max)
-					max = Layer[x][y];
-				if (Layer[x][y] < min)
-					min = Layer[x][y];
+				if (!ReadCachedArray(*file, cached.lods_vd[lod]) || !ReadCachedIndices(*file, cached.lods_id[lod], cached.lods_vd[lod].Size()))
+					return false;
 			}
+			/*the normal map of CreateCraterHeightMap, uploaded as textureSize_ RGBA*/
+			if (!ReadCachedImage(*file, normal_, textureSize_, textureSize_, 4))
+				return false;
+			mesh_ = cached;
+			texturesValid_ = true;
+			return true;
 		}
-		delete cell;
-		/*normalize to [-0.5, 0.5]*/
-		for (unsigned x = 0; x < size; ++x)
+
+		void StoreCache()
 		{
-			for (unsigned y = 0; y < size; ++y)
+			SharedPtr<File> file(CreateAsteroidCache(context_, cacheFile_));
+			if (file == nullptr)
+				return;
+
+			file->WriteBoundingBox(mesh_.BB);
+			file->WriteUInt(mesh_.lods_vd.Size());
+			for (unsigned lod = 0; lod < mesh_.lods_vd.Size(); ++lod)
 			{
-				Layer[x][y] = (Layer[x][y] - min) / (max - min) - 0.5f;
+				WriteCachedArray(*file, mesh_.lods_vd[lod]);
+				WriteCachedIndices(*file, mesh_.lods_id[lod]);
 			}
+			if (WriteCachedImage(*file, normal_))
+				CommitAsteroidCache(context_, file, cacheFile_);
+			else
+				DiscardAsteroidCache(context_, file);
 		}
 
-		const float roughnessFactor = 0.1f;
-		for (int x = 0; x < size; ++x)
+		/*0 once Begin() failed, nothing is left to compose then*/
+		unsigned GetNumHeightBands() const
 		{
-			for (int y = 0; y < size; ++y)
-			{
-				Color c = ret->GetPixel(x, y);
-				float rough = (Layer[x][y] - 0.5f) * roughnessFactor;
-				Color r(rough, rough, rough, rough);
-				c += r;
-				ret->SetPixel(x, y, c);
-			}
+			return texturesValid_ ? heightMap_.GetNumBands() : 0;
 		}
 
-		for (unsigned ii = 0; ii < size; ++ii)
-			delete[] Layer[ii];
-		delete[] Layer;
-		return  ret;
-	}
+		WeakPtr<StaticModelGroup> group_;
+		const unsigned long long seed_;
+		const unsigned textureSize_;
+		const AsteroidBaseMesh base_;
+		const unsigned detail_;
+		const Vector<String> diffusePaths_;
+		asteroid_triplanar_mesh_data_ mesh_;
+		AsteroidHeightMap heightMap_;
+		SharedPtr<Image> height_;
+		SharedPtr<Image> normal_;
+		bool texturesValid_;
+		bool cached_;
+		const String cacheFile_;
+		AsteroidBlobData_triplanar * data_;
+	};
 
-	void CreateAsteroidBlob_triplanar(Context* ctx, Node * node, unsigned textureSize, unsigned subdivision, const Vector<String> &diffusePaths)
+	void CreateAsteroidBlob_triplanar(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths)
 	{
-		StaticModelGroup * s = node->CreateComponent<StaticModelGroup>();
-		Model * model = CreateMesh(ctx, subdivision);
-		if (model != nullptr)
-			s->SetModel(model);
-
-		SharedPtr<Image> height(CreateCraterHeightMap(ctx, textureSize));
-		if (height == nullptr)
-			return;
-
-		SharedPtr<Image> normal(CalculateNormalMapFromHeight(ctx, height));
-		if (normal == nullptr)
-			return;
-
-		height->SaveBMP("height_triplanar.bmp");
-		normal->SavePNG("normal_triplanar.png");
-
-		ResourceCache * cache = ctx->GetSubsystem<ResourceCache>();
-		SharedPtr <Texture2D> diffTex(cache->GetResource<Texture2D>(diffusePaths[Random(0, diffusePaths.Size())]));
-		if (diffTex == nullptr)
-		{
-			URHO3D_LOGERROR(String("diffTex->LoadFile fail"));
-			return;
-		}
+		SharedPtr<AsteroidJob> job(new AsteroidBlobJob_triplanar(ctx, node, seed, textureSize, base, detail, diffusePaths,
+			GetAsteroidCacheFile(ctx, "triplanar", seed, base, detail, textureSize), nullptr));
+		job->Run();
+	}
 
-#if 1
-		SharedPtr <Texture2D> normalMap(MakeShared<Texture2D>(ctx));
-		normalMap->SetNumLevels(1);
-		if (normalMap->SetSize(textureSize, textureSize, Graphics::GetRGBAFormat(), TEXTURE_DYNAMIC) == false)
-		{
-			URHO3D_LOGERROR(String("normalMap->SetSize fail"));
-			return;
-		}
-		normalMap->SetData(normal, true);
-#else
-		SharedPtr <Texture2D> normalMap(cache->GetResource<Texture2D>("Textures/NormalMap.png"));
-		if (diffTex == nullptr)
-		{
-			URHO3D_LOGERROR(String("normalMap->LoadFile fail"));
-			return;
-		}
-#endif
+	SharedPtr<AsteroidJob> CreateAsteroidBlobAsync_triplanar(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths)
+	{
+		SharedPtr<AsteroidJob> job(new AsteroidBlobJob_triplanar(ctx, node, seed, textureSize, base, detail, diffusePaths,
+			GetAsteroidCacheFile(ctx, "triplanar", seed, base, detail, textureSize), nullptr));
+		job->StartAsync();
+		return job;
+	}
 
-		Material * m = new Material(ctx);
-		m->SetNumTechniques(2); 
-		m->SetTechnique(0, cache->GetResource<Technique>("Techniques/DiffNormalTriplanar.xml"), QUALITY_MEDIUM);
-		m->SetTechnique(1, cache->GetResource<Technique>("Techniques/DiffTriplanar.xml"), QUALITY_LOW);
-		m->SetTexture(TU_DIFFUSE, diffTex);
-		m->SetTexture(TU_NORMAL, normalMap);
-		m->SetShaderParameter("MatSpecColor", Vector4(0.3f, 0.3f, 0.3f, 16.0f));
+	void CreateAsteroidData_triplanar(Context* ctx, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const String &cacheFile,
+		AsteroidBlobData_triplanar &data)
+	{
+		SharedPtr<AsteroidJob> job(new AsteroidBlobJob_triplanar(ctx, nullptr, seed, textureSize, base, detail, Vector<String>(), cacheFile, &data));
+		job->Run();
+	}
 
-		s->SetMaterial(m);
+	SharedPtr<AsteroidJob> CreateAsteroidDataAsync_triplanar(Context* ctx, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const String &cacheFile,
+		AsteroidBlobData_triplanar &data)
+	{
+		SharedPtr<AsteroidJob> job(new AsteroidBlobJob_triplanar(ctx, nullptr, seed, textureSize, base, detail, Vector<String>(), cacheFile, &data));
+		job->StartAsync();
+		return job;
 	}
 }
@@ -1,8 +1,48 @@
 #pragma once
 #include <Urho3D/Scene/Node.h>
+#include "asteroid_job.h"
+#include "asteroid_mesh.h"
+#include "asteroid_shape.h"
 
 namespace Urho3D
 {
-	void CreateAsteroidBlob_triplanar(Context* ctx, Node * node, unsigned textureSize, unsigned subdivision, const Vector<String> &diffusePaths);
+	struct asteroid_triplanar_vertex
+	{
+		Vector3 position;
+		Vector3 normal;
+	};
+
+	/*lods_vd[0]/lods_id[0] is the finest level*/
+	struct asteroid_triplanar_mesh_data_
+	{
+		Vector< PODVector<asteroid_triplanar_vertex> > lods_vd;
+		Vector<AsteroidIndices> lods_id;
+		BoundingBox BB;
+	};
+
+	/*CPU side of a triplanar asteroid: what the cache stores, and the height map it was made from; height_ is empty when cached_*/
+	struct AsteroidBlobData_triplanar
+	{
+		asteroid_triplanar_mesh_data_ mesh_;
+		SharedPtr<Image> height_;
+		SharedPtr<Image> normal_;
+		bool texturesValid_;
+		bool cached_;
+	};
+
+	/*the same seed always gives the same asteroid; detail is the edge division for ABM_UV_SPHERE_OR_CUBE and the vertex budget otherwise*/
+	void CreateAsteroidBlob_triplanar(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths);
+	/*same as CreateAsteroidBlob_triplanar but the mesh and textures are generated on worker threads;
+	the StaticModelGroup is created immediately and gets its model/material when the job completes*/
+	SharedPtr<AsteroidJob> CreateAsteroidBlobAsync_triplanar(Context* ctx, Node * node, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const Vector<String> &diffusePaths);
+
+	/*
+	the same jobs without a node, for tools and checks: no Urho objects are created, data is filled when the job completes and must outlive it.
+	cacheFile replaces the file of GetAsteroidCacheFile(), an empty name disables the cache
+	*/
+	void CreateAsteroidData_triplanar(Context* ctx, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const String &cacheFile,
+		AsteroidBlobData_triplanar &data);
+	SharedPtr<AsteroidJob> CreateAsteroidDataAsync_triplanar(Context* ctx, unsigned long long seed, unsigned textureSize, AsteroidBaseMesh base, unsigned detail, const String &cacheFile,
+		AsteroidBlobData_triplanar &data);
 }		/*namespace Urho3D*/
 
@@ -1,177 +1,171 @@
 #include "half_edge_mesh.hpp"
 
-#include <map>
-#include <set>
+#include <algorithm>
 #include <vector>
 
+#include <stdio.h>
 #include <stdlib.h>
 
 using std::vector;
-using std::map;
-using std::set;
-using std::pair;
 
-typedef pair<int, int> EdgeId;
+namespace {
+
+// half edge with its undirected vertex pair packed into one sort key.
+struct HalfEdgeKey {
+    unsigned long long key;
+    int halfEdge;
+
+    bool operator<(const HalfEdgeKey& other) const {
+        return key != other.key ? key < other.key : halfEdge < other.halfEdge;
+    }
+};
+
+unsigned long long UndirectedKey(int i0, int i1) {
+    const unsigned lo = (unsigned)(i0 < i1 ? i0 : i1);
+    const unsigned hi = (unsigned)(i0 < i1 ? i1 : i0);
+    return ((unsigned long long)lo << 32) | hi;
+}
 
-EdgeId Sort(int i0, int i1) {
-    return i0 < i1 ? EdgeId(i0, i1) : EdgeId(i1, i0);
 }
 
+const int HalfEdgeMesh::INVALID;
+
 HalfEdgeMesh::HalfEdgeMesh(
     const vector<vec3>& vertices,
     const vector<Tri>& faces) {
 
-    map<pair<int, int>, HalfEdgeIter> addedHalfEdges;
-    map<pair<int, int>, EdgeIter> addedEdges;
-    map<int, VertexIter> addedVertices;
-
-    // we basically construct the half edge mesh by iterating over all edges,
-    // and constructing their corresponding half edge. Along the way, we link
-    // these half edges to their corresponding faces, vertices and edges.
-    for(Tri tri : faces) {
-        FaceIter face = this->faces.insert(this->faces.end(), Face());
+    // vec3 is 3 floats and Tri is 3 ints, both without padding.
+    Build(vertices.empty() ? nullptr : &vertices[0].x, sizeof(vec3), (int)vertices.size(),
+        faces.empty() ? nullptr : (const unsigned*)faces[0].i, (int)faces.size() * 3);
+}
 
-        // three half edges for every triangle.
-        for(int iTri = 0; iTri < 3; iTri++) {
-            // half edge indices.
-            int i0 = tri.i[(iTri+0)%3];
-            int i1 = tri.i[(iTri+1)%3];
+HalfEdgeMesh::HalfEdgeMesh(
+    const float* positions,
+    size_t stride,
+    int numVertices,
+    const unsigned* indices,
+    int numIndices) {
 
-            pair<int, int> heid(i0, i1); // id
+    Build(positions, stride, numVertices, indices, numIndices);
+}
 
-            if(addedHalfEdges.count(heid) > 0) {
-                printf("ERROR: Invalid mesh: duplicated half edge with indices (%d,%d)\n", i0, i1);
-                exit(1);
-            }
-            HalfEdgeIter halfEdge = halfEdges.insert(halfEdges.end(), HalfEdge());
-            halfEdge->twin = EndHalfEdges(); // twin is null by default.
-            addedHalfEdges[heid] = halfEdge;
-
-            //
-            // link half edge with edge.
-            //
-            EdgeId eid = Sort(i0 ,i1);
-            EdgeIter edge;
-            if(addedEdges.count(eid) == 0) { // create edge on the fly.
-                edge = edges.insert(edges.end(), Edge());
-                edge->halfEdge = halfEdge;
-                addedEdges[eid] = edge;
-            }
-            halfEdge->edge = edge;
-
-            //
-            // link half edge with face.
-            //
-            halfEdge->face = face;
-            face->halfEdge = halfEdge;
-
-            //
-            // link half edge with vertex.
-            //
-            VertexIter vertex;
-            if(addedVertices.count(i0) == 0) { // create vertex on fly if needed.
-                vec3 p = vertices[i0];
-                vertex = this->vertices.insert(this->vertices.end(), Vertex(p));
-                addedVertices[i0] = vertex;
-            } else {
-                vertex = addedVertices[i0];
-            }
-            vertex->halfEdge = halfEdge;
-            halfEdge->vertex = vertex;
-
-            //
-            // finally, attempt linking half edge with its twin.
-            //
-            pair<int, int> twinHeid(i1, i0); // id
-            if(addedHalfEdges.count(twinHeid) > 0) {
-                HalfEdgeIter twin = addedHalfEdges[twinHeid];
-                twin->twin = halfEdge;
-                halfEdge->twin = twin;
-            }
+void HalfEdgeMesh::Build(
+    const float* vertexPositions,
+    size_t stride,
+    int numVertices,
+    const unsigned* indices,
+    int numIndices) {
+
+    const int numHalfEdges = numIndices / 3 * 3;
+
+    //
+    // number the vertices in order of first use, and record the root of every half edge.
+    //
+    vector<int> compact(numVertices, INVALID);
+    halfEdgeVertex.resize(numHalfEdges);
+    for(int he = 0; he < numHalfEdges; he++) {
+        const int input = (int)indices[he];
+        if(compact[input] == INVALID) {
+            const float* p = (const float*)((const char*)vertexPositions + input * stride);
+            compact[input] = (int)positions.size();
+            positions.push_back(vec3(p[0], p[1], p[2]));
+            inputIndices.push_back(input);
         }
+        halfEdgeVertex[he] = compact[input];
+    }
 
-        //
-        // Finally, link the half edges with their next half edge.
-        //
-        for(int iTri = 0; iTri < 3; iTri++) {
+    // like the list based mesh, a vertex keeps the last half edge emanating from it.
+    vertexHalfEdge.assign(positions.size(), INVALID);
+    for(int he = 0; he < numHalfEdges; he++) {
+        vertexHalfEdge[halfEdgeVertex[he]] = he;
+    }
 
-            // half edge indices.
-            int i0 = tri.i[(iTri+0)%3];
-            int i1 = tri.i[(iTri+1)%3];
-            int i2 = tri.i[(iTri+2)%3];
+    //
+    // find twins: after sorting by undirected vertex pair, the half edges of an edge are adjacent.
+    //
+    vector<HalfEdgeKey> keys(numHalfEdges);
+    for(int he = 0; he < numHalfEdges; he++) {
+        keys[he].key = UndirectedKey(halfEdgeVertex[he], halfEdgeVertex[Next(he)]);
+        keys[he].halfEdge = he;
+    }
+    std::sort(keys.begin(), keys.end());
 
-            HalfEdgeIter halfEdge = addedHalfEdges[pair<int, int>(i0, i1)];
-            HalfEdgeIter nextHalfEdge = addedHalfEdges[pair<int, int>(i1, i2)];
+    halfEdgeTwin.assign(numHalfEdges, INVALID);
+    for(int begin = 0; begin < numHalfEdges; ) {
+        int end = begin + 1;
+        while(end < numHalfEdges && keys[end].key == keys[begin].key) {
+            end++;
+        }
 
-            halfEdge->next = nextHalfEdge;
+        for(int ii = begin; ii < end; ii++) {
+            const int he = keys[ii].halfEdge;
+            for(int jj = ii + 1; jj < end; jj++) {
+                const int other = keys[jj].halfEdge;
+                if(halfEdgeVertex[he] == halfEdgeVertex[other]) {
+                    printf("ERROR: Invalid mesh: duplicated half edge with indices (%d,%d)\n",
+                        inputIndices[halfEdgeVertex[he]], inputIndices[halfEdgeVertex[Next(he)]]);
+                    exit(1);
+                }
+                // a non-manifold edge pairs its first two opposite half edges, the rest stay boundary.
+                if(halfEdgeTwin[he] == INVALID && halfEdgeTwin[other] == INVALID) {
+                    halfEdgeTwin[he] = other;
+                    halfEdgeTwin[other] = he;
+                }
+            }
         }
+        begin = end;
     }
 
-    // assign id to every vertex.
-    int id = 0;
-    for(VertexIter it = BeginVertices(); it != EndVertices(); ++it) {
-        it->id = id++;
+    //
+    // edges in order of their first half edge.
+    //
+    halfEdgeEdge.assign(numHalfEdges, INVALID);
+    edgeHalfEdge.reserve(numHalfEdges / 2 + 1);
+    for(int he = 0; he < numHalfEdges; he++) {
+        if(halfEdgeEdge[he] != INVALID) {
+            continue;
+        }
+        halfEdgeEdge[he] = (int)edgeHalfEdge.size();
+        if(halfEdgeTwin[he] != INVALID) {
+            halfEdgeEdge[halfEdgeTwin[he]] = (int)edgeHalfEdge.size();
+        }
+        edgeHalfEdge.push_back(he);
     }
 }
 
 void HalfEdgeMesh::ToMesh(
     std::vector<vec3>& vertices,
-    std::vector<Tri>& faces) {
-    map< VertexIter, int > verticesMap;
-
-    for(VertexIter it = BeginVertices(); it != EndVertices(); ++it) {
-	vertices.push_back(it->p);
-	verticesMap[it] = it->id;
-    }
-
-    for(FaceIter it = BeginFaces(); it != EndFaces(); ++it) {
-	HalfEdgeIter halfEdge = it->halfEdge;
+    std::vector<Tri>& faces) const {
 
-	Tri tri;
-	int i = 0;
+    vertices.insert(vertices.end(), positions.begin(), positions.end());
 
-	do {
-	    tri.i[i++] = verticesMap[halfEdge->vertex];
-	    halfEdge = halfEdge->next;
-	} while(halfEdge != it->halfEdge);
-
-	faces.push_back(tri);
+    // faces start at their last half edge, the same rotation the list based mesh produced.
+    for(int f = 0; f < NumFaces(); f++) {
+        faces.push_back(Tri(halfEdgeVertex[f * 3 + 2], halfEdgeVertex[f * 3], halfEdgeVertex[f * 3 + 1]));
     }
 }
 
-bool HalfEdgeMesh::IsBoundary(HalfEdgeIter heit) {
-    return heit->twin == EndHalfEdges();
-}
-
-bool HalfEdgeMesh::IsBoundary(EdgeIter eit) {
-    return IsBoundary(eit->halfEdge);
-}
+int HalfEdgeMesh::GetNextBoundary(int halfEdge) const {
+    // find vertex that halfEdge points to.
+    const int to = halfEdgeVertex[Next(halfEdge)];
 
-HalfEdgeIter HalfEdgeMesh::GetNextBoundary(HalfEdgeIter heit) {
-    // find vertex that heit points to.
-    VertexIter to = heit->next->vertex;
-
-    HalfEdgeIter halfEdge = to->halfEdge;
-    HalfEdgeIter first = halfEdge;
+    const int first = vertexHalfEdge[to];
+    int current = first;
 
     // search for next boundary. It will be an edge emanating from 'to'.
     do {
-        if(IsBoundary(halfEdge)) {
-            return halfEdge;
+        if(IsBoundary(current)) {
+            return current;
         }
 
-        halfEdge = halfEdge->twin->next;
+        current = Next(halfEdgeTwin[current]);
 
-    } while(halfEdge != first);
+    } while(current != first);
 
     printf("ERROR: invalid mesh: found no next boundary edge\n");
     exit(1);
 }
 
-float Edge::GetLength() {
-    return vec3::distance(halfEdge->vertex->p, halfEdge->twin->vertex->p);
-}
-
-float HalfEdge::GetLength() {
-    return vec3::distance(vertex->p, twin->vertex->p);
+float HalfEdgeMesh::GetLength(int halfEdge) const {
+    return vec3::distance(positions[halfEdgeVertex[halfEdge]], positions[halfEdgeVertex[Next(halfEdge)]]);
 }
@@ -1,113 +1,87 @@
 #pragma once
 
-#include <list>
+#include <stddef.h>
 #include <vector>
 #include "vec.hpp"
 
 //
-// This is a half-edge mesh implementation based on STL iterators.
+// Half-edge mesh of a triangle mesh, stored in flat arrays and addressed by int32 indices.
+//
+// The half edges of face f are 3f, 3f+1 and 3f+2, so the face and the next half edge
+// of a half edge are computed instead of stored. Twins are found by sorting the
+// half edges by their undirected vertex pair, so construction is a handful of
+// contiguous allocations instead of one heap node per element and map lookups.
+//
+// Vertices are numbered compactly in order of first use by the faces; InputIndex()
+// maps them back to the vertex array given to the constructor.
 //
-
-class Edge;
-class HalfEdge;
-class Vertex;
-class Face;
-
-typedef std::list<HalfEdge>::iterator HalfEdgeIter;
-typedef std::list<Edge>::iterator EdgeIter;
-typedef std::list<Vertex>::iterator VertexIter;
-typedef std::list<Face>::iterator FaceIter;
-
-class Edge {
-public:
-    // one of the two half edges this edge is split into.
-    HalfEdgeIter halfEdge;
-
-    float GetLength();
-};
-
-class HalfEdge {
-public:
-    // the vertex at the root of this half edge.
-    VertexIter vertex;
-
-    // the half edge opposite to this half edge.
-    // this half will be in an opposite face.
-    // and this will be null if this half edge is part of the boundary.
-    HalfEdgeIter twin;
-
-    // the half edge that this half edge is pointing at, in the current face.
-    HalfEdgeIter next;
-
-    // the face this half edge belongs to.
-    FaceIter face;
-
-    // edge that contains this half edge.
-    EdgeIter edge;
-
-    float GetLength();
-};
-
-class Vertex {
-public:
-    // one of the half edges that is emanating from this vertex.
-    HalfEdgeIter halfEdge;
-
-    vec3 p;
-    int id; // for convenience, we associate an id with every vertex.
-
-    Vertex(const vec3& p) {
-        this->p = p;
-    }
-};
-
-class Face {
-public:
-    // The face that contains this half edge.
-    HalfEdgeIter halfEdge;
-};
-
-
-inline bool operator<( const HalfEdgeIter& i, const HalfEdgeIter& j ) { return &*i < &*j; }
-inline bool operator<( const   VertexIter& i, const   VertexIter& j ) { return &*i < &*j; }
-inline bool operator<( const     FaceIter& i, const     FaceIter& j ) { return &*i < &*j; }
-
-
 class HalfEdgeMesh {
 public:
+    static const int INVALID = -1;
+
     HalfEdgeMesh(
         const std::vector<vec3>& vertices,
         const std::vector<Tri>& faces);
 
+    // Build from arrays in place: the position of vertex i is the 3 floats at
+    // (const char*)positions + i * stride, every 3 indices are one triangle.
+    HalfEdgeMesh(
+        const float* positions,
+        size_t stride,
+        int numVertices,
+        const unsigned* indices,
+        int numIndices);
+
     // Convert a half edge mesh back to a polygon-soup mesh.
     void ToMesh(
         std::vector<vec3>& vertices,
-        std::vector<Tri>& faces);
-
-    bool IsBoundary(HalfEdgeIter heit);
-    bool IsBoundary(EdgeIter eit);
-    HalfEdgeIter GetNextBoundary(HalfEdgeIter heit);
-
-    FaceIter BeginFaces() {return faces.begin();}
-    FaceIter EndFaces() {return faces.end();}
-
-    VertexIter BeginVertices() {return vertices.begin();}
-    VertexIter EndVertices() {return vertices.end();}
-
-    HalfEdgeIter BeginHalfEdges() {return halfEdges.begin();}
-    HalfEdgeIter EndHalfEdges() {return halfEdges.end();}
-
-    EdgeIter BeginEdges() {return edges.begin();}
-    EdgeIter EndEdges() {return edges.end();}
-
-    size_t NumVertices() { return vertices.size();}
-    size_t NumEdges() { return edges.size();}
-    size_t NumHalfEdges() { return halfEdges.size();}
+        std::vector<Tri>& faces) const;
+
+    int NumVertices() const { return (int)positions.size(); }
+    int NumFaces() const { return (int)halfEdgeVertex.size() / 3; }
+    int NumHalfEdges() const { return (int)halfEdgeVertex.size(); }
+    int NumEdges() const { return (int)edgeHalfEdge.size(); }
+
+    // the vertex at the root of the half edge.
+    int Vertex(int halfEdge) const { return halfEdgeVertex[halfEdge]; }
+    // the half edge in the opposite face, INVALID on the boundary.
+    int Twin(int halfEdge) const { return halfEdgeTwin[halfEdge]; }
+    // the edge that contains the half edge.
+    int Edge(int halfEdge) const { return halfEdgeEdge[halfEdge]; }
+    static int Face(int halfEdge) { return halfEdge / 3; }
+    // the half edge that this half edge is pointing at, in the same face.
+    static int Next(int halfEdge) { return halfEdge % 3 == 2 ? halfEdge - 2 : halfEdge + 1; }
+    static int Prev(int halfEdge) { return halfEdge % 3 == 0 ? halfEdge + 2 : halfEdge - 1; }
+
+    // one of the two half edges of the edge, the one of the lower face.
+    int EdgeHalfEdge(int edge) const { return edgeHalfEdge[edge]; }
+    // one of the half edges emanating from the vertex.
+    int VertexHalfEdge(int vertex) const { return vertexHalfEdge[vertex]; }
+    const vec3& Position(int vertex) const { return positions[vertex]; }
+    int InputIndex(int vertex) const { return inputIndices[vertex]; }
+
+    bool IsBoundary(int halfEdge) const { return halfEdgeTwin[halfEdge] == INVALID; }
+    bool IsBoundaryEdge(int edge) const { return IsBoundary(edgeHalfEdge[edge]); }
+    // the boundary half edge that follows a boundary half edge.
+    int GetNextBoundary(int halfEdge) const;
+
+    float GetLength(int halfEdge) const;
 
 private:
-
-    std::list<HalfEdge> halfEdges;
-    std::list<Edge> edges;
-    std::list<Vertex> vertices;
-    std::list<Face> faces;
+    void Build(
+        const float* positions,
+        size_t stride,
+        int numVertices,
+        const unsigned* indices,
+        int numIndices);
+
+    std::vector<vec3> positions;
+    std::vector<int> inputIndices;
+    std::vector<int> vertexHalfEdge;
+
+    std::vector<int> halfEdgeVertex;
+    std::vector<int> halfEdgeTwin;
+    std::vector<int> halfEdgeEdge;
+
+    std::vector<int> edgeHalfEdge;
 };
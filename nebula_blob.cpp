@@ -1,5 +1,6 @@
 #include "nebula_blob.h"
 #include "FastNoise.h"
+#include "asteroid_random.h"
 #include <Urho3D/Urho3DAll.h>
 
 namespace Urho3D
@@ -114,20 +115,23 @@ namespace Urho3D
 		return fromScratchModel;
 	}
 
-	static Material * CreateNebulaMaterial(Context* ctx, unsigned int TextureSize, const Color &color)
+	static Material * CreateNebulaMaterial(Context* ctx, unsigned int TextureSize, const Color &color, AsteroidRandom &rng)
 	{
-		FastNoise perlin(Random(0, M_MAX_UNSIGNED));
+		FastNoise perlin(rng.NextSeed());
+		perlin.SetNoiseType(FastNoise::PerlinFractal);
 		perlin.SetFractalOctaves(8);
 		perlin.SetFrequency(0.04f);
-		float ** noise = alloc2Darr<float>(TextureSize, TextureSize);
-		for (int xx = 0; xx < TextureSize; ++xx)
+		/*row major, noise[yy * TextureSize + xx], normalized to [0, 1]*/
+		PODVector<float> noise(TextureSize * TextureSize);
+		perlin.GetNoiseGrid2D(0.0f, 0.0f, 1.0f, 1.0f, TextureSize, TextureSize, &noise[0], TextureSize);
+		float min = noise[0], max = noise[0];
+		for (unsigned ii = 0; ii < noise.Size(); ++ii)
 		{
-			for (int yy = 0; yy < TextureSize; ++yy)
-			{
-				noise[xx][yy] = perlin.GetPerlinFractal(xx, yy);
-			}
+			min = Min(min, noise[ii]);
+			max = Max(max, noise[ii]);
 		}
-		normalize2Darr<float>(noise, TextureSize, TextureSize);
+		for (unsigned ii = 0; ii < noise.Size(); ++ii)
+			noise[ii] = (noise[ii] - min) / (max - min);
 		SharedPtr <Texture2D> perlin2D(MakeShared<Texture2D>(ctx));
 		perlin2D->SetNumLevels(1);
 		if (perlin2D->SetSize(TextureSize, TextureSize, Graphics::GetRGBAFormat(), TEXTURE_DYNAMIC) == false)
@@ -145,12 +149,11 @@ namespace Urho3D
 				float a = Pow(1.0f - dist / TextureSize, 6.0f);
 
 				Color c(color);
-				c.a_ = Pow(noise[xx][yy], 4.0f) * a;
+				c.a_ = Pow(noise[yy * TextureSize + xx], 4.0f) * a;
 				pic->SetPixel(xx, yy, c);
 			}
 		}
 		perlin2D->SetData(pic, true);
-		release2Darr<float>(noise, TextureSize, TextureSize);
 
 		ResourceCache * cache = ctx->GetSubsystem<ResourceCache>();
 		Material * ret = new Material(ctx);
@@ -161,14 +164,15 @@ namespace Urho3D
 		return ret;
 	}
 
-	void CreateNebulaBlob(Context* ctx, Node * node, const PODVector<Color> &colors, unsigned int TextureSize)
+	void CreateNebulaBlob(Context* ctx, Node * node, const PODVector<Color> &colors, unsigned int TextureSize, unsigned long long seed)
 	{
 		StaticModelGroup * s = node->CreateComponent<StaticModelGroup>();
 		s->SetModel(CreateNebulaModel(ctx, colors.Size()));
 
 		for (unsigned ii = 0; ii < colors.Size(); ++ii)
 		{
-			s->SetMaterial(ii, CreateNebulaMaterial(ctx, TextureSize, colors[ii]));
+			AsteroidRandom rng(seed, ii);
+			s->SetMaterial(ii, CreateNebulaMaterial(ctx, TextureSize, colors[ii], rng));
 		}
 	}
 }
@@ -4,14 +4,18 @@
 #include "vec.hpp"
 
 #include "Eigen/Sparse"
+#include "Eigen/SparseCholesky"
+#include "Eigen/IterativeLinearSolvers"
 
-#include <set>
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
 
 #define M_PI 3.14159
 
 using std::vector;
-using std::set;
 
 /*
 
@@ -26,174 +30,111 @@ using std::set;
       \ v /
        \/
 
-Compute the harmonic weight for the edge.
+Compute the harmonic weights of all edges.
 
 It is computed by the formula
 
 (cot(u) + cot(v)) / 2
 
 see the beautiful ASCII art above for an illustration.
-*/
-
-float HarmonicWeight(EdgeIter eit) {
-    // length of edge shared by the two triangles.
-    float c = eit->GetLength();
-
-    HalfEdgeIter e = eit->halfEdge;
-    float a1 = vec3::distance(e->next->vertex->p, e->next->next->vertex->p );
-    float b1 = vec3::distance(e->next->next->vertex->p, e->next->next->next->vertex->p );
-
-    e = eit->halfEdge->twin;
-    float a2 = vec3::distance(e->next->vertex->p, e->next->next->vertex->p );
-    float b2 = vec3::distance(e->next->next->vertex->p, e->next->next->next->vertex->p );
-
-    // use the cosine law to compute cos(u) and cos(v)
-    float cos_u = (b1*b1 + a1*a1 - c*c) / (2.0f * b1 * a1);
-    float cos_v = (b2*b2 + a2*a2 - c*c) / (2.0f * b2 * a2);
-
-    float sin_u = sqrt(1.0 - cos_u*cos_u);
-    float sin_v = sqrt(1.0 - cos_v*cos_v);
-
-    float weight;
-    weight = (cos_u / sin_u + cos_v  / sin_v) * 0.5f;
-
-    return weight;
-}
-
-void uvMap(
-    const std::vector<float>& inVertices,
-    const std::vector<int>& inFaces,
-
-    std::vector<float>& outVertices,
-    std::vector<int>& outFaces,
-    std::vector<float>& outUvs,
-    std::vector<float>* outUvEdges
-    ) {
-
-    vector<vec3> vVertices;
-    for(int i = 0; i < inVertices.size(); i+=3) {
-        vVertices.push_back(vec3(
-                                inVertices[i+0],
-                                inVertices[i+1],
-                                inVertices[i+2]
-                                ));
-    }
-
-    vector<Tri> vFaces;
-    for(int i = 0; i < inFaces.size(); i+=3) {
-        vFaces.push_back(Tri(
-                             inFaces[i+0],
-                             inFaces[i+1],
-                             inFaces[i+2]
-                             ));
-    }
 
-    // instead of a polygon soup, we use a half edge mesh.
-    HalfEdgeMesh hem(vVertices, vFaces);
+Every triangle adds half the cotangent of each of its angles to the opposite
+edge. The cotangent of the angle between the two edges a and b leaving a
+corner is dot(a, b) / |cross(a, b)|, so no lengths, law of cosines or
+sqrt(1 - cos^2) are needed, and each triangle is visited once.
 
-    // To now find the uv coordinates, we will create a system of
-    // linear equations. The system is formulated with matrices and vectors,
-    // and then we solve it with Eigen.
-
-    // N is number of variables in the linear system. We want uv coordinates for every vertex
-    // so one variable for every vertex.
-    const int N = hem.NumVertices();
+Slivers, e.g. from vertices projected onto a cut plane, have a cross product
+near zero and would give huge or non-finite weights; their cotangents are
+clamped to +-MAX_COTANGENT. Obtuse angles can make the weight of an edge
+negative, which can fold the map; edge weights are clamped to at least
+MIN_WEIGHT. Boundary edges get no weight, their vertices are fixed.
+*/
 
-    //
-    // Let us first find the boundary. So let us find the first boundary edge.
-    //
-    HalfEdgeIter firstBoundary = hem.EndHalfEdges();
-    HalfEdgeIter currentBoundary = hem.EndHalfEdges();
-    for(HalfEdgeIter heit = hem.BeginHalfEdges(); heit != hem.EndHalfEdges(); heit++) {
-        if(hem.IsBoundary(heit)) {
-            firstBoundary = heit;
-            break;
+static const float MAX_COTANGENT = 1e3f;
+static const float MIN_WEIGHT = 1e-3f;
+
+static void HarmonicWeights(const HalfEdgeMesh& hem, vector<float>& weights) {
+    weights.assign(hem.NumEdges(), 0.0f);
+
+    for(int face = 0; face < hem.NumFaces(); face++) {
+        const vec3 p[3] = {
+            hem.Position(hem.Vertex(face * 3 + 0)),
+            hem.Position(hem.Vertex(face * 3 + 1)),
+            hem.Position(hem.Vertex(face * 3 + 2))
+        };
+
+        for(int k = 0; k < 3; k++) {
+            const vec3 a = p[(k + 1) % 3] - p[k];
+            const vec3 b = p[(k + 2) % 3] - p[k];
+            const float sine = vec3::length(vec3::cross(a, b));
+            const float cosine = vec3::dot(a, b);
+            float cotangent;
+            if(sine * MAX_COTANGENT > fabs(cosine)) {
+                cotangent = cosine / sine;
+            } else {
+                cotangent = cosine >= 0.0f ? MAX_COTANGENT : -MAX_COTANGENT;
+            }
+
+            // the edge opposite the corner is the next half edge.
+            weights[hem.Edge(HalfEdgeMesh::Next(face * 3 + k))] += 0.5f * cotangent;
         }
     }
 
-    if(firstBoundary == hem.EndHalfEdges()) {
-        printf("ERROR: found no boundary in mesh\n");
+    for(int edge = 0; edge < hem.NumEdges(); edge++) {
+        if(hem.IsBoundaryEdge(edge)) {
+            weights[edge] = 0.0f;
+        } else if(!(weights[edge] >= MIN_WEIGHT)) {
+            weights[edge] = MIN_WEIGHT;
+        }
     }
+}
 
-    //
-    // find the rest of the boundary by iterating over the boundary.
-    // also, keep track of the cumulative edge length over the boundary.
-    //
-    vector<HalfEdgeIter> boundaryEdges;
-    vector<VertexIter> boundaryVertices;
-    set<int> boundarySet;
-    vector<float> edgeLengths; // cumulative edge lengths
-    float totalEdgeLength = 0;
+typedef Eigen::Triplet<double> Triplet;
+// W is very sparse, so much can be saved by using a sparse matrix.
+typedef Eigen::SparseMatrix<double> SparseMatrix;
 
-    HalfEdgeIter previousBoundary = firstBoundary;
-    currentBoundary = firstBoundary;
-    do {
-        boundaryEdges.push_back(currentBoundary);
-        boundaryVertices.push_back(currentBoundary->vertex);
-        boundarySet.insert(currentBoundary->vertex->id);
-
-        // cumulative edge length of 'currentBoundary->vertex'
-        edgeLengths.push_back(totalEdgeLength);
-        currentBoundary = hem.GetNextBoundary(currentBoundary);
+/*
+Solves the full system W * uv = b, one row per vertex, with the rows of the
+boundary vertices pinned to identity. W is not symmetric, so it needs a general
+sparse LU. Rows of uv that belong to boundary vertices hold the fixed values.
+*/
+static void SolvePinned(
+    const HalfEdgeMesh& hem,
+    const vector<char>& isBoundary,
+    const vector<float>& weights,
+    Eigen::MatrixXd& uv) {
 
-        totalEdgeLength += vec3::distance(
-            previousBoundary->vertex->p, currentBoundary->vertex->p
-            );
-        previousBoundary = currentBoundary;
-    } while(currentBoundary != firstBoundary);
+    const int N = hem.NumVertices();
 
     // Now let us formulate the linear system. We have two systems:
     // W * x = bx
     // W * y = by
     // one system for each of the two uv-coordinates.
-    Eigen::VectorXd bx(N);
-    Eigen::VectorXd by(N);
-
-    // Here's bx and by:
     // for non-boundary vertices, we have
     // (bx[i], by[i]) = (0,0)
-    // for boundary vertices, we project them onto a circle.
-    // so for boundary vertices we have:
-    // (bx[i], by[i]) = (cos(theta),sin(theta))
+    // for boundary vertices, they are the fixed uv.
+    Eigen::VectorXd bx(N);
+    Eigen::VectorXd by(N);
     for(int i = 0; i < N; i++) {
-        bx[i] = 0.0f;
-        by[i] = 0.0f;
-    }
-    for(int i = 0; i < boundaryVertices.size(); i++) {
-        VertexIter vit = boundaryVertices[i];
-        double theta = (edgeLengths[i]/totalEdgeLength)*2.0f*M_PI;
-        bx[vit->id] = cos(theta);
-        by[vit->id] = sin(theta);
+        bx[i] = isBoundary[i] ? uv(i, 0) : 0.0;
+        by[i] = isBoundary[i] ? uv(i, 1) : 0.0;
     }
 
-    typedef Eigen::Triplet<double> Triplet;
-
-    // W is very sparse, so much can be saved by using a sparse matrix.
-    typedef Eigen::SparseMatrix<double> SparseMatrix;
     SparseMatrix W(N, N);
 
     vector<Triplet> triplets;
     vector<double> diag; // diagonal values in W.
     diag.resize(N, 0);
 
-    for(EdgeIter eit = hem.BeginEdges(); eit != hem.EndEdges(); eit++) {
-        // The boundary vertices are fixed(they are projected on a circle),
-        // so we do not need to compute any weights of the boundary edges.
-        // So the boundary edges contribute very little to the final linear system.
-        if(hem.IsBoundary(eit)) {
+    for(int edge = 0; edge < hem.NumEdges(); edge++) {
+        if(hem.IsBoundaryEdge(edge)) {
             continue;
         }
 
-        VertexIter v0 = eit->halfEdge->vertex;
-        VertexIter v1 = eit->halfEdge->twin->vertex;
-
-        int i0 = v0->id;
-        int i1 = v1->id;
+        int i0 = hem.Vertex(hem.EdgeHalfEdge(edge));
+        int i1 = hem.Vertex(hem.Twin(hem.EdgeHalfEdge(edge)));
 
-        float weight = HarmonicWeight(eit);
-
-        // if we instead set the weight to one, then we get uniform weights. But that sucks, though.
-//        weight = 1.0;
+        float weight = weights[edge];
 
         // We set the weights for non-boundary edges.
         // Note that the conditionals are very important!
@@ -202,10 +143,10 @@ void uvMap(
         // Because in the linear system we should have
         // 1.0 * x[i] = bx[i]
         // (so also below for more explanations)
-        if(boundarySet.count(i0) == 0) {
+        if(!isBoundary[i0]) {
             triplets.push_back(Triplet(i0, i1, weight));
         }
-        if(boundarySet.count(i1) == 0) {
+        if(!isBoundary[i1]) {
             triplets.push_back(Triplet(i1, i0, weight));
         }
 
@@ -214,7 +155,7 @@ void uvMap(
     }
 
     for (int i = 0; i < diag.size(); i++) {
-        if(boundarySet.count(i) > 0) {
+        if(isBoundary[i]) {
             // for boundary vertices, diagonal is one.
             // The result of this will be that the i:th equation(that is, row i) in the linear system becomes
             // 1.0 * x[i] = bx[i]
@@ -239,22 +180,607 @@ void uvMap(
     }
 
     // now finally solve!
-    Eigen::VectorXd x(N);
-    Eigen::VectorXd y(N);
-    x = solver.solve(bx);
-    y = solver.solve(by);
+    uv.col(0) = solver.solve(bx);
+    uv.col(1) = solver.solve(by);
+}
+
+/*
+Sparsity pattern of an interior system together with its symbolic LDL^T
+analysis (fill-reducing ordering and elimination tree). Splitting the same
+base mesh the same way always gives the same connectivity, so later asteroids
+only refill the values and run the numeric factorization.
+*/
+struct InteriorPattern {
+    int M;
+    // (r0, r1) of every interior edge, in edge order. Together with M it determines the pattern.
+    vector<int> pairs;
+    unsigned long long hash;
+
+    // compressed matrix, its values are overwritten for every solve.
+    SparseMatrix A;
+    // index in A.valuePtr() of (r0, r1) and (r1, r0) of every pair.
+    vector<int> offDiagonal;
+    // index in A.valuePtr() of (r, r).
+    vector<int> diagonal;
+
+    Eigen::SimplicialLDLT<SparseMatrix> ldlt;
+    bool analyzed;
+};
+
+// patterns not in use, most recently used last. A pattern is taken out while a
+// solve uses it, so concurrent solves never share one.
+static const size_t PATTERN_CACHE_SIZE = 8;
+static std::mutex patternMutex;
+static vector<std::unique_ptr<InteriorPattern> > patternCache;
+static unsigned patternHits = 0;
+static unsigned patternMisses = 0;
+
+static unsigned long long HashPattern(int M, const vector<int>& pairs) {
+    // FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = (hash ^ (unsigned)M) * 1099511628211ULL;
+    for(size_t i = 0; i < pairs.size(); i++) {
+        hash = (hash ^ (unsigned)pairs[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::unique_ptr<InteriorPattern> TakePattern(int M, const vector<int>& pairs, unsigned long long hash) {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    for(size_t i = patternCache.size(); i-- > 0; ) {
+        InteriorPattern& p = *patternCache[i];
+        if(p.hash == hash && p.M == M && p.pairs == pairs) {
+            std::unique_ptr<InteriorPattern> pattern(std::move(patternCache[i]));
+            patternCache.erase(patternCache.begin() + i);
+            patternHits++;
+            return pattern;
+        }
+    }
+    patternMisses++;
+    return std::unique_ptr<InteriorPattern>();
+}
+
+static void ReturnPattern(std::unique_ptr<InteriorPattern> pattern) {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    if(patternCache.size() >= PATTERN_CACHE_SIZE) {
+        patternCache.erase(patternCache.begin());
+    }
+    patternCache.push_back(std::move(pattern));
+}
+
+// index of (row, col) in the values of a compressed column-major matrix.
+static int ValueIndex(const SparseMatrix& A, int row, int col) {
+    const int* begin = A.innerIndexPtr() + A.outerIndexPtr()[col];
+    const int* end = A.innerIndexPtr() + A.outerIndexPtr()[col + 1];
+    return (int)(std::lower_bound(begin, end, row) - A.innerIndexPtr());
+}
+
+static std::unique_ptr<InteriorPattern> CreatePattern(int M, vector<int>& pairs, unsigned long long hash) {
+    std::unique_ptr<InteriorPattern> pattern(new InteriorPattern());
+    pattern->M = M;
+    pattern->pairs.swap(pairs);
+    pattern->hash = hash;
+    pattern->analyzed = false;
+
+    const vector<int>& p = pattern->pairs;
+    vector<Triplet> triplets;
+    triplets.reserve(p.size() + M);
+    for(size_t i = 0; i < p.size(); i += 2) {
+        triplets.push_back(Triplet(p[i], p[i + 1], 0.0));
+        triplets.push_back(Triplet(p[i + 1], p[i], 0.0));
+    }
+    for(int r = 0; r < M; r++) {
+        triplets.push_back(Triplet(r, r, 0.0));
+    }
+    pattern->A.resize(M, M);
+    pattern->A.setFromTriplets(triplets.begin(), triplets.end());
+
+    pattern->offDiagonal.resize(p.size());
+    for(size_t i = 0; i < p.size(); i += 2) {
+        pattern->offDiagonal[i] = ValueIndex(pattern->A, p[i], p[i + 1]);
+        pattern->offDiagonal[i + 1] = ValueIndex(pattern->A, p[i + 1], p[i]);
+    }
+    pattern->diagonal.resize(M);
+    for(int r = 0; r < M; r++) {
+        pattern->diagonal[r] = ValueIndex(pattern->A, r, r);
+    }
+    return pattern;
+}
+
+void uvClearPatternCache() {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    patternCache.clear();
+    patternHits = 0;
+    patternMisses = 0;
+}
+
+void uvGetPatternCacheStats(unsigned& hits, unsigned& misses) {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    hits = patternHits;
+    misses = patternMisses;
+}
+
+/*
+Multigrid solver of the SPD interior system A * x = rhs, for meshes where a
+direct factorization grows too expensive.
+
+Every level coarsens the unknowns of the previous one to a maximal independent
+set of its matrix graph, so every other unknown has a coarse neighbour and is
+interpolated from its coarse neighbours with the normalized positive couplings
+(P). The coarse matrix is the Galerkin product P^T A P. Only the coarsest level,
+a few hundred unknowns, is factorized with LDL^T.
+
+The solve starts like a cascade: the coarsest solution is interpolated level by
+level, with one V-cycle at each level to correct it. The uv field is smooth, so
+this guess is already close, and conjugate gradient with one V-cycle as
+preconditioner reaches the tolerance in about ten iterations at any mesh size.
+A V-cycle is a damped Jacobi sweep, the correction from the next coarser level
+and a second Jacobi sweep; it is symmetric, as CG requires.
+*/
+// the same relative residual as the plain CG solver.
+static const double MULTIGRID_TOLERANCE = 1e-7;
+static const int MULTIGRID_MAX_ITERATIONS = 100;
+static const size_t MULTIGRID_MAX_LEVELS = 12;
+static const int MULTIGRID_COARSEST_SIZE = 500;
+// damping of the Jacobi sweeps.
+static const double MULTIGRID_OMEGA = 0.6;
+
+class MultigridSolver {
+public:
+    bool Compute(const SparseMatrix& A) {
+        levels.clear();
+        levels.push_back(Level());
+        levels.back().A = A;
+        while(levels.size() < MULTIGRID_MAX_LEVELS && levels.back().A.rows() > MULTIGRID_COARSEST_SIZE) {
+            Level& fine = levels.back();
+            SparseMatrix P;
+            const int Mc = Coarsen(fine.A, P);
+            // coarsening stalls once the graph is nearly complete.
+            if(Mc > fine.A.rows() * 3 / 4) {
+                break;
+            }
+            fine.P = P;
+            fine.Pt = P.transpose();
+            Level coarse;
+            coarse.A = fine.Pt * fine.A * fine.P;
+            levels.push_back(coarse);
+        }
+        for(size_t l = 0; l < levels.size(); l++) {
+            levels[l].invDiag = levels[l].A.diagonal().cwiseInverse();
+        }
+        ldlt.compute(levels.back().A);
+        return ldlt.info() == Eigen::Success;
+    }
+
+    bool Solve(const Eigen::MatrixXd& rhs, Eigen::MatrixXd& x) const {
+        x.resize(rhs.rows(), rhs.cols());
+        for(int col = 0; col < rhs.cols(); col++) {
+            Eigen::VectorXd xc;
+            if(!SolveColumn(rhs.col(col), xc)) {
+                return false;
+            }
+            x.col(col) = xc;
+        }
+        return true;
+    }
+
+private:
+    struct Level {
+        SparseMatrix A;
+        Eigen::VectorXd invDiag;
+        // interpolation from the next coarser level, empty on the coarsest.
+        SparseMatrix P;
+        SparseMatrix Pt;
+    };
+
+    // coarse unknowns are a greedy maximal independent set; returns their number.
+    static int Coarsen(const SparseMatrix& A, SparseMatrix& P) {
+        const int M = (int)A.rows();
+        vector<int> coarse(M, -1);
+        vector<char> covered(M, 0);
+        int Mc = 0;
+        for(int col = 0; col < M; col++) {
+            if(covered[col]) {
+                continue;
+            }
+            coarse[col] = Mc++;
+            for(SparseMatrix::InnerIterator it(A, col); it; ++it) {
+                covered[it.row()] = 1;
+            }
+        }
+
+        // A is symmetric, so column i holds the couplings of row i.
+        vector<Triplet> triplets;
+        triplets.reserve(M * 3);
+        for(int i = 0; i < M; i++) {
+            if(coarse[i] >= 0) {
+                triplets.push_back(Triplet(i, coarse[i], 1.0));
+                continue;
+            }
+            double sum = 0.0;
+            int count = 0;
+            for(SparseMatrix::InnerIterator it(A, i); it; ++it) {
+                if(it.row() != i && coarse[it.row()] >= 0) {
+                    sum += std::max(-it.value(), 0.0);
+                    count++;
+                }
+            }
+            for(SparseMatrix::InnerIterator it(A, i); it; ++it) {
+                if(it.row() != i && coarse[it.row()] >= 0) {
+                    // negative couplings come from obtuse triangles, they are left out of the average.
+                    const double w = sum > 0.0 ? std::max(-it.value(), 0.0) / sum : 1.0 / count;
+                    if(w > 0.0) {
+                        triplets.push_back(Triplet(i, coarse[it.row()], w));
+                    }
+                }
+            }
+        }
+        P.resize(M, Mc);
+        P.setFromTriplets(triplets.begin(), triplets.end());
+        return Mc;
+    }
+
+    // approximate solution of levels[l].A * z = r.
+    Eigen::VectorXd Cycle(size_t l, const Eigen::VectorXd& r) const {
+        if(l + 1 == levels.size()) {
+            return ldlt.solve(r);
+        }
+        const Level& level = levels[l];
+        Eigen::VectorXd z = MULTIGRID_OMEGA * level.invDiag.cwiseProduct(r);
+        z += level.P * Cycle(l + 1, level.Pt * (r - level.A * z));
+        z += MULTIGRID_OMEGA * level.invDiag.cwiseProduct(r - level.A * z);
+        return z;
+    }
+
+    bool SolveColumn(const Eigen::VectorXd& rhs, Eigen::VectorXd& x) const {
+        const double rhsNorm = rhs.norm();
+        if(rhsNorm == 0.0) {
+            x = Eigen::VectorXd::Zero(rhs.size());
+            return true;
+        }
+
+        // warm start: the coarsest solution, interpolated and corrected level by level.
+        vector<Eigen::VectorXd> rhsLevels(levels.size());
+        rhsLevels[0] = rhs;
+        for(size_t l = 0; l + 1 < levels.size(); l++) {
+            rhsLevels[l + 1] = levels[l].Pt * rhsLevels[l];
+        }
+        x = ldlt.solve(rhsLevels.back());
+        for(size_t l = levels.size() - 1; l-- > 0; ) {
+            x = levels[l].P * x;
+            x += Cycle(l, rhsLevels[l] - levels[l].A * x);
+        }
+
+        // multigrid preconditioned conjugate gradient.
+        const SparseMatrix& A = levels[0].A;
+        Eigen::VectorXd r = rhs - A * x;
+        Eigen::VectorXd z = Cycle(0, r);
+        Eigen::VectorXd p = z;
+        double rz = r.dot(z);
+        for(int iteration = 0; r.norm() > MULTIGRID_TOLERANCE * rhsNorm; iteration++) {
+            if(iteration == MULTIGRID_MAX_ITERATIONS) {
+                return false;
+            }
+            const Eigen::VectorXd Ap = A * p;
+            const double alpha = rz / p.dot(Ap);
+            x += alpha * p;
+            r -= alpha * Ap;
+            z = Cycle(0, r);
+            const double rzNew = r.dot(z);
+            p = z + (rzNew / rz) * p;
+            rz = rzNew;
+        }
+        return true;
+    }
+
+    vector<Level> levels;
+    Eigen::SimplicialLDLT<SparseMatrix> ldlt;
+};
+
+/*
+Solves only for the interior vertices. Moving the known boundary uvs to the
+right-hand side leaves the negated interior block of W, which is symmetric
+(positive definite while the harmonic weights are positive), so a Cholesky
+type solver, conjugate gradient or multigrid applies. Both uv coordinates are solved
+together as the two columns of one right-hand side.
+The matrix structure and the LDL^T analysis come from the pattern cache when
+an earlier mesh had the same connectivity.
+Returns false if the solver failed; uv is then unchanged.
+*/
+static bool SolveInterior(
+    const HalfEdgeMesh& hem,
+    const vector<char>& isBoundary,
+    const vector<float>& weights,
+    UvSolver solver,
+    Eigen::MatrixXd& uv) {
+
+    const int N = hem.NumVertices();
+
+    // interior vertices are numbered 0..M-1 in the reduced system.
+    vector<int> interior(N, -1);
+    int M = 0;
+    for(int i = 0; i < N; i++) {
+        if(!isBoundary[i]) {
+            interior[i] = M++;
+        }
+    }
+    if(M == 0) {
+        return true;
+    }
+
+    // row i: sum_j w_ij * (x_i - x_j) = 0, known x_j of boundary neighbours go to the right.
+    vector<int> pairs;
+    vector<double> pairWeights;
+    vector<double> diag(M, 0.0);
+    Eigen::MatrixXd rhs = Eigen::MatrixXd::Zero(M, 2);
+    for(int edge = 0; edge < hem.NumEdges(); edge++) {
+        if(hem.IsBoundaryEdge(edge)) {
+            continue;
+        }
+
+        const int i0 = hem.Vertex(hem.EdgeHalfEdge(edge));
+        const int i1 = hem.Vertex(hem.Twin(hem.EdgeHalfEdge(edge)));
+        const int r0 = interior[i0];
+        const int r1 = interior[i1];
+        const double weight = weights[edge];
+
+        if(r0 >= 0 && r1 >= 0) {
+            pairs.push_back(r0);
+            pairs.push_back(r1);
+            pairWeights.push_back(weight);
+        }
+        if(r0 >= 0) {
+            diag[r0] += weight;
+            if(r1 < 0) {
+                rhs.row(r0) += weight * uv.row(i1);
+            }
+        }
+        if(r1 >= 0) {
+            diag[r1] += weight;
+            if(r0 < 0) {
+                rhs.row(r1) += weight * uv.row(i0);
+            }
+        }
+    }
+
+    const unsigned long long hash = HashPattern(M, pairs);
+    std::unique_ptr<InteriorPattern> pattern = TakePattern(M, pairs, hash);
+    if(!pattern) {
+        pattern = CreatePattern(M, pairs, hash);
+    }
+
+    SparseMatrix& A = pattern->A;
+    double* values = A.valuePtr();
+    std::fill(values, values + A.nonZeros(), 0.0);
+    for(size_t k = 0; k < pairWeights.size(); k++) {
+        values[pattern->offDiagonal[k * 2]] -= pairWeights[k];
+        values[pattern->offDiagonal[k * 2 + 1]] -= pairWeights[k];
+    }
+    for(int r = 0; r < M; r++) {
+        values[pattern->diagonal[r]] += diag[r];
+    }
+
+    Eigen::MatrixXd x;
+    bool solved = false;
+    if(solver == UV_SOLVER_CG) {
+        // a diagonal preconditioner; incomplete Cholesky cut the iterations but its factorization cost more than it saved.
+        Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower|Eigen::Upper> cg;
+        // uv end up in texels of at most a few thousand pixels.
+        cg.setTolerance(1e-7);
+        cg.compute(A);
+        if(cg.info() == Eigen::Success) {
+            x = cg.solve(rhs);
+            solved = cg.info() == Eigen::Success;
+        }
+    } else if(solver == UV_SOLVER_MULTIGRID) {
+        MultigridSolver multigrid;
+        solved = multigrid.Compute(A) && multigrid.Solve(rhs, x);
+    } else {
+        Eigen::SimplicialLDLT<SparseMatrix>& ldlt = pattern->ldlt;
+        if(!pattern->analyzed) {
+            ldlt.analyzePattern(A);
+            pattern->analyzed = true;
+        }
+        ldlt.factorize(A);
+        if(ldlt.info() == Eigen::Success) {
+            x = ldlt.solve(rhs);
+            solved = ldlt.info() == Eigen::Success;
+        }
+    }
+
+    // a failed numeric factorization leaves the analysis valid, so the pattern is kept either way.
+    ReturnPattern(std::move(pattern));
+    if(!solved) {
+        return false;
+    }
+
+    for(int i = 0; i < N; i++) {
+        if(interior[i] >= 0) {
+            uv.row(i) = x.row(interior[i]);
+        }
+    }
+    return true;
+}
+
+/*
+Places the boundary on the perimeter of the unit square, counter-clockwise like
+the circle. The four boundary vertices closest to a quarter of the boundary
+length become the corners, so the chart fills the whole square; the vertices in
+between are spaced by edge length along the sides.
+*/
+static void SquareBoundary(
+    const vector<int>& boundaryVertices,
+    const vector<float>& edgeLengths,
+    float totalEdgeLength,
+    Eigen::MatrixXd& uv) {
+
+    const int n = (int)boundaryVertices.size();
+
+    // boundary index of every corner, strictly increasing. corners[4] closes the loop.
+    int corners[5];
+    corners[0] = 0;
+    for(int k = 1; k < 4; k++) {
+        const float target = totalEdgeLength * k / 4.0f;
+        int best = corners[k - 1] + 1;
+        for(int i = best + 1; i <= n - (4 - k); i++) {
+            if(fabs(edgeLengths[i] - target) < fabs(edgeLengths[best] - target)) {
+                best = i;
+            }
+        }
+        corners[k] = best;
+    }
+    corners[4] = n;
+
+    const double cornerUvs[5][2] = { {0, 0}, {1, 0}, {1, 1}, {0, 1}, {0, 0} };
+    for(int k = 0; k < 4; k++) {
+        const float start = edgeLengths[corners[k]];
+        const float end = k == 3 ? totalEdgeLength : edgeLengths[corners[k + 1]];
+        for(int i = corners[k]; i < corners[k + 1]; i++) {
+            const double s = end > start ? (edgeLengths[i] - start) / (end - start) : 0.0;
+            const int v = boundaryVertices[i];
+            uv(v, 0) = cornerUvs[k][0] + s * (cornerUvs[k + 1][0] - cornerUvs[k][0]);
+            uv(v, 1) = cornerUvs[k][1] + s * (cornerUvs[k + 1][1] - cornerUvs[k][1]);
+        }
+    }
+}
+
+//
+// harmonic UVs of every vertex of hem, appended to outUvs. false if the mesh has no boundary.
+//
+static bool HarmonicUvs(
+    const HalfEdgeMesh& hem,
+    UvSolver solver,
+    UvBoundary boundary,
+    vector<float>& outUvs
+    ) {
+
+    // To now find the uv coordinates, we will create a system of
+    // linear equations. The system is formulated with matrices and vectors,
+    // and then we solve it with Eigen.
+
+    // N is number of variables in the linear system. We want uv coordinates for every vertex
+    // so one variable for every vertex.
+    const int N = hem.NumVertices();
+
+    //
+    // Let us first find the boundary. So let us find the first boundary edge.
+    //
+    int firstBoundary = HalfEdgeMesh::INVALID;
+    for(int he = 0; he < hem.NumHalfEdges(); he++) {
+        if(hem.IsBoundary(he)) {
+            firstBoundary = he;
+            break;
+        }
+    }
+
+    if(firstBoundary == HalfEdgeMesh::INVALID) {
+        printf("ERROR: found no boundary in mesh\n");
+        return false;
+    }
+
+    //
+    // find the rest of the boundary by iterating over the boundary.
+    // also, keep track of the cumulative edge length over the boundary.
+    //
+    vector<int> boundaryVertices;
+    vector<char> isBoundary(N, 0);
+    vector<float> edgeLengths; // cumulative edge lengths
+    float totalEdgeLength = 0;
+
+    int previousBoundary = firstBoundary;
+    int currentBoundary = firstBoundary;
+    do {
+        boundaryVertices.push_back(hem.Vertex(currentBoundary));
+        isBoundary[hem.Vertex(currentBoundary)] = 1;
+
+        // cumulative edge length of 'currentBoundary->vertex'
+        edgeLengths.push_back(totalEdgeLength);
+        currentBoundary = hem.GetNextBoundary(currentBoundary);
+
+        totalEdgeLength += vec3::distance(
+            hem.Position(hem.Vertex(previousBoundary)), hem.Position(hem.Vertex(currentBoundary))
+            );
+        previousBoundary = currentBoundary;
+    } while(currentBoundary != firstBoundary);
+
+    Eigen::MatrixXd uv = Eigen::MatrixXd::Zero(N, 2);
+    if(boundary == UV_BOUNDARY_SQUARE && boundaryVertices.size() >= 4) {
+        SquareBoundary(boundaryVertices, edgeLengths, totalEdgeLength, uv);
+    } else {
+        // for boundary vertices we project them onto a circle:
+        // (u, v) = (cos(theta),sin(theta))
+        for(int i = 0; i < boundaryVertices.size(); i++) {
+            int v = boundaryVertices[i];
+            double theta = (edgeLengths[i]/totalEdgeLength)*2.0f*M_PI;
+            uv(v, 0) = cos(theta);
+            uv(v, 1) = sin(theta);
+        }
+    }
+
+    // The boundary vertices are fixed(they are projected on a circle or square),
+    // so we do not need to compute any weights of the boundary edges.
+    vector<float> weights;
+    HarmonicWeights(hem, weights);
+
+    bool solved = false;
+    if(solver != UV_SOLVER_SPARSE_LU) {
+        solved = SolveInterior(hem, isBoundary, weights, solver, uv);
+    }
+    if(!solved) {
+        SolvePinned(hem, isBoundary, weights, uv);
+    }
 
     // output uvs.
     for(int i = 0; i < N; i++) {
-        outUvs.push_back(x[i]);
-        outUvs.push_back(y[i]);
+        outUvs.push_back(uv(i, 0));
+        outUvs.push_back(uv(i, 1));
+    }
+
+    return true;
+}
+
+void uvMap(
+    const std::vector<float>& inVertices,
+    const std::vector<int>& inFaces,
+
+    std::vector<float>& outVertices,
+    std::vector<int>& outFaces,
+    std::vector<float>& outUvs,
+    std::vector<float>* outUvEdges,
+    UvSolver solver,
+    UvBoundary boundary
+    ) {
+
+    vector<vec3> vVertices;
+    for(int i = 0; i < inVertices.size(); i+=3) {
+        vVertices.push_back(vec3(
+                                inVertices[i+0],
+                                inVertices[i+1],
+                                inVertices[i+2]
+                                ));
+    }
+
+    vector<Tri> vFaces;
+    for(int i = 0; i < inFaces.size(); i+=3) {
+        vFaces.push_back(Tri(
+                             inFaces[i+0],
+                             inFaces[i+1],
+                             inFaces[i+2]
+                             ));
+    }
+
+    // instead of a polygon soup, we use a half edge mesh.
+    HalfEdgeMesh hem(vVertices, vFaces);
+
+    if(!HarmonicUvs(hem, solver, boundary, outUvs)) {
+        return;
     }
 
     // recover all the edges of the flattened, uv-mapped mesh(useful for visualization):
     if(outUvEdges) {
-        for(EdgeIter eit = hem.BeginEdges(); eit != hem.EndEdges(); eit++) {
-            int i0 = eit->halfEdge->vertex->id;
-            int i1 = eit->halfEdge->next->vertex->id;
+        for(int edge = 0; edge < hem.NumEdges(); edge++) {
+            int i0 = hem.Vertex(hem.EdgeHalfEdge(edge));
+            int i1 = hem.Vertex(HalfEdgeMesh::Next(hem.EdgeHalfEdge(edge)));
 
             outUvEdges->push_back(outUvs[i0 * 2 + 0]);
             outUvEdges->push_back(outUvs[i0 * 2 + 1]);
@@ -284,3 +810,37 @@ void uvMap(
         outFaces.push_back(tri.i[2]);
     }
 }
+
+bool uvMap(
+    const float* positions,
+    size_t stride,
+    int numVertices,
+    const unsigned* indices,
+    int numIndices,
+
+    std::vector<int>& outRemap,
+    unsigned* outIndices,
+    std::vector<float>& outUvs,
+    UvSolver solver,
+    UvBoundary boundary
+    ) {
+
+    // the half edge mesh reads the caller's arrays in place.
+    HalfEdgeMesh hem(positions, stride, numVertices, indices, numIndices);
+
+    if(!HarmonicUvs(hem, solver, boundary, outUvs)) {
+        return false;
+    }
+
+    for(int v = 0; v < hem.NumVertices(); v++) {
+        outRemap.push_back(hem.InputIndex(v));
+    }
+
+    // the same face rotation as ToMesh(), so both overloads produce the same triangles.
+    for(int f = 0; f < hem.NumFaces(); f++) {
+        outIndices[f * 3 + 0] = hem.Vertex(f * 3 + 2);
+        outIndices[f * 3 + 1] = hem.Vertex(f * 3 + 0);
+        outIndices[f * 3 + 2] = hem.Vertex(f * 3 + 1);
+    }
+    return true;
+}
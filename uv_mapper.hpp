@@ -1,6 +1,32 @@
 
+#include <stddef.h>
 #include <vector>
 
+/*
+  How the harmonic system is solved.
+*/
+enum UvSolver {
+    // sparse LU of the full system, boundary rows pinned to identity.
+    UV_SOLVER_SPARSE_LU,
+    // boundary moved to the right-hand side, sparse LDL^T of the symmetric interior system.
+    UV_SOLVER_LDLT,
+    // the same interior system with Jacobi preconditioned conjugate gradient.
+    UV_SOLVER_CG,
+    // the interior system solved on a hierarchy of coarsened systems, then refined with multigrid preconditioned CG.
+    // Close to linear in the mesh size, for large meshes.
+    UV_SOLVER_MULTIGRID
+};
+
+/*
+  Where the boundary of the mesh is placed in UV space.
+*/
+enum UvBoundary {
+    // the unit circle around the origin, UVs in [-1,1]. The chart leaves the corners of the square unused.
+    UV_BOUNDARY_CIRCLE,
+    // the perimeter of the unit square, UVs in [0,1]. The chart covers the whole square.
+    UV_BOUNDARY_SQUARE
+};
+
 /*
   Automatically UV maps an input mesh with Harmonic Mapping.
 
@@ -12,6 +38,8 @@
   outUvs: The UV coordinates of the output mesh.
   outUvEdges: If non-null, the function will output the UV-coordinate edges of the UV mapping.
   These are useful for visualizing the mapping. Stored as a list of two-dimensional vectors. Where every pair of vectors is one line.
+  solver: The symmetric solvers fall back to UV_SOLVER_SPARSE_LU if they fail.
+  boundary: The shape the boundary is mapped to. A boundary of less than 4 vertices always goes on the circle.
 
  */
 void uvMap(
@@ -21,5 +49,45 @@ void uvMap(
     std::vector<float>& outVertices,
     std::vector<int>& outFaces,
     std::vector<float>& outUvs,
-    std::vector<float>* outUvEdges
+    std::vector<float>* outUvEdges,
+    UvSolver solver = UV_SOLVER_LDLT,
+    UvBoundary boundary = UV_BOUNDARY_CIRCLE
     );
+
+/*
+  The same mapping without the polygon-soup copies, for callers that keep other vertex attributes.
+
+  positions: The position of input vertex i is the 3 floats at (const char*)positions + i * stride.
+  indices: numIndices triangle indices into the input vertices, counter-clockwise.
+
+  outRemap: The input vertex of every output vertex, so the caller carries its own attributes across in O(n).
+  Output vertices are the input vertices used by the faces, in order of first use.
+  outIndices: numIndices triangle indices of the output vertices, written by the function.
+  outUvs: The UV coordinates of the output vertices.
+
+  Returns false, with nothing output, if the mesh has no boundary.
+ */
+bool uvMap(
+    const float* positions,
+    size_t stride,
+    int numVertices,
+    const unsigned* indices,
+    int numIndices,
+
+    std::vector<int>& outRemap,
+    unsigned* outIndices,
+    std::vector<float>& outUvs,
+    UvSolver solver = UV_SOLVER_LDLT,
+    UvBoundary boundary = UV_BOUNDARY_CIRCLE
+    );
+
+/*
+  The sparsity pattern and the symbolic LDL^T analysis of every solved system are cached, keyed by the
+  mesh connectivity, so a later mesh with the same connectivity only runs the numeric factorization.
+  The cache is shared by all threads.
+
+  uvClearPatternCache: Drops the cached patterns and resets the statistics.
+  uvGetPatternCacheStats: Number of solves that found (hits) or created (misses) their pattern.
+ */
+void uvClearPatternCache();
+void uvGetPatternCacheStats(unsigned& hits, unsigned& misses);
@@ -37,6 +37,14 @@ public:
     static float distance(const vec3& a, const vec3& b) {
         return length(a - b);
     }
+
+    static vec3 cross(const vec3& a, const vec3& b) {
+        return vec3(
+            a.y*b.z - a.z*b.y,
+            a.z*b.x - a.x*b.z,
+            a.x*b.y - a.y*b.x
+            );
+    }
 };
 
 class vec2 {